@@ -19,8 +19,8 @@
   1. Connects to a ethernet network
   2. Starts a websocket server on port 80
   3. Waits for connections
-  4. As soon as a client wants to establish a connection, it checks whether a
-     free slot is available and accepts it accordingly
+  4. As soon as a client wants to establish a connection, the server's connection
+     table takes it if a slot is free (and answers 503 otherwise)
   5. If the client is accepted it sends a welcome message and echoes any
      messages from the client
   6. Goes back to step 3
@@ -67,7 +67,6 @@ const uint16_t port = 81;
 // Define how many clients we accpet simultaneously.
 const byte maxClients = 4;
 
-WebsocketsClient clients[maxClients];
 WebsocketsServer server;
 
 void setup()
@@ -93,6 +92,10 @@ void setup()
   }
 
   // Start websockets server.
+  server.setMaxConnections(maxClients);
+  server.onConnection(handleConnection);
+  // Goes out together with the handshake response
+  server.setWelcomeMessage("Hello from Teensy");
   server.listen(port);
 
   if (server.available())
@@ -131,48 +134,15 @@ void handleEvent(WebsocketsClient &client, WebsocketsEvent event, String data)
   }
 }
 
-int8_t getFreeClientIndex()
+void handleConnection(WebsocketsClient &client, WebsocketsServer::ConnectionId id)
 {
-  // If a client in our list is not available, it's connection is closed and we
-  // can use it for a new client.
-  for (byte i = 0; i < maxClients; i++)
-  {
-    if (!clients[i].available())
-      return i;
-  }
-
-  return -1;
-}
-
-void listenForClients()
-{
-  if (server.poll())
-  {
-    int8_t freeIndex = getFreeClientIndex();
-
-    if (freeIndex >= 0)
-    {
-      WebsocketsClient newClient = server.accept();
-
-      Serial.printf("Accepted new websockets client at index %d\n", freeIndex);
-      newClient.onMessage(handleMessage);
-      newClient.onEvent(handleEvent);
-      newClient.send("Hello from Teensy");
-      clients[freeIndex] = newClient;
-    }
-  }
-}
-
-void pollClients()
-{
-  for (byte i = 0; i < maxClients; i++)
-  {
-    clients[i].poll();
-  }
+  Serial.printf("Accepted new websockets client, id %lu\n", (unsigned long) id);
+  client.onMessage(handleMessage);
+  client.onEvent(handleEvent);
 }
 
 void loop()
 {
-  listenForClients();
-  pollClients();
+  // Accepts new clients, polls every connected one and frees the slots of closed ones
+  server.pollAll();
 }
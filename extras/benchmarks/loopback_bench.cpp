@@ -0,0 +1,284 @@
+/****************************************************************************************************************************
+  loopback_bench.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Full stack benchmark over the in-process loopback transport: handshake, framing, masking, fragmentation
+// and callbacks without sockets or network noise. A server thread echoes every message from its onMessage
+// callback, the client measures round trips for a range of payload sizes. Faults split reads/writes to exercise the partial I/O paths.
+//
+// Usage: loopback_bench [seconds_per_case=1] [max_read=0] [max_write=0] [seed=0]
+
+#define _WEBSOCKETS_LOGLEVEL_   1
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::network2_generic;
+
+#define BENCH_PORT          9001
+
+struct CaseResult
+{
+  const char* name;
+  size_t      payload;
+  uint64_t    operations;
+  double      seconds;
+  double      cpuSeconds;
+};
+
+static double threadCpuSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double elapsedSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::shared_ptr<WebsocketsClient> connectClient(const LoopbackFaults& faults)
+{
+  std::shared_ptr<WebsocketsClient> client(new WebsocketsClient(std::make_shared<LoopbackTcpClient>(faults)));
+  
+  if (!client->connect("loopback", BENCH_PORT, "/"))
+    return nullptr;
+    
+  return client;
+}
+
+static CaseResult benchHandshake(const LoopbackFaults& faults, double seconds)
+{
+  uint64_t count = 0;
+  double cpu = threadCpuSeconds();
+  auto start = std::chrono::steady_clock::now();
+  
+  while (elapsedSince(start) < seconds)
+  {
+    auto client = connectClient(faults);
+    
+    if (!client)
+    {
+      fprintf(stderr, "handshake failed\n");
+      break;
+    }
+    
+    client->close();
+    count++;
+  }
+  
+  return { "handshake", 0, count, elapsedSince(start), threadCpuSeconds() - cpu };
+}
+
+// fragments == 0 sends whole messages, otherwise stream() + fragments pieces + end()
+static CaseResult benchEcho(const LoopbackFaults& faults, double seconds, size_t payload, size_t fragments)
+{
+  auto client = connectClient(faults);
+  
+  if (!client)
+    return { "echo", payload, 0, 0, 0 };
+    
+  std::string data(payload, 'x');
+  size_t piece = fragments ? (payload + fragments - 1) / fragments : payload;
+  
+  uint64_t count = 0;
+  double cpu = threadCpuSeconds();
+  auto start = std::chrono::steady_clock::now();
+  
+  while (elapsedSince(start) < seconds && client->available())
+  {
+    if (fragments == 0)
+    {
+      client->sendBinary(data.c_str(), data.size());
+    }
+    else
+    {
+      client->streamBinary("");
+      
+      for (size_t offset = 0; offset < payload; offset += piece)
+        client->send(data.c_str() + offset, (payload - offset < piece) ? payload - offset : piece);
+        
+      client->end("");
+    }
+    
+    // round trip: block on the echo instead of spinning on poll(), the server thread needs the CPU
+    WebsocketsMessage echo = client->readBlocking();
+      
+    if (echo.length() != payload)
+    {
+      fprintf(stderr, "echo of %zu bytes came back with %zu\n", payload, static_cast<size_t>(echo.length()));
+      break;
+    }
+    
+    count++;
+  }
+  
+  CaseResult result = { fragments ? "echo_fragmented" : "echo", payload, count, elapsedSince(start), threadCpuSeconds() - cpu };
+  
+  client->close();
+  
+  return result;
+}
+
+static void printResult(const CaseResult& r, bool last)
+{
+  printf("    {\"case\": \"%s\", \"payload\": %zu, \"operations\": %llu, \"ops_per_sec\": %.0f, \"mb_per_sec\": %.2f, "
+         "\"client_cpu_us_per_op\": %.3f}%s\n",
+         r.name, r.payload,
+         static_cast<unsigned long long>(r.operations),
+         r.seconds > 0 ? r.operations / r.seconds : 0.0,
+         r.seconds > 0 ? 2.0 * r.operations * r.payload / r.seconds / 1e6 : 0.0,
+         r.operations ? r.cpuSeconds * 1e6 / r.operations : 0.0,
+         last ? "" : ",");
+}
+
+// Numeric arguments must parse completely and lie in range, atoi() would read "1k" or "x" silently
+static bool parseInt(const char* text, long minimum, long maximum, long& value)
+{
+  char* end;
+  
+  errno = 0;
+  value = strtol(text, &end, 10);
+  
+  return errno == 0 && end != text && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+static bool parseDouble(const char* text, double minimum, double maximum, double& value)
+{
+  char* end;
+  
+  errno = 0;
+  value = strtod(text, &end);
+  
+  return errno == 0 && end != text && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+int main(int argc, char** argv)
+{
+  double seconds = 1.0;
+  long maxRead   = 0;
+  long maxWrite  = 0;
+  long seed      = 0;
+  
+  if ( argc > 5 || (argc > 1 && !parseDouble(argv[1], 0.001, 3600, seconds)) ||
+       (argc > 2 && !parseInt(argv[2], 0, INT32_MAX, maxRead)) || (argc > 3 && !parseInt(argv[3], 0, INT32_MAX, maxWrite)) ||
+       (argc > 4 && !parseInt(argv[4], 0, INT32_MAX, seed)) )
+  {
+    fprintf(stderr, "usage: %s [seconds_per_case=1] [max_read=0] [max_write=0] [seed=0]\n", argv[0]);
+    return 2;
+  }
+  
+  LoopbackFaults faults(maxRead, maxWrite, seed);
+
+  std::atomic<bool> stop(false);
+  std::atomic<bool> listening(false);
+
+  // Echo server: accepts and polls every connection on its own thread
+  std::thread serverThread([&]()
+  {
+    WebsocketsServer server(new LoopbackTcpServer(faults));
+    server.listen(BENCH_PORT);
+    
+    std::vector<std::shared_ptr<WebsocketsClient>> clients;
+    listening = true;
+
+    while (!stop)
+    {
+      if (server.poll())
+      {
+        std::shared_ptr<WebsocketsClient> client(new WebsocketsClient(server.accept()));
+        
+        if (client->available())
+        {
+          client->onMessage([](WebsocketsClient& client, WebsocketsMessage message)
+          {
+            client.sendBinary(message.c_str(), message.length());
+          });
+          
+          clients.push_back(client);
+        }
+      }
+
+      for (size_t i = 0; i < clients.size(); )
+      {
+        if (clients[i]->available())
+        {
+          clients[i]->poll();
+          i++;
+        }
+        else
+        {
+          clients.erase(clients.begin() + i);
+        }
+      }
+      
+      // let the client thread run on small machines
+      std::this_thread::yield();
+    }
+  });
+
+  while (!listening)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  const size_t sizes[] = { 0, 16, 125, 1024, 16384, 65536, 1048576 };
+  std::vector<CaseResult> results;
+  
+  results.push_back(benchHandshake(faults, seconds));
+  
+  for (size_t size : sizes)
+    results.push_back(benchEcho(faults, seconds, size, 0));
+    
+  results.push_back(benchEcho(faults, seconds, 16384, 16));
+
+  stop = true;
+  serverThread.join();
+
+  printf("{\n  \"max_read\": %lu, \"max_write\": %lu, \"seed\": %lu,\n  \"results\": [\n", 
+         (unsigned long) faults.maxReadSize, (unsigned long) faults.maxWriteSize, (unsigned long) faults.seed);
+
+  for (size_t i = 0; i < results.size(); i++)
+    printResult(results[i], i + 1 == results.size());
+
+  printf("  ]\n}\n");
+
+  return 0;
+}
@@ -0,0 +1,430 @@
+/****************************************************************************************************************************
+  micro_bench.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Microbenchmarks of the protocol hot paths, each over payload sizes from 0 B to 1 MiB. The handshake
+// functions take the size as the length of an extra header (or of the key for the accept computation).
+// Results are printed as JSON, one entry per function and size.
+//
+// Usage: micro_bench [min_seconds_per_case=0.2] [name_filter]
+//
+// results/micro_bench.json is a full run of a Release build (extras/native) on one core of a Xeon VM,
+// gcc 12. Compare runs on the same machine only.
+
+#define _WEBSOCKETS_LOGLEVEL_   1
+
+#include <WebSockets2_Generic.h>
+
+#include <chrono>
+#include <functional>
+#include <string.h>
+#include <vector>
+#include <errno.h>
+#include <stdlib.h>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::internals2_generic;
+
+// Serves a fixed byte string, rewound before every iteration
+class ReplayTcpClient : public network2_generic::TcpClient
+{
+  public:
+    void load(const WSString& data)
+    {
+      _data = data;
+      _offset = 0;
+    }
+    
+    void rewind()
+    {
+      _offset = 0;
+    }
+    
+    bool connect(const WSString&, int) override { return true; }
+    bool poll() override { return _offset < _data.size(); }
+    bool available() override { return _offset < _data.size(); }
+    void send(const WSString&) override {}
+    void send(const WSString&&) override {}
+    void send(const uint8_t*, const uint32_t) override {}
+    void close() override {}
+    int getSocket() const override { return -1; }
+    
+    WSString readLine() override
+    {
+      WSString line;
+      bool complete;
+      
+      _offset += network2_generic::BufferedLineReader::scanLine(reinterpret_cast<const uint8_t*>(_data.data()) + _offset, 
+                                                               _data.size() - _offset, line, complete);
+      return line;
+    }
+    
+    uint32_t read(uint8_t* buffer, const uint32_t len) override
+    {
+      size_t count = _data.size() - _offset;
+      
+      if (count > len)
+        count = len;
+        
+      memcpy(buffer, _data.data() + _offset, count);
+      _offset += count;
+      
+      return static_cast<uint32_t>(count);
+    }
+    
+  private:
+    WSString _data;
+    size_t _offset;
+};
+
+// Swallows everything that is sent
+class SinkTcpClient : public network2_generic::TcpClient
+{
+  public:
+    SinkTcpClient() : bytes(0) {}
+    
+    bool connect(const WSString&, int) override { return true; }
+    bool poll() override { return false; }
+    bool available() override { return true; }
+    void send(const WSString& data) override { bytes += data.size(); }
+    void send(const WSString&& data) override { bytes += data.size(); }
+    void send(const uint8_t*, const uint32_t len) override { bytes += len; }
+    WSString readLine() override { return ""; }
+    uint32_t read(uint8_t*, const uint32_t) override { return 0; }
+    void close() override {}
+    int getSocket() const override { return -1; }
+    
+    uint64_t bytes;
+};
+
+struct BenchResult
+{
+  std::string name;
+  size_t      size;
+  uint64_t    iterations;
+  double      seconds;
+};
+
+// keeps the optimiser from dropping results
+static volatile size_t sink;
+
+static double minSeconds  = 0.2;
+static const char* filter = nullptr;
+static std::vector<BenchResult> results;
+
+// timer wheel clock, moved by hand
+static unsigned long benchClock = 0;
+
+static unsigned long benchMillis()
+{
+  return benchClock;
+}
+
+// setup() runs once, body() is what gets timed
+static void bench(const char* name, size_t size, std::function<void()> setup, std::function<void()> body)
+{
+  if (filter && !strstr(name, filter))
+    return;
+    
+  setup();
+  body();
+  
+  uint64_t iterations = 0;
+  uint64_t batch = 1;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed = 0;
+  
+  while (elapsed < minSeconds)
+  {
+    for (uint64_t i = 0; i < batch; i++)
+      body();
+      
+    iterations += batch;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    if (batch < (1u << 20))
+      batch *= 2;
+  }
+  
+  results.push_back({ name, size, iterations, elapsed });
+}
+
+static WSString encodeHeader(uint64_t len, uint8_t opcode, bool fin, bool mask)
+{
+  // same size classes as WebsocketsEndpoint::getHeader()
+  if (len < 126)
+  {
+    auto header = MakeHeader<Header>(len, opcode, fin, mask);
+    return WSString(reinterpret_cast<char*>(&header), 2);
+  }
+  else if (len < 65536)
+  {
+    auto header = MakeHeader<HeaderWithExtended16>(len, opcode, fin, mask);
+    header.extendedPayload = (len << 8) | (len >> 8);
+    return WSString(reinterpret_cast<char*>(&header), 4);
+  }
+  
+  auto header = MakeHeader<HeaderWithExtended64>(len, opcode, fin, mask);
+  header.extendedPayload = swapEndianess(len);
+  
+  return WSString(reinterpret_cast<char*>(&header), 2) + WSString(reinterpret_cast<char*>(&header.extendedPayload), 8);
+}
+
+static WSString handshakeRequest(size_t extra)
+{
+  return "GET /chat HTTP/1.1\r\n"
+         "Host: server.example.com\r\n"
+         "Upgrade: websocket\r\n"
+         "Connection: Upgrade\r\n"
+         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+         "Sec-WebSocket-Version: 13\r\n"
+         "X-Bench: " + WSString(extra, 'h') + "\r\n"
+         "\r\n";
+}
+
+static void runSize(size_t size)
+{
+  const uint8_t maskingKey[4] = { 0x12, 0x34, 0x56, 0x78 };
+  WSString payload(size, 'x');
+  
+  bench("frame_header_encode", size, []() {}, [size]()
+  {
+    sink = encodeHeader(size, ContentType::Binary, true, true).size();
+  });
+  
+  std::shared_ptr<SinkTcpClient> sinkClient = std::make_shared<SinkTcpClient>();
+  WebsocketsEndpoint endpoint(sinkClient);
+  
+  bench("frame_encode_masked", size, []() {}, [&]()
+  {
+    endpoint.send(payload.c_str(), payload.size(), ContentType::Binary, true, true, reinterpret_cast<const char*>(maskingKey));
+  });
+  
+  uint8_t header[14];
+  
+  bench("frame_header_decode", size, [&]()
+  {
+    const WSString encoded = encodeHeader(size, ContentType::Binary, true, true) + WSString(reinterpret_cast<const char*>(maskingKey), 4);
+    
+    memcpy(header, encoded.data(), encoded.size());
+  }, [&]()
+  {
+    uint8_t key[4];
+    uint64_t length = parseFrameHeader(header, key);
+    
+    sink = length + frameHeaderSize(header) + key[0];
+  });
+  
+  bench("remask_data", size, []() {}, [&]()
+  {
+    remaskData(payload, maskingKey, payload.size());
+  });
+  
+  // a complete masked frame through WebsocketsEndpoint::recv(), payload read straight into the message
+  std::shared_ptr<ReplayTcpClient> replay = std::make_shared<ReplayTcpClient>();
+  WebsocketsEndpoint receiver(replay);
+  
+  bench("recv_frame", size, [&]()
+  {
+    replay->load(encodeHeader(size, ContentType::Binary, true, true) + WSString(reinterpret_cast<const char*>(maskingKey), 4) + payload);
+  }, [&]()
+  {
+    replay->rewind();
+    sink = receiver.recv().length();
+  });
+  
+  // 8 fragments: first + 6 continuations + last
+  std::vector<WebsocketsFrame> fragments(8);
+  
+  bench("stream_builder", size, [&]()
+  {
+    for (size_t i = 0; i < fragments.size(); i++)
+    {
+      size_t piece = size / fragments.size();
+      
+      fragments[i].fin = (i + 1 == fragments.size());
+      fragments[i].opcode = i == 0 ? ContentType::Binary : ContentType::Continuation;
+      fragments[i].mask = 0;
+      fragments[i].payload = WSString(i + 1 == fragments.size() ? size - piece * i : piece, 'f');
+      fragments[i].payload_length = fragments[i].payload.size();
+    }
+  }, [&]()
+  {
+    WebsocketsMessage::StreamBuilder builder;
+    
+    builder.first(fragments[0]);
+    
+    for (size_t i = 1; i + 1 < fragments.size(); i++)
+      builder.append(fragments[i]);
+      
+    builder.end(fragments.back());
+    sink = builder.build().length();
+  });
+  
+  bench("sha1", size, []() {}, [&]()
+  {
+    uint8_t digest[20];
+    
+    crypto2_generic::internals2_generic::sha1 hash;
+    hash.add(payload.data(), payload.size());
+    hash.finalize();
+    memcpy(digest, hash.state, sizeof(digest));
+    sink = digest[0];
+  });
+  
+  WSString encoded = crypto2_generic::internals2_generic::base64_encode(reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+  
+  bench("base64_encode", size, []() {}, [&]()
+  {
+    sink = crypto2_generic::internals2_generic::base64_encode(reinterpret_cast<const uint8_t*>(payload.data()), payload.size()).size();
+  });
+  
+  bench("base64_decode", size, []() {}, [&]()
+  {
+    sink = crypto2_generic::internals2_generic::base64_decode(encoded).size();
+  });
+  
+  bench("handshake_encode_key", size, []() {}, [&]()
+  {
+    sink = crypto2_generic::websocketsHandshakeEncodeKey(payload).size();
+  });
+  
+  std::vector<std::pair<WSString, WSString>> customHeaders;
+  customHeaders.push_back({ "X-Bench", payload });
+  
+  size_t keyOffset = 0;
+  
+  bench("build_handshake_template", size, []() {}, [&]()
+  {
+    sink = buildHandshakeTemplate("server.example.com", "/chat", customHeaders, "", keyOffset).size();
+  });
+  
+  // What connect() still does per attempt once the template and the next key are prepared
+  WSString handshakeTemplate = buildHandshakeTemplate("server.example.com", "/chat", customHeaders, "", keyOffset);
+  const WSString nextKey = "dGhlIHNhbXBsZSBub25jZQ==";
+  
+  bench("patch_handshake_key", size, []() {}, [&]()
+  {
+    handshakeTemplate.replace(keyOffset, nextKey.size(), nextKey);
+    sink = handshakeTemplate.size();
+  });
+  
+  const WSString response = "HTTP/1.1 101 Switching Protocols\r\n"
+                            "Upgrade: websocket\r\n"
+                            "Connection: Upgrade\r\n"
+                            "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+                            "X-Bench: " + payload + "\r\n"
+                            "\r\n";
+  
+  bench("parse_handshake_response", size, []() {}, [&]()
+  {
+    sink = parseHandshakeResponse(response).serverAccept.size;
+  });
+  
+  const WSString request = handshakeRequest(size);
+  
+  bench("parse_handshake_request", size, []() {}, [&]()
+  {
+    internals2_generic::HttpHeaderParser parser;
+    
+    parser.parse(request.data(), request.size());
+    sink = parser.get(internals2_generic::HttpHeader_Key).size + parser.headerCount();
+  });
+  
+  // size is the number of other timers armed, like one 30 s heartbeat per connection
+  WebsocketsTimerWheel wheel(benchMillis);
+  std::vector<WebsocketsTimer> heartbeats(size);
+  
+  for (size_t i = 0; i < size; i++)
+  {
+    heartbeats[i].setCallback([&wheel, &heartbeats, i]() { wheel.arm(heartbeats[i], 30000); });
+    wheel.arm(heartbeats[i], 1 + (i * 7919) % 30000);
+  }
+  
+  WebsocketsTimer timer;
+  
+  bench("timer_arm_cancel", size, []() {}, [&]()
+  {
+    wheel.arm(timer, 5000);
+    timer.cancel();
+    sink = wheel.size();
+  });
+  
+  // one millisecond of the event loop: size / 30000 heartbeats fire and are armed again
+  bench("timer_advance_1ms", size, []() {}, [&]()
+  {
+    benchClock++;
+    sink = wheel.advance();
+  });
+}
+
+// The duration must parse completely and lie in range, atof() would read "x" as 0 silently
+static bool parseDouble(const char* text, double minimum, double maximum, double& value)
+{
+  char* end;
+  
+  errno = 0;
+  value = strtod(text, &end);
+  
+  return errno == 0 && end != text && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+int main(int argc, char** argv)
+{
+  filter      = argc > 2 ? argv[2] : nullptr;
+  
+  if ( argc > 3 || (argc > 1 && !parseDouble(argv[1], 0.001, 600, minSeconds)) )
+  {
+    fprintf(stderr, "usage: %s [min_seconds_per_case=0.2] [name_filter]\n", argv[0]);
+    return 2;
+  }
+  
+  const size_t sizes[] = { 0, 16, 125, 126, 1024, 16384, 65535, 65536, 1048576 };
+  
+  for (size_t size : sizes)
+    runSize(size);
+    
+  printf("{\n  \"min_seconds\": %.3f,\n  \"benchmarks\": [\n", minSeconds);
+  
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const BenchResult& r = results[i];
+    double nsPerOp = r.seconds * 1e9 / r.iterations;
+    
+    printf("    {\"name\": \"%s\", \"size\": %zu, \"iterations\": %llu, \"ns_per_op\": %.1f, \"mb_per_sec\": %.2f}%s\n",
+           r.name.c_str(), r.size, static_cast<unsigned long long>(r.iterations), nsPerOp,
+           r.size ? r.size * 1e3 / nsPerOp : 0.0,
+           i + 1 == results.size() ? "" : ",");
+  }
+  
+  printf("  ]\n}\n");
+  
+  return 0;
+}
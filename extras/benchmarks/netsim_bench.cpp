@@ -0,0 +1,187 @@
+/****************************************************************************************************************************
+  netsim_bench.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Simulated link timings: the client side of a loopback connection goes through SimulatedTcpClient
+// on a VirtualClock, so the numbers are simulated milliseconds. They do not depend on the machine
+// and repeat exactly for the same seed.
+//
+// Usage: netsim_bench [seed=1] [messages=20]
+
+#define _WEBSOCKETS_LOGLEVEL_   1
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+#include <Tiny_Websockets_Generic/network/simulator/simulated_tcp.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <stdlib.h>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::network2_generic;
+
+#define BENCH_PORT          9002
+
+struct LinkProfile
+{
+  const char*       name;
+  NetworkConditions conditions;
+};
+
+static void runProfile(const LinkProfile& profile, uint32_t seed, int messages, bool last)
+{
+  NetworkConditions conditions = profile.conditions;
+  conditions.seed = seed;
+  
+  std::shared_ptr<VirtualClock> clock(new VirtualClock());
+  std::shared_ptr<SimulatedTcpClient> transport(new SimulatedTcpClient(std::make_shared<LoopbackTcpClient>(), conditions, clock));
+  WebsocketsClient client(transport);
+  
+  uint64_t start = clock->nowUs();
+  bool connected = client.connect("loopback", BENCH_PORT, "/");
+  double handshakeMs = (clock->nowUs() - start) / 1000.0;
+  
+  printf("    {\"link\": \"%s\", \"connected\": %s, \"handshake_ms\": %.1f, \"echo\": [", 
+         profile.name, connected ? "true" : "false", handshakeMs);
+  
+  const size_t sizes[] = { 16, 1024, 16384, 65536 };
+  
+  for (size_t i = 0; connected && i < sizeof(sizes) / sizeof(sizes[0]); i++)
+  {
+    std::string data(sizes[i], 'x');
+    uint64_t worstUs = 0;
+    
+    start = clock->nowUs();
+    
+    for (int k = 0; k < messages && client.available(); k++)
+    {
+      uint64_t sent = clock->nowUs();
+      
+      client.sendBinary(data.c_str(), data.size());
+      client.readBlocking();
+      
+      if (clock->nowUs() - sent > worstUs)
+        worstUs = clock->nowUs() - sent;
+    }
+    
+    printf("%s{\"payload\": %zu, \"avg_rtt_ms\": %.1f, \"max_rtt_ms\": %.1f}", i ? ", " : "", sizes[i], 
+           (clock->nowUs() - start) / 1000.0 / messages, worstUs / 1000.0);
+  }
+  
+  printf("]}%s\n", last ? "" : ",");
+  
+  client.close();
+}
+
+// Numeric arguments must parse completely and lie in range, atoi() would read "1k" or "x" silently
+static bool parseInt(const char* text, long minimum, long maximum, long& value)
+{
+  char* end;
+  
+  errno = 0;
+  value = strtol(text, &end, 10);
+  
+  return errno == 0 && end != text && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+int main(int argc, char** argv)
+{
+  long seed     = 1;
+  long messages = 20;
+  
+  if ( argc > 3 || (argc > 1 && !parseInt(argv[1], 0, INT32_MAX, seed)) ||
+       (argc > 2 && !parseInt(argv[2], 1, 1000000, messages)) )
+  {
+    fprintf(stderr, "usage: %s [seed=1] [messages=20]\n", argv[0]);
+    return 2;
+  }
+  
+
+  std::atomic<bool> stop(false);
+  std::atomic<bool> listening(false);
+
+  std::thread serverThread([&]()
+  {
+    WebsocketsServer server(new LoopbackTcpServer());
+    server.listen(BENCH_PORT);
+    
+    std::vector<std::shared_ptr<WebsocketsClient>> clients;
+    listening = true;
+
+    while (!stop)
+    {
+      if (server.poll())
+      {
+        std::shared_ptr<WebsocketsClient> client(new WebsocketsClient(server.accept()));
+        
+        client->onMessage([](WebsocketsClient& client, WebsocketsMessage message)
+        {
+          client.sendBinary(message.c_str(), message.length());
+        });
+        
+        clients.push_back(client);
+      }
+
+      for (auto& client : clients)
+        client->poll();
+        
+      std::this_thread::yield();
+    }
+  });
+
+  while (!listening)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  LinkProfile profiles[] = 
+  {
+    { "ideal",          NetworkConditions() },
+    { "congested_wifi", NetworkConditions::congestedWifi() },
+    { "2g",             NetworkConditions::link2G() }
+  };
+  
+  const size_t count = sizeof(profiles) / sizeof(profiles[0]);
+
+  printf("{\n  \"seed\": %ld, \"messages\": %ld,\n  \"results\": [\n", seed, messages);
+  
+  for (size_t i = 0; i < count; i++)
+    runProfile(profiles[i], seed, messages, i + 1 == count);
+    
+  printf("  ]\n}\n");
+
+  stop = true;
+  serverThread.join();
+
+  return 0;
+}
@@ -0,0 +1,206 @@
+/****************************************************************************************************************************
+  transport_bench.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Loopback comparison of the Linux server transports: plain sockets + epoll (LinuxTcpServer)
+// against io_uring (IoUringTcpServer). Both run the same WebsocketsHub and endpoint code,
+// the clients live on another thread and keep a fixed number of echo messages in flight.
+//
+// Usage: transport_bench [connections=100] [seconds=5] [payload=64] [inflight=4]
+
+#ifndef WS_USE_IO_URING
+  #define WS_USE_IO_URING   true
+#endif
+#define _WEBSOCKETS_LOGLEVEL_   1
+
+#include <WebSockets2_Generic.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace websockets2_generic;
+
+struct BenchResult
+{
+  bool      ioUring;
+  uint64_t  messages;
+  double    seconds;
+  double    serverCpuSeconds;
+};
+
+static double threadCpuSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static BenchResult runBench(network2_generic::TcpServer* tcpServer, bool ioUring, uint16_t port, 
+                            int connections, int seconds, size_t payload, int inflight)
+{
+  std::atomic<bool> stop(false);
+  std::atomic<bool> listening(false);
+  double serverCpu = 0;
+
+  std::thread serverThread([&]()
+  {
+    WebsocketsServer server(tcpServer);
+    server.listen(port);
+
+    WebsocketsHub hub;
+    hub.attach(server);
+    hub.onConnection([](WebsocketsClient& client)
+    {
+      client.onMessage([](WebsocketsClient& client, WebsocketsMessage message)
+      {
+        client.sendBinary(message.c_str(), message.length());
+      });
+    });
+
+    listening = true;
+    double start = threadCpuSeconds();
+
+    while (!stop)
+      hub.poll(10);
+
+    serverCpu = threadCpuSeconds() - start;
+  });
+
+  while (!listening)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  std::string data(payload, 'x');
+  uint64_t received = 0;
+
+  WebsocketsHub clients;
+  
+  for (int i = 0; i < connections; i++)
+  {
+    WebsocketsClient client;
+    
+    client.onMessage([&](WebsocketsClient& client, WebsocketsMessage)
+    {
+      received++;
+      client.sendBinary(data.c_str(), data.size());
+    });
+
+    if (!client.connect("127.0.0.1", port, "/"))
+    {
+      fprintf(stderr, "connect %d failed\n", i);
+      continue;
+    }
+
+    for (int k = 0; k < inflight; k++)
+      client.sendBinary(data.c_str(), data.size());
+
+    clients.add(client);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto end   = start + std::chrono::seconds(seconds);
+  uint64_t warm = received;
+
+  while (std::chrono::steady_clock::now() < end)
+    clients.poll(10);
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  uint64_t total = received - warm;
+
+  stop = true;
+  serverThread.join();
+
+  return { ioUring, total, elapsed, serverCpu };
+}
+
+static void printResult(const BenchResult& r, size_t payload, bool last)
+{
+  printf("    {\"transport\": \"%s\", \"messages\": %llu, \"msgs_per_sec\": %.0f, \"mb_per_sec\": %.2f, "
+         "\"server_cpu_us_per_msg\": %.3f}%s\n",
+         r.ioUring ? "io_uring" : "epoll",
+         static_cast<unsigned long long>(r.messages),
+         r.messages / r.seconds,
+         r.messages * payload / r.seconds / 1e6,
+         r.messages ? r.serverCpuSeconds * 1e6 / r.messages : 0.0,
+         last ? "" : ",");
+}
+
+// Numeric arguments must parse completely and lie in range, atoi() would read "1k" or "x" silently
+static bool parseInt(const char* text, long minimum, long maximum, long& value)
+{
+  char* end;
+  
+  errno = 0;
+  value = strtol(text, &end, 10);
+  
+  return errno == 0 && end != text && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+int main(int argc, char** argv)
+{
+  long connections = 100;
+  long seconds     = 5;
+  long payload     = 64;
+  long inflight    = 4;
+  
+  if ( argc > 5 || (argc > 1 && !parseInt(argv[1], 1, 100000, connections)) ||
+       (argc > 2 && !parseInt(argv[2], 1, 3600, seconds)) || (argc > 3 && !parseInt(argv[3], 0, 16 * 1024 * 1024, payload)) ||
+       (argc > 4 && !parseInt(argv[4], 1, 10000, inflight)) )
+  {
+    fprintf(stderr, "usage: %s [connections=100] [seconds=5] [payload=64] [inflight=4]\n", argv[0]);
+    return 2;
+  }
+  
+
+  BenchResult epoll = runBench(new network2_generic::LinuxTcpServer(1024), false, 18090, connections, seconds, payload, inflight);
+
+  bool haveUring = network2_generic::IoUringContext::isSupported();
+
+  printf("{\n  \"connections\": %ld, \"payload\": %ld, \"inflight\": %ld,\n  \"results\": [\n", connections, payload, inflight);
+  printResult(epoll, payload, !haveUring);
+
+  if (haveUring)
+  {
+    BenchResult uring = runBench(new network2_generic::IoUringTcpServer(1024), true, 18091, connections, seconds, payload, inflight);
+    printResult(uring, payload, true);
+  }
+  else
+  {
+    fprintf(stderr, "io_uring not supported by this kernel, only the epoll transport was measured\n");
+  }
+
+  printf("  ]\n}\n");
+
+  return 0;
+}
@@ -0,0 +1,251 @@
+/****************************************************************************************************************************
+  Arduino.h
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Minimal host-side stand-in for the Arduino core, used by the native (Linux) build of the library.
+// It only provides what the protocol code and the LOG* macros touch: String, Serial, millis(),
+// micros(), delay(), yield() and random(). Add this directory to the include path *before* any
+// real Arduino core, e.g. -I extras/native
+
+#pragma once
+
+#ifndef Arduino_Native_Shim_h
+#define Arduino_Native_Shim_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include <string>
+
+#ifndef ARDUINO_NATIVE
+  #define ARDUINO_NATIVE      true
+#endif
+
+class String : public std::string
+{
+  public:
+    String() {}
+    String(const char* str) : std::string(str ? str : "") {}
+    String(const char* str, size_t len) : std::string(str ? str : "", str ? len : 0) {}
+    String(const std::string& str) : std::string(str) {}
+    String(std::string&& str) : std::string(std::move(str)) {}
+    explicit String(char c) : std::string(1, c) {}
+    explicit String(int value) : std::string(std::to_string(value)) {}
+    explicit String(unsigned int value) : std::string(std::to_string(value)) {}
+    explicit String(long value) : std::string(std::to_string(value)) {}
+    explicit String(unsigned long value) : std::string(std::to_string(value)) {}
+
+    unsigned int length() const
+    {
+      return size();
+    }
+
+    bool equals(const String& other) const
+    {
+      return *this == other;
+    }
+
+    bool equalsIgnoreCase(const String& other) const
+    {
+      return size() == other.size() && strncasecmp(c_str(), other.c_str(), size()) == 0;
+    }
+
+    bool startsWith(const String& prefix) const
+    {
+      return compare(0, prefix.size(), prefix) == 0;
+    }
+
+    bool endsWith(const String& suffix) const
+    {
+      return size() >= suffix.size() && compare(size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const
+    {
+      size_t pos = find(c, from);
+
+      return pos == npos ? -1 : static_cast<int>(pos);
+    }
+
+    int indexOf(const String& str, unsigned int from = 0) const
+    {
+      size_t pos = find(str, from);
+
+      return pos == npos ? -1 : static_cast<int>(pos);
+    }
+
+    String substring(unsigned int from) const
+    {
+      return from < size() ? String(substr(from)) : String();
+    }
+
+    String substring(unsigned int from, unsigned int to) const
+    {
+      if (from > to)
+        std::swap(from, to);
+
+      return from < size() ? String(substr(from, to - from)) : String();
+    }
+
+    long toInt() const
+    {
+      return atol(c_str());
+    }
+
+    bool concat(const String& str)
+    {
+      append(str);
+
+      return true;
+    }
+
+    char charAt(unsigned int index) const
+    {
+      return index < size() ? (*this)[index] : 0;
+    }
+};
+
+inline String operator+(const String& lhs, const String& rhs)
+{
+  return String(static_cast<const std::string&>(lhs) + static_cast<const std::string&>(rhs));
+}
+
+inline String operator+(const String& lhs, const char* rhs)
+{
+  return String(static_cast<const std::string&>(lhs) + rhs);
+}
+
+inline String operator+(const char* lhs, const String& rhs)
+{
+  return String(lhs + static_cast<const std::string&>(rhs));
+}
+
+// Prints to stderr so that tools can keep stdout for their own (JSON) output
+class NativeSerial
+{
+  public:
+    void begin(unsigned long) {}
+
+    operator bool() const
+    {
+      return true;
+    }
+
+    template<typename T>
+    void print(const T& value)
+    {
+      write(value);
+    }
+
+    template<typename T>
+    void println(const T& value)
+    {
+      write(value);
+      fputc('\n', stderr);
+    }
+
+    void println()
+    {
+      fputc('\n', stderr);
+    }
+
+    void flush()
+    {
+      fflush(stderr);
+    }
+
+  private:
+    void write(const char* str)               { fputs(str ? str : "(null)", stderr); }
+    void write(const std::string& str)        { fwrite(str.data(), 1, str.size(), stderr); }
+    void write(char c)                        { fputc(c, stderr); }
+    void write(bool value)                    { fputs(value ? "1" : "0", stderr); }
+    void write(const void* ptr)               { fprintf(stderr, "%p", ptr); }
+    void write(float value)                   { fprintf(stderr, "%.2f", value); }
+    void write(double value)                  { fprintf(stderr, "%.2f", value); }
+    void write(long long value)               { fprintf(stderr, "%lld", value); }
+    void write(unsigned long long value)      { fprintf(stderr, "%llu", value); }
+    void write(long value)                    { fprintf(stderr, "%ld", value); }
+    void write(unsigned long value)           { fprintf(stderr, "%lu", value); }
+    void write(int value)                     { fprintf(stderr, "%d", value); }
+    void write(unsigned int value)            { fprintf(stderr, "%u", value); }
+    void write(short value)                   { fprintf(stderr, "%d", value); }
+    void write(unsigned short value)          { fprintf(stderr, "%u", value); }
+    void write(unsigned char value)           { fprintf(stderr, "%u", value); }
+};
+
+static NativeSerial Serial;
+
+inline unsigned long micros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return static_cast<unsigned long>(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+inline unsigned long millis()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return static_cast<unsigned long>(ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000);
+}
+
+inline void delay(unsigned long ms)
+{
+  usleep(ms * 1000);
+}
+
+inline void yield()
+{
+  sched_yield();
+}
+
+inline long random(long howbig)
+{
+  return howbig > 0 ? ::random() % howbig : 0;
+}
+
+inline long random(long howsmall, long howbig)
+{
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+inline void randomSeed(unsigned long seed)
+{
+  srandom(seed);
+}
+
+#endif    // Arduino_Native_Shim_h
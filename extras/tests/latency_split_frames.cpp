@@ -0,0 +1,201 @@
+/****************************************************************************************************************************
+  latency_split_frames.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Receive latency of frames that arrive over several polls. The peer writes every frame in parts with a
+// pause in between, the connection reads without waiting (LoopbackFaults nonBlocking) and at most a few
+// bytes per read (maxReadSize), so the header or the payload is left half read by one poll and completed
+// by a later one. Each stage has to be measured from the first byte of the frame: none may wrap around
+// (a stage timed from a later poll than the one it started in), and Total has to cover the pause.
+//
+// Usage: latency_split_frames
+// Exits 1 when a stage is off.
+
+#define _WEBSOCKETS_LOGLEVEL_         1
+#define _WEBSOCKETS_LATENCY_STATS_    true
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+#include <memory>
+#include <string>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::network2_generic;
+
+static const uint32_t PauseMs = 20;
+
+// No sample may come close to this, a wrapped one is ~4.29e9
+static const uint32_t SaneMaxUs = 1000000;
+
+struct StdoutPort
+{
+  void println(const char* line)
+  {
+    printf("  %s\n", line);
+  }
+};
+
+static WSString encodeFrame(uint8_t opcode, const WSString& payload)
+{
+  WSString frame;
+  
+  frame += static_cast<char>(0x80 | opcode);
+  
+  if (payload.size() < 126)
+  {
+    frame += static_cast<char>(payload.size());
+  }
+  else
+  {
+    frame += static_cast<char>(126);
+    frame += static_cast<char>(payload.size() >> 8);
+    frame += static_cast<char>(payload.size() & 0xFF);
+  }
+  
+  return frame + payload;
+}
+
+struct Connection
+{
+  std::shared_ptr<LoopbackPipe> toClient;
+  std::shared_ptr<LoopbackPipe> fromClient;
+  std::unique_ptr<WebsocketsClient> client;
+  size_t received;
+  
+  explicit Connection(const LoopbackFaults& faults) :
+    toClient(new LoopbackPipe()),
+    fromClient(new LoopbackPipe()),
+    received(0)
+  {
+    client.reset(new WebsocketsClient(std::make_shared<LoopbackTcpClient>(toClient, fromClient, faults)));
+    client->onMessage([this](WebsocketsClient&, WebsocketsMessage) { received++; });
+  }
+  
+  void write(const WSString& data, const size_t from, const size_t to)
+  {
+    toClient->write(reinterpret_cast<const uint8_t*>(data.data()) + from, static_cast<uint32_t>(to - from));
+  }
+};
+
+// Writes frame in two parts split at offset, polling in between, and polls until it was received
+static bool sendSplit(Connection& connection, const WSString& frame, const size_t offset, const uint32_t pauseMs)
+{
+  const size_t before = connection.received;
+  
+  connection.write(frame, 0, offset);
+  connection.client->poll();
+  
+  if (pauseMs > 0)
+    usleep(pauseMs * 1000);
+    
+  connection.write(frame, offset, frame.size());
+  
+  for (int i = 0; i < 1000 && connection.received == before; i++)
+    connection.client->poll();
+    
+  return connection.received == before + 1;
+}
+
+static bool check(const char* name, bool ok)
+{
+  printf("%-60s %s\n", name, ok ? "ok" : "FAILED");
+  
+  return ok;
+}
+
+static bool checkSane(const WebsocketsLatencyStats& stats)
+{
+  bool ok = true;
+  
+  for (int i = 0; i < LatencyStage_Count; i++)
+    ok = ok && stats.stages[i].maximum() < SaneMaxUs;
+    
+  return ok;
+}
+
+int main()
+{
+  bool ok = true;
+  StdoutPort port;
+  const uint32_t pauseUs = PauseMs * 1000;
+  const WSString frame = encodeFrame(0x2, WSString(200, 'x'));
+  
+  // The pause falls in the header, read by the first poll up to the byte before it
+  {
+    Connection connection(LoopbackFaults(3, 0, 0, true));
+    
+    ok &= check("header split: received", sendSplit(connection, frame, 1, PauseMs));
+    
+    const WebsocketsLatencyStats& stats = connection.client->getLatencyStats();
+    
+    stats.print(port);
+    ok &= check("header split: header covers the pause", stats.stages[LatencyStage_Header].maximum() >= pauseUs);
+    ok &= check("header split: total covers the pause", stats.stages[LatencyStage_Total].maximum() >= pauseUs);
+    ok &= check("header split: no stage wraps", checkSane(stats));
+  }
+  
+  // The header is complete in the first poll, the pause falls in the payload
+  {
+    Connection connection(LoopbackFaults(3, 0, 0, true));
+    
+    ok &= check("payload split: received", sendSplit(connection, frame, 100, PauseMs));
+    
+    const WebsocketsLatencyStats& stats = connection.client->getLatencyStats();
+    
+    stats.print(port);
+    ok &= check("payload split: header is only the parsing", stats.stages[LatencyStage_Header].maximum() < pauseUs);
+    ok &= check("payload split: payload covers the pause", stats.stages[LatencyStage_Payload].maximum() >= pauseUs);
+    ok &= check("payload split: total covers the pause", stats.stages[LatencyStage_Total].maximum() >= pauseUs);
+    ok &= check("payload split: no stage wraps", checkSane(stats));
+  }
+  
+  // Every split point, with random read sizes
+  {
+    Connection connection(LoopbackFaults(5, 0, 0x2545F491, true));
+    bool received = true;
+    
+    for (size_t offset = 1; offset < frame.size(); offset++)
+      received = received && sendSplit(connection, frame, offset, 0);
+      
+    const WebsocketsLatencyStats& stats = connection.client->getLatencyStats();
+    
+    stats.print(port);
+    ok &= check("every split: received", received);
+    ok &= check("every split: one sample per frame", stats.stages[LatencyStage_Total].count() == frame.size() - 1);
+    ok &= check("every split: no stage wraps", checkSane(stats));
+  }
+  
+  printf(ok ? "ok\n" : "FAILED\n");
+  
+  return ok ? 0 : 1;
+}
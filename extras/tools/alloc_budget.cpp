@@ -0,0 +1,501 @@
+/****************************************************************************************************************************
+  alloc_budget.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Counts heap allocations (operator new and the malloc family) per protocol operation and checks them
+// against a budget, so allocation removals stay removed. Every operation runs single threaded on an
+// in-memory transport, after a warm-up, and only allocations made by the measuring thread count.
+//
+// Usage: alloc_budget [iterations=1000] [budget.<operation>=N ...] [report]
+//   report: print the numbers but always exit 0
+// Exits 1 when an operation allocates more per call than its budget. The budgets below are the current
+// numbers and may only go down, 0 is the goal for everything but the handshake.
+//
+// Replaces the global malloc, so it can't be combined with the sanitizers (glibc only).
+
+#define _WEBSOCKETS_LOGLEVEL_   1
+
+#include <WebSockets2_Generic.h>
+
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace websockets2_generic;
+
+///////////////////////////////////////////////////////////////////
+
+extern "C" 
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t count, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void  __libc_free(void* ptr);
+}
+
+struct AllocTally
+{
+  uint64_t allocations;
+  uint64_t bytes;
+};
+
+static __thread bool counting = false;
+static AllocTally tally;
+
+static inline void countAllocation(size_t size)
+{
+  if (counting)
+  {
+    tally.allocations++;
+    tally.bytes += size;
+  }
+}
+
+extern "C" void* malloc(size_t size)
+{
+  countAllocation(size);
+  
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+  countAllocation(count * size);
+  
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+  countAllocation(size);
+  
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr)
+{
+  __libc_free(ptr);
+}
+
+void* operator new(size_t size)
+{
+  countAllocation(size);
+  
+  void* ptr = __libc_malloc(size ? size : 1);
+  
+  if (!ptr)
+    throw std::bad_alloc();
+    
+  return ptr;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  countAllocation(size);
+  
+  return __libc_malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+  return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept                          { __libc_free(ptr); }
+void operator delete[](void* ptr) noexcept                        { __libc_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept                  { __libc_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept                { __libc_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept   { __libc_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { __libc_free(ptr); }
+
+// Keeps allocations of the harness itself (fixtures, hooks) out of the numbers
+class PauseCounting
+{
+  public:
+    PauseCounting() : _was(counting) 
+    { 
+      counting = false; 
+    }
+    
+    ~PauseCounting() 
+    { 
+      counting = _was; 
+    }
+    
+  private:
+    bool _was;
+};
+
+///////////////////////////////////////////////////////////////////
+
+// In-memory transport: inbound bytes are fed by the harness, outbound bytes go to an optional hook
+class MemoryTcpClient : public network2_generic::TcpClient
+{
+  public:
+    MemoryTcpClient() : _offset(0), _open(true) 
+    {
+      _inbound.reserve(256 * 1024);
+    }
+    
+    void feed(const WSString& data)
+    {
+      PauseCounting pause;
+      
+      if (_offset == _inbound.size())
+      {
+        _inbound.clear();
+        _offset = 0;
+      }
+      
+      _inbound.append(data);
+    }
+    
+    std::function<void(const char*, size_t)> onSend;
+    
+    bool connect(const WSString&, int) override { return true; }
+    bool poll() override { return _offset < _inbound.size(); }
+    bool available() override { return _open; }
+    void close() override { _open = false; }
+    int getSocket() const override { return -1; }
+    
+    void send(const WSString& data) override { sent(data.data(), data.size()); }
+    void send(const WSString&& data) override { sent(data.data(), data.size()); }
+    void send(const uint8_t* data, const uint32_t len) override { sent(reinterpret_cast<const char*>(data), len); }
+    
+    WSString readLine() override
+    {
+      WSString line;
+      bool complete;
+      
+      _offset += network2_generic::BufferedLineReader::scanLine(reinterpret_cast<const uint8_t*>(_inbound.data()) + _offset, 
+                                                               _inbound.size() - _offset, line, complete);
+      return line;
+    }
+    
+    uint32_t read(uint8_t* buffer, const uint32_t len) override
+    {
+      size_t count = _inbound.size() - _offset;
+      
+      if (count > len)
+        count = len;
+        
+      memcpy(buffer, _inbound.data() + _offset, count);
+      _offset += count;
+      
+      return static_cast<uint32_t>(count);
+    }
+    
+  private:
+    WSString _inbound;
+    size_t _offset;
+    bool _open;
+    
+    void sent(const char* data, size_t len)
+    {
+      if (onSend)
+      {
+        PauseCounting pause;
+        onSend(data, len);
+      }
+    }
+};
+
+// Hands out one prepared connection per accept()
+class MemoryTcpServer : public network2_generic::TcpServer
+{
+  public:
+    MemoryTcpServer() : next(nullptr) {}
+    
+    bool poll() override { return next != nullptr; }
+    bool listen(const uint16_t) override { return true; }
+    bool available() override { return true; }
+    void close() override {}
+    int getSocket() const override { return -1; }
+    
+    network2_generic::TcpClient* accept() override
+    {
+      network2_generic::TcpClient* client = next;
+      next = nullptr;
+      
+      return client;
+    }
+    
+    network2_generic::TcpClient* next;
+};
+
+// Unmasked server-to-client frame
+static WSString encodeFrame(uint8_t opcode, const WSString& payload)
+{
+  WSString frame;
+  
+  frame += static_cast<char>(0x80 | opcode);
+  
+  if (payload.size() < 126)
+  {
+    frame += static_cast<char>(payload.size());
+  }
+  else if (payload.size() < 65536)
+  {
+    frame += static_cast<char>(126);
+    frame += static_cast<char>(payload.size() >> 8);
+    frame += static_cast<char>(payload.size() & 0xFF);
+  }
+  else
+  {
+    frame += static_cast<char>(127);
+    
+    for (int shift = 56; shift >= 0; shift -= 8)
+      frame += static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xFF);
+  }
+  
+  return frame + payload;
+}
+
+// Answers the client's upgrade request as soon as it has been sent
+static void answerHandshake(MemoryTcpClient& transport, const char* data, size_t len)
+{
+  PauseCounting pause;
+  
+  WSString request(data, len);
+  const char* name = "Sec-WebSocket-Key: ";
+  size_t start = request.find(name);
+  
+  if (start == WSString::npos)
+    return;
+    
+  start += strlen(name);
+  
+  WSString key = request.substr(start, request.find("\r\n", start) - start);
+  
+  transport.feed("HTTP/1.1 101 Switching Protocols\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Sec-WebSocket-Accept: " + crypto2_generic::websocketsHandshakeEncodeKey(key) + "\r\n"
+                 "\r\n");
+}
+
+static const char* upgradeRequest = 
+  "GET / HTTP/1.1\r\n"
+  "Host: 127.0.0.1:8080\r\n"
+  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+  "Upgrade: websocket\r\n"
+  "Connection: Upgrade\r\n"
+  "Sec-WebSocket-Version: 13\r\n"
+  "\r\n";
+
+///////////////////////////////////////////////////////////////////
+
+struct Operation
+{
+  const char* name;
+  double budget;      // allocations per call
+  
+  // setup() runs uncounted before every call of run()
+  std::function<void()> setup;
+  std::function<void()> run;
+};
+
+struct Measurement
+{
+  double allocations;
+  double bytes;
+};
+
+static Measurement measure(Operation& operation, int iterations)
+{
+  const int warmup = 4;
+  
+  for (int i = 0; i < warmup; i++)
+  {
+    operation.setup();
+    operation.run();
+  }
+  
+  AllocTally total = { 0, 0 };
+  
+  for (int i = 0; i < iterations; i++)
+  {
+    operation.setup();
+    
+    tally = { 0, 0 };
+    counting = true;
+    operation.run();
+    counting = false;
+    
+    total.allocations += tally.allocations;
+    total.bytes       += tally.bytes;
+  }
+  
+  return { static_cast<double>(total.allocations) / iterations, static_cast<double>(total.bytes) / iterations };
+}
+
+int main(int argc, char** argv)
+{
+  int iterations = 1000;
+  bool reportOnly = false;
+  std::map<std::string, double> budgets;
+  
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    
+    if (arg == "report")
+      reportOnly = true;
+    else if (arg.compare(0, 7, "budget.") == 0 && eq != std::string::npos)
+      budgets[arg.substr(7, eq - 7)] = atof(arg.c_str() + eq + 1);
+    else if (arg.compare(0, 11, "iterations=") == 0)
+      iterations = atoi(arg.c_str() + 11);
+    else
+    {
+      fprintf(stderr, "unknown argument %s\n", argv[i]);
+      return 2;
+    }
+  }
+  
+  const WSString smallPayload(125, 's');
+  const WSString largePayload(64 * 1024, 'L');
+  const WSString smallFrame = encodeFrame(0x1, smallPayload);
+  const WSString largeFrame = encodeFrame(0x2, largePayload);
+  const WSString pingFrame  = encodeFrame(0x9, "ping");
+  
+  // An open client connection on the in-memory transport, messages are received by an empty callback
+  std::shared_ptr<MemoryTcpClient> transport = std::make_shared<MemoryTcpClient>();
+  WebsocketsClient client(transport);
+  
+  client.onMessage([](WebsocketsClient&, WebsocketsMessage) {});
+  
+  // Fresh per handshake call
+  std::shared_ptr<MemoryTcpClient> handshakeTransport;
+  std::unique_ptr<WebsocketsClient> handshakeClient;
+  
+  // Kept across calls, so the request template and the next key are reused like on a reconnect
+  std::shared_ptr<MemoryTcpClient> reconnectTransport = std::make_shared<MemoryTcpClient>();
+  WebsocketsClient reconnectClient(reconnectTransport);
+  MemoryTcpClient* reconnectRaw = reconnectTransport.get();
+  
+  reconnectRaw->onSend = [reconnectRaw](const char* data, size_t len) { answerHandshake(*reconnectRaw, data, len); };
+  
+  MemoryTcpServer* memoryServer = new MemoryTcpServer();
+  WebsocketsServer server(memoryServer);
+  
+  // Refuses every upgrade from onHandshake()
+  MemoryTcpServer* refusingMemoryServer = new MemoryTcpServer();
+  WebsocketsServer refusingServer(refusingMemoryServer);
+  
+  refusingServer.onHandshake([](const HandshakeRequest&) { return HandshakeDecision_Unauthorized; });
+  
+  auto nothing = []() {};
+  
+  std::vector<Operation> operations = 
+  {
+    { "poll_idle",        0,  nothing, [&]() { client.poll(); } },
+    { "send_small",       2,  nothing, [&]() { client.send(smallPayload.data(), smallPayload.size()); } },
+    { "send_large",       2,  nothing, [&]() { client.sendBinary(largePayload.data(), largePayload.size()); } },
+    { "recv_small",       5,  [&]() { transport->feed(smallFrame); }, [&]() { client.poll(); } },
+    { "recv_large",       5,  [&]() { transport->feed(largeFrame); }, [&]() { client.poll(); } },
+    { "ping",             0,  nothing, [&]() { client.ping("ping"); } },
+    { "recv_ping_pong",   0,  [&]() { transport->feed(pingFrame); }, [&]() { client.poll(); } },
+    
+    { "handshake_client", 16,  
+      [&]() 
+      {
+        handshakeClient.reset();
+        handshakeTransport = std::make_shared<MemoryTcpClient>();
+        
+        MemoryTcpClient* raw = handshakeTransport.get();
+        
+        raw->onSend = [raw](const char* data, size_t len) { answerHandshake(*raw, data, len); };
+        handshakeClient.reset(new WebsocketsClient(handshakeTransport));
+      },
+      [&]() { handshakeClient->connect("127.0.0.1", 8080, "/"); } },
+      
+    // the idle poll() in setup prepares the next key, as it would between a drop and the reconnect
+    { "reconnect_client", 8,  [&]() { reconnectClient.poll(); },
+      [&]() { reconnectClient.connect("127.0.0.1", 8080, "/"); } },
+      
+    { "handshake_server", 4,  
+      [&]() 
+      {
+        MemoryTcpClient* accepted = new MemoryTcpClient();
+        
+        accepted->feed(upgradeRequest);
+        memoryServer->next = accepted;
+      },
+      [&]() { server.accept(); } },
+      
+    { "handshake_refused", 3,  
+      [&]() 
+      {
+        MemoryTcpClient* accepted = new MemoryTcpClient();
+        
+        accepted->feed(upgradeRequest);
+        refusingMemoryServer->next = accepted;
+      },
+      [&]() { refusingServer.accept(); } }
+  };
+  
+  bool failed = false;
+  
+  printf("{\n  \"iterations\": %d,\n  \"operations\": [\n", iterations);
+  
+  for (size_t i = 0; i < operations.size(); i++)
+  {
+    Operation& operation = operations[i];
+    
+    if (budgets.count(operation.name))
+      operation.budget = budgets[operation.name];
+      
+    Measurement result = measure(operation, iterations);
+    bool pass = result.allocations <= operation.budget;
+    
+    failed |= !pass;
+    
+    printf("    {\"operation\": \"%s\", \"allocs_per_op\": %.2f, \"bytes_per_op\": %.0f, \"budget\": %.2f, \"pass\": %s}%s\n",
+           operation.name, result.allocations, result.bytes, operation.budget, pass ? "true" : "false", 
+           i + 1 < operations.size() ? "," : "");
+           
+    if (!pass)
+      fprintf(stderr, "%s: %.2f allocations per call, budget is %.2f\n", operation.name, result.allocations, operation.budget);
+  }
+  
+  printf("  ]\n}\n");
+  
+  return failed && !reportOnly ? 1 : 0;
+}
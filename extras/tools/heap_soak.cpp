@@ -0,0 +1,618 @@
+/****************************************************************************************************************************
+  heap_soak.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Soak test against an emulated MCU heap. Everything the library allocates goes to a bounded first-fit
+// heap without compaction (like newlib's malloc on the SAMD/nRF52 cores), while a traffic mix of
+// received, fragmented, answered and retained messages runs for as long as asked. Reports in-use bytes,
+// free bytes and the largest free block over time, the peak usage and the allocations that didn't fit.
+// A failed allocation is served from the host heap so the run continues, on a board it would be fatal.
+//
+// Usage: heap_soak [heap=32768] [messages=1000000] [mix=mixed] [reserve=0] [samples=40] [seed=1]
+//   mix:     telemetry (small text both ways), mixed (8 B - 4 KB, fragments, some retained), 
+//            bulk (1 - 8 KB binary, many fragments)
+//   reserve: bytes taken at start for long lived allocations of the rest of the sketch
+//
+// Host pointers are 8 bytes, so the library's own objects take more room than on a 32 bit board and
+// std::string keeps short strings inline, pick the heap size with that in mind.
+// Replaces the global malloc, so it can't be combined with the sanitizers (glibc only).
+
+#define _WEBSOCKETS_LOGLEVEL_   1
+
+#include <WebSockets2_Generic.h>
+
+#include <new>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace websockets2_generic;
+
+///////////////////////////////////////////////////////////////////
+
+extern "C" 
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void  __libc_free(void* ptr);
+}
+
+// First-fit heap over one fixed block. Blocks are laid out back to back, each with an 8 byte header,
+// free neighbours are merged on free() and while searching, nothing is ever moved.
+class BoundedHeap
+{
+  public:
+    struct Usage
+    {
+      size_t inUse;
+      size_t free;
+      size_t largestFree;
+    };
+    
+    bool init(size_t size)
+    {
+      _size = size & ~static_cast<size_t>(7);
+      _arena = static_cast<uint8_t*>(__libc_malloc(_size));
+      
+      if (!_arena)
+        return false;
+        
+      block(_arena)->size = static_cast<uint32_t>(_size);
+      block(_arena)->used = 0;
+      
+      return true;
+    }
+    
+    bool owns(const void* ptr) const
+    {
+      return ptr >= _arena && ptr < _arena + _size;
+    }
+    
+    void* allocate(size_t size)
+    {
+      size_t need = (size + HEADER_SIZE + 7) & ~static_cast<size_t>(7);
+      
+      if (need < MIN_BLOCK)
+        need = MIN_BLOCK;
+        
+      for (uint8_t* at = _arena; at < _arena + _size; at += block(at)->size)
+      {
+        Block* current = block(at);
+        
+        if (current->used)
+          continue;
+          
+        mergeFollowing(at);
+        
+        if (current->size < need)
+          continue;
+          
+        if (current->size - need >= MIN_BLOCK)
+        {
+          Block* rest = block(at + need);
+          
+          rest->size = static_cast<uint32_t>(current->size - need);
+          rest->used = 0;
+          current->size = static_cast<uint32_t>(need);
+        }
+        
+        current->used = 1;
+        _inUse += current->size;
+        
+        if (_inUse > _peak)
+          _peak = _inUse;
+          
+        return at + HEADER_SIZE;
+      }
+      
+      return nullptr;
+    }
+    
+    void release(void* ptr)
+    {
+      uint8_t* at = static_cast<uint8_t*>(ptr) - HEADER_SIZE;
+      
+      block(at)->used = 0;
+      _inUse -= block(at)->size;
+      
+      mergeFollowing(at);
+    }
+    
+    size_t capacity(const void* ptr) const
+    {
+      return block(static_cast<const uint8_t*>(ptr) - HEADER_SIZE)->size - HEADER_SIZE;
+    }
+    
+    Usage usage()
+    {
+      Usage result = { _inUse, 0, 0 };
+      
+      for (uint8_t* at = _arena; at < _arena + _size; at += block(at)->size)
+      {
+        if (block(at)->used)
+          continue;
+          
+        mergeFollowing(at);
+        
+        result.free += block(at)->size;
+        
+        if (block(at)->size > result.largestFree)
+          result.largestFree = block(at)->size;
+      }
+      
+      // Usable bytes, as a caller of malloc sees them
+      if (result.largestFree >= HEADER_SIZE)
+        result.largestFree -= HEADER_SIZE;
+        
+      return result;
+    }
+    
+    size_t size() const
+    {
+      return _size;
+    }
+    
+    size_t peak() const
+    {
+      return _peak;
+    }
+    
+  private:
+    struct Block
+    {
+      uint32_t size;        // including the header
+      uint32_t used;
+    };
+    
+    static const size_t HEADER_SIZE = sizeof(Block);
+    static const size_t MIN_BLOCK   = 16;
+    
+    uint8_t* _arena = nullptr;
+    size_t _size    = 0;
+    size_t _inUse   = 0;
+    size_t _peak    = 0;
+    
+    static Block* block(uint8_t* at)
+    {
+      return reinterpret_cast<Block*>(at);
+    }
+    
+    static const Block* block(const uint8_t* at)
+    {
+      return reinterpret_cast<const Block*>(at);
+    }
+    
+    void mergeFollowing(uint8_t* at)
+    {
+      Block* current = block(at);
+      
+      while (at + current->size < _arena + _size && !block(at + current->size)->used)
+        current->size += block(at + current->size)->size;
+    }
+};
+
+struct SoakCounters
+{
+  uint64_t allocations;
+  uint64_t failed;
+  uint64_t firstFailedAt;     // message number, 0 = none
+  size_t   largestFailed;
+};
+
+static BoundedHeap heap;
+static SoakCounters counters;
+static uint64_t currentMessage = 0;
+static __thread bool bounded = false;
+
+// Allocations of the harness itself (encoding the inbound frames, printing) stay on the host heap
+class OutsideHeap
+{
+  public:
+    OutsideHeap() : _was(bounded) 
+    { 
+      bounded = false; 
+    }
+    
+    ~OutsideHeap() 
+    { 
+      bounded = _was; 
+    }
+    
+  private:
+    bool _was;
+};
+
+static void* boundedAllocate(size_t size)
+{
+  counters.allocations++;
+  
+  void* ptr = heap.allocate(size);
+  
+  if (ptr)
+    return ptr;
+    
+  if (counters.failed++ == 0)
+    counters.firstFailedAt = currentMessage;
+    
+  if (size > counters.largestFailed)
+    counters.largestFailed = size;
+    
+  return __libc_malloc(size ? size : 1);
+}
+
+extern "C" void* malloc(size_t size)
+{
+  return bounded ? boundedAllocate(size) : __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+  void* ptr = malloc(count * size);
+  
+  if (ptr)
+    memset(ptr, 0, count * size);
+    
+  return ptr;
+}
+
+extern "C" void free(void* ptr)
+{
+  if (heap.owns(ptr))
+    heap.release(ptr);
+  else
+    __libc_free(ptr);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+  if (!ptr)
+    return malloc(size);
+    
+  if (!heap.owns(ptr))
+    return __libc_realloc(ptr, size);
+    
+  if (heap.capacity(ptr) >= size)
+    return ptr;
+    
+  void* moved = malloc(size);
+  
+  if (moved)
+  {
+    memcpy(moved, ptr, heap.capacity(ptr));
+    free(ptr);
+  }
+  
+  return moved;
+}
+
+void* operator new(size_t size)
+{
+  void* ptr = malloc(size ? size : 1);
+  
+  if (!ptr)
+    throw std::bad_alloc();
+    
+  return ptr;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  return malloc(size ? size : 1);
+}
+
+void operator delete(void* ptr) noexcept                          { free(ptr); }
+void operator delete[](void* ptr) noexcept                        { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept                  { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept                { free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept   { free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+
+///////////////////////////////////////////////////////////////////
+
+// The network interface: inbound frames are queued by the harness outside the bounded heap,
+// outbound bytes are dropped
+class SoakTcpClient : public network2_generic::TcpClient
+{
+  public:
+    SoakTcpClient() : _offset(0) {}
+    
+    void feed(const WSString& data)
+    {
+      if (_offset == _inbound.size())
+      {
+        _inbound.clear();
+        _offset = 0;
+      }
+      
+      _inbound.append(data);
+    }
+    
+    bool connect(const WSString&, int) override { return true; }
+    bool poll() override { return _offset < _inbound.size(); }
+    bool available() override { return true; }
+    void close() override {}
+    int getSocket() const override { return -1; }
+    
+    void send(const WSString&) override {}
+    void send(const WSString&&) override {}
+    void send(const uint8_t*, const uint32_t) override {}
+    
+    WSString readLine() override 
+    { 
+      return WSString(); 
+    }
+    
+    uint32_t read(uint8_t* buffer, const uint32_t len) override
+    {
+      size_t count = _inbound.size() - _offset;
+      
+      if (count > len)
+        count = len;
+        
+      memcpy(buffer, _inbound.data() + _offset, count);
+      _offset += count;
+      
+      return static_cast<uint32_t>(count);
+    }
+    
+  private:
+    WSString _inbound;
+    size_t _offset;
+};
+
+static uint32_t rngState = 1;
+
+static uint32_t nextRandom()
+{
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  
+  return rngState;
+}
+
+// Roughly log-uniform in [low, high], small messages are far more common than large ones
+static size_t randomSize(size_t low, size_t high)
+{
+  size_t span = high / low;
+  size_t size = low;
+  
+  while (size < high && span > 1 && (nextRandom() & 1))
+  {
+    size *= 2;
+    span /= 2;
+  }
+  
+  size_t result = size + nextRandom() % size;
+  
+  return result > high ? high : result;
+}
+
+static void appendFrame(WSString& out, bool fin, uint8_t opcode, const char* payload, size_t length)
+{
+  out += static_cast<char>((fin ? 0x80 : 0x00) | opcode);
+  
+  if (length < 126)
+  {
+    out += static_cast<char>(length);
+  }
+  else
+  {
+    out += static_cast<char>(126);
+    out += static_cast<char>(length >> 8);
+    out += static_cast<char>(length & 0xFF);
+  }
+  
+  out.append(payload, length);
+}
+
+struct TrafficMix
+{
+  const char* name;
+  size_t  minSize;
+  size_t  maxSize;
+  bool    binary;
+  int     fragmentPercent;
+  int     replyPercent;
+  int     retainPercent;
+  int     pingEvery;
+};
+
+static const TrafficMix mixes[] = 
+{
+  // name         min   max   binary  fragment  reply  retain  ping
+  { "telemetry",  16,   96,   false,  0,        100,   0,      50  },
+  { "mixed",      8,    4096, false,  10,       30,    10,     100 },
+  { "bulk",       1024, 8192, true,   40,       5,     2,      200 },
+};
+
+// Messages the sketch holds on to for a while, each slot is replaced at random
+static const int RETAINED_SLOTS = 8;
+static WSInterfaceString retained[RETAINED_SLOTS];
+
+int main(int argc, char** argv)
+{
+  size_t heapSize   = 32768;
+  uint64_t messages = 1000000;
+  size_t reserve    = 0;
+  int samples       = 40;
+  const TrafficMix* mix = &mixes[1];
+  
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    std::string value = arg.substr(arg.find('=') + 1);
+    
+    if (arg.compare(0, 5, "heap=") == 0)
+      heapSize = strtoul(value.c_str(), nullptr, 10);
+    else if (arg.compare(0, 9, "messages=") == 0)
+      messages = strtoull(value.c_str(), nullptr, 10);
+    else if (arg.compare(0, 8, "reserve=") == 0)
+      reserve = strtoul(value.c_str(), nullptr, 10);
+    else if (arg.compare(0, 8, "samples=") == 0)
+      samples = atoi(value.c_str());
+    else if (arg.compare(0, 5, "seed=") == 0)
+      rngState = strtoul(value.c_str(), nullptr, 10) | 1;
+    else if (arg.compare(0, 4, "mix=") == 0)
+    {
+      mix = nullptr;
+      
+      for (const TrafficMix& candidate : mixes)
+      {
+        if (value == candidate.name)
+          mix = &candidate;
+      }
+      
+      if (!mix)
+      {
+        fprintf(stderr, "unknown mix %s\n", value.c_str());
+        return 2;
+      }
+    }
+    else
+    {
+      fprintf(stderr, "unknown argument %s\n", argv[i]);
+      return 2;
+    }
+  }
+  
+  if (!heap.init(heapSize) || samples < 1)
+    return 2;
+    
+  std::shared_ptr<SoakTcpClient> transport = std::make_shared<SoakTcpClient>();
+  std::string payload(mix->maxSize, 'x');
+  WSString inbound;
+  
+  inbound.reserve(2 * mix->maxSize + 64);
+  
+  bounded = true;
+  
+  void* reserved = reserve ? malloc(reserve) : nullptr;
+    
+  WebsocketsClient client(transport);
+  
+  client.onMessage([mix](WebsocketsClient& client, WebsocketsMessage message)
+  {
+    if (static_cast<int>(nextRandom() % 100) < mix->replyPercent)
+      client.send(message.data());
+      
+    if (static_cast<int>(nextRandom() % 100) < mix->retainPercent)
+      retained[nextRandom() % RETAINED_SLOTS] = message.data();
+  });
+  
+  uint64_t sampleEvery = messages / samples ? messages / samples : 1;
+  size_t minLargestFree = heap.size();
+  
+  {
+    OutsideHeap outside;
+    
+    printf("{\n  \"heap\": %zu, \"mix\": \"%s\", \"messages\": %llu, \"reserve\": %zu,\n  \"samples\": [\n", 
+           heap.size(), mix->name, static_cast<unsigned long long>(messages), reserve);
+  }
+  
+  for (currentMessage = 1; currentMessage <= messages; currentMessage++)
+  {
+    size_t length = randomSize(mix->minSize, mix->maxSize);
+    uint8_t opcode = mix->binary ? 0x2 : 0x1;
+    
+    {
+      OutsideHeap outside;
+      
+      inbound.clear();
+      
+      if (mix->pingEvery && currentMessage % mix->pingEvery == 0)
+        appendFrame(inbound, true, 0x9, payload.data(), 4);
+        
+      if (length > 64 && static_cast<int>(nextRandom() % 100) < mix->fragmentPercent)
+      {
+        size_t parts = 2 + nextRandom() % 3;
+        size_t part  = length / parts;
+        
+        for (size_t i = 0; i < parts; i++)
+        {
+          size_t partLength = i + 1 < parts ? part : length - part * i;
+          
+          appendFrame(inbound, i + 1 == parts, i == 0 ? opcode : 0x0, payload.data(), partLength);
+        }
+      }
+      else
+      {
+        appendFrame(inbound, true, opcode, payload.data(), length);
+      }
+      
+      transport->feed(inbound);
+    }
+    
+    while (transport->poll() && client.available())
+      client.poll();
+      
+    if (!client.available())
+    {
+      fprintf(stderr, "connection closed at message %llu\n", static_cast<unsigned long long>(currentMessage));
+      return 2;
+    }
+    
+    if (currentMessage % sampleEvery == 0 || currentMessage == messages)
+    {
+      OutsideHeap outside;
+      BoundedHeap::Usage usage = heap.usage();
+      
+      if (usage.largestFree < minLargestFree)
+        minLargestFree = usage.largestFree;
+        
+      printf("    {\"message\": %llu, \"in_use\": %zu, \"free\": %zu, \"largest_free\": %zu, \"fragmentation\": %.3f, "
+             "\"failed\": %llu}%s\n",
+             static_cast<unsigned long long>(currentMessage), usage.inUse, usage.free, usage.largestFree,
+             usage.free ? 1.0 - static_cast<double>(usage.largestFree) / usage.free : 0.0,
+             static_cast<unsigned long long>(counters.failed), currentMessage == messages ? "" : ",");
+    }
+  }
+  
+  bounded = false;
+  free(reserved);
+  
+  printf("  ],\n  \"allocations\": %llu, \"peak_in_use\": %zu, \"min_largest_free\": %zu,\n"
+         "  \"failed_allocations\": %llu, \"first_failure_at_message\": %llu, \"largest_failed_request\": %zu\n}\n",
+         static_cast<unsigned long long>(counters.allocations), heap.peak(), minLargestFree,
+         static_cast<unsigned long long>(counters.failed), static_cast<unsigned long long>(counters.firstFailedAt),
+         counters.largestFailed);
+         
+  return counters.failed ? 1 : 0;
+}
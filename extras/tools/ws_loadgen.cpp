@@ -0,0 +1,633 @@
+/****************************************************************************************************************************
+  ws_loadgen.cpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+// Load generator: opens N WebsocketsClient connections against a server and sends messages of a given size
+// and rate, either as echo round trips or fire-and-forget. Reports msgs/s, MB/s, connect time and
+// round-trip latency percentiles from log-linear (HDR-style) histograms, as JSON.
+//
+// Usage: ws_loadgen [key=value ...]
+//   server=loopback|linux|none  loopback: in-process loopback echo server (default)
+//                               linux:    in-process echo server on real sockets, at host:port
+//                               none:     an external server at host:port
+//   host=127.0.0.1 port=8080 path=/
+//   connections=10 threads=1 seconds=5
+//   size=64          payload bytes per message (echo mode needs at least 8)
+//   rate=0           messages per second per connection, 0 for as fast as possible
+//   inflight=1       echo mode: messages per connection waiting for their echo
+//   mode=echo|fire
+
+#define _WEBSOCKETS_LOGLEVEL_   1
+
+#include <WebSockets2_Generic.h>
+#include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace websockets2_generic;
+using namespace websockets2_generic::network2_generic;
+
+///////////////////////////////////////////////////////////////////
+
+// Log-linear histogram: exact below 128, then 64 linear sub-buckets per power of two (< 1.6 % error)
+class LoadgenHistogram
+{
+  public:
+    LoadgenHistogram() : _counts(SUB_BUCKETS + 58 * HALF_BUCKETS, 0), _total(0), _sum(0), _min(UINT64_MAX), _max(0) {}
+    
+    void record(const uint64_t value)
+    {
+      _counts[indexOf(value)]++;
+      _total++;
+      _sum += value;
+      
+      if (value < _min)
+        _min = value;
+        
+      if (value > _max)
+        _max = value;
+    }
+    
+    void merge(const LoadgenHistogram& other)
+    {
+      for (size_t i = 0; i < _counts.size(); i++)
+        _counts[i] += other._counts[i];
+        
+      _total += other._total;
+      _sum += other._sum;
+      
+      if (other._min < _min)
+        _min = other._min;
+        
+      if (other._max > _max)
+        _max = other._max;
+    }
+    
+    // Highest value of the bucket holding the given percentile
+    uint64_t percentile(const double p) const
+    {
+      if (_total == 0)
+        return 0;
+        
+      uint64_t target = static_cast<uint64_t>(p / 100.0 * _total + 0.5);
+      
+      if (target < 1)
+        target = 1;
+        
+      uint64_t seen = 0;
+      
+      for (size_t i = 0; i < _counts.size(); i++)
+      {
+        seen += _counts[i];
+        
+        if (seen >= target)
+        {
+          uint64_t high = upperBound(i);
+          return high < _max ? high : _max;
+        }
+      }
+      
+      return _max;
+    }
+    
+    uint64_t count() const { return _total; }
+    uint64_t min() const { return _total ? _min : 0; }
+    uint64_t max() const { return _max; }
+    double mean() const { return _total ? static_cast<double>(_sum) / _total : 0.0; }
+    
+  private:
+    static const uint64_t SUB_BUCKETS  = 128;
+    static const uint64_t HALF_BUCKETS = 64;
+    
+    std::vector<uint64_t> _counts;
+    uint64_t _total;
+    uint64_t _sum;
+    uint64_t _min;
+    uint64_t _max;
+    
+    static size_t indexOf(const uint64_t value)
+    {
+      if (value < SUB_BUCKETS)
+        return static_cast<size_t>(value);
+        
+      // shift so that value >> shift lands in [64, 128)
+      const int shift = (63 - __builtin_clzll(value)) - 6;
+      
+      return static_cast<size_t>(SUB_BUCKETS + (shift - 1) * HALF_BUCKETS + ((value >> shift) - HALF_BUCKETS));
+    }
+    
+    static uint64_t upperBound(const size_t index)
+    {
+      if (index < SUB_BUCKETS)
+        return index;
+        
+      const uint64_t shift = (index - SUB_BUCKETS) / HALF_BUCKETS + 1;
+      const uint64_t sub   = (index - SUB_BUCKETS) % HALF_BUCKETS + HALF_BUCKETS;
+      
+      return ((sub + 1) << shift) - 1;
+    }
+};
+
+///////////////////////////////////////////////////////////////////
+
+struct Config
+{
+  std::string server      = "loopback";
+  std::string host        = "127.0.0.1";
+  int         port        = 8080;
+  std::string path        = "/";
+  int         connections = 10;
+  int         threads     = 1;
+  double      seconds     = 5;
+  size_t      size        = 64;
+  double      rate        = 0;
+  int         inflight    = 1;
+  bool        echo        = true;
+};
+
+struct WorkerStats
+{
+  uint64_t sent           = 0;
+  uint64_t received       = 0;
+  uint64_t bytesSent      = 0;
+  uint64_t bytesReceived  = 0;
+  uint64_t failedConnects = 0;
+  uint64_t dropped        = 0;
+  LoadgenHistogram rttUs;
+  LoadgenHistogram connectUs;
+};
+
+struct Connection
+{
+  std::unique_ptr<WebsocketsClient> client;
+  uint64_t nextSendNs = 0;
+  int      inflight   = 0;
+  bool     open       = false;
+};
+
+static uint64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class Worker
+{
+  public:
+    Worker(const Config& config, const int connections) : _config(config), _payload(config.size, 'l')
+    {
+      _connections.resize(connections);
+    }
+    
+    void run(std::atomic<bool>& start, std::atomic<int>& ready)
+    {
+      for (size_t id = 0; id < _connections.size(); id++)
+        open(id);
+        
+      ready++;
+      
+      while (!start)
+        std::this_thread::yield();
+        
+      const uint64_t begin = nowNs();
+      const uint64_t end   = begin + static_cast<uint64_t>(_config.seconds * 1e9);
+      
+      // counts only what happens inside the measured window
+      _stats.sent = _stats.received = _stats.bytesSent = _stats.bytesReceived = 0;
+      
+      for (auto& connection : _connections)
+        connection.nextSendNs = begin;
+        
+      if (_useHub)
+        driveHub(end);
+      else
+        drivePolling(end);
+        
+      _elapsed = (nowNs() - begin) / 1e9;
+      
+      for (auto& connection : _connections)
+      {
+        if (connection.client)
+          connection.client->close();
+      }
+    }
+    
+    const WorkerStats& stats() const { return _stats; }
+    double elapsed() const { return _elapsed; }
+    
+  private:
+    const Config& _config;
+    std::vector<Connection> _connections;
+    WorkerStats _stats;
+    WSString _payload;
+    double _elapsed = 0;
+    bool _useHub = false;
+    
+#ifdef __linux__
+    WebsocketsHub _hub;
+    std::map<int, size_t> _bySocket;
+#endif
+    
+    void open(const size_t id)
+    {
+      Connection& connection = _connections[id];
+      
+      if (_config.server == "loopback")
+        connection.client.reset(new WebsocketsClient(std::make_shared<LoopbackTcpClient>()));
+      else
+        connection.client.reset(new WebsocketsClient());
+        
+      connection.client->onMessage([this, id](WebsocketsClient&, WebsocketsMessage message)
+      {
+        onMessage(id, message);
+      });
+      
+      const uint64_t start = nowNs();
+      connection.open = connection.client->connect(_config.host.c_str(), _config.port, _config.path.c_str());
+      
+      if (!connection.open)
+      {
+        _stats.failedConnects++;
+        return;
+      }
+      
+      _stats.connectUs.record((nowNs() - start) / 1000);
+      
+#ifdef __linux__
+      // real sockets go through epoll, the hub takes the client over
+      if (connection.client->getSocket() >= 0)
+      {
+        _useHub = true;
+        _bySocket[connection.client->getSocket()] = id;
+        _hub.add(*connection.client);
+        connection.client.reset();
+      }
+#endif
+    }
+    
+    void onMessage(const size_t id, const WebsocketsMessage& message)
+    {
+      _stats.received++;
+      _stats.bytesReceived += message.length();
+      
+      if (!_config.echo || message.length() < sizeof(uint64_t))
+        return;
+        
+      uint64_t sentNs;
+      memcpy(&sentNs, message.c_str(), sizeof(sentNs));
+      
+      _stats.rttUs.record((nowNs() - sentNs) / 1000);
+      _connections[id].inflight--;
+    }
+    
+    // Sends what is due on one connection, returns whether anything went out
+    bool pump(WebsocketsClient& client, Connection& connection, const uint64_t now)
+    {
+      bool sent = false;
+      
+      while (now >= connection.nextSendNs && (!_config.echo || connection.inflight < _config.inflight))
+      {
+        if (_payload.size() >= sizeof(uint64_t))
+          memcpy(&_payload[0], &now, sizeof(now));
+          
+        if (!client.sendBinary(_payload.c_str(), _payload.size()))
+        {
+          _stats.dropped++;
+          break;
+        }
+        
+        _stats.sent++;
+        _stats.bytesSent += _payload.size();
+        connection.inflight++;
+        sent = true;
+        
+        if (_config.rate > 0)
+        {
+          connection.nextSendNs += static_cast<uint64_t>(1e9 / _config.rate);
+        }
+        else
+        {
+          connection.nextSendNs = now;
+          
+          // unpaced fire-and-forget: one message per connection and round, so every connection gets its turn
+          if (!_config.echo)
+            break;
+        }
+      }
+      
+      return sent;
+    }
+    
+    void drivePolling(const uint64_t end)
+    {
+      uint64_t now;
+      
+      while ((now = nowNs()) < end)
+      {
+        bool busy = false;
+        
+        for (auto& connection : _connections)
+        {
+          if (!connection.client || !connection.client->available())
+            continue;
+            
+          busy |= pump(*connection.client, connection, now);
+          busy |= connection.client->poll();
+        }
+        
+        // give the in-process server its share of the CPU
+        if (!busy)
+          std::this_thread::yield();
+      }
+    }
+    
+    void driveHub(const uint64_t end)
+    {
+#ifdef __linux__
+      uint64_t now;
+      
+      while ((now = nowNs()) < end)
+      {
+        _hub.forEach([&](WebsocketsClient& client)
+        {
+          auto it = _bySocket.find(client.getSocket());
+          
+          if (it != _bySocket.end())
+            pump(client, _connections[it->second], now);
+        });
+        
+        _hub.poll(_config.rate > 0 ? 1 : 0);
+      }
+#else
+      (void) end;
+#endif
+    }
+};
+
+///////////////////////////////////////////////////////////////////
+
+static std::atomic<bool> serverStop(false);
+
+// Echo server for server=loopback / server=linux
+static void runEchoServer(const Config& config, std::atomic<bool>& listening)
+{
+  if (config.server == "loopback")
+  {
+    WebsocketsServer server(new LoopbackTcpServer());
+    server.listen(config.port);
+    
+    std::vector<std::shared_ptr<WebsocketsClient>> clients;
+    listening = true;
+    
+    while (!serverStop)
+    {
+      while (server.pollHandshakes())
+      {
+        std::shared_ptr<WebsocketsClient> client(new WebsocketsClient(server.acceptReady()));
+        
+        client->onMessage([](WebsocketsClient& client, WebsocketsMessage message)
+        {
+          client.sendBinary(message.c_str(), message.length());
+        });
+        
+        clients.push_back(client);
+      }
+      
+      for (auto& client : clients)
+        client->poll();
+        
+      std::this_thread::yield();
+    }
+    
+    return;
+  }
+  
+#ifdef __linux__
+  WebsocketsServer server(new LinuxTcpServer(1024));
+  server.listen(config.port);
+  
+  WebsocketsHub hub;
+  hub.attach(server);
+  hub.onConnection([](WebsocketsClient& client)
+  {
+    client.onMessage([](WebsocketsClient& client, WebsocketsMessage message)
+    {
+      client.sendBinary(message.c_str(), message.length());
+    });
+  });
+  
+  listening = true;
+  
+  while (!serverStop)
+    hub.poll(10);
+#endif
+}
+
+static void printHistogram(const char* name, const LoadgenHistogram& h, bool last)
+{
+  printf("  \"%s\": {\"count\": %llu, \"min\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, "
+         "\"p999\": %llu, \"max\": %llu}%s\n", name,
+         static_cast<unsigned long long>(h.count()), static_cast<unsigned long long>(h.min()), h.mean(),
+         static_cast<unsigned long long>(h.percentile(50)), static_cast<unsigned long long>(h.percentile(90)),
+         static_cast<unsigned long long>(h.percentile(99)), static_cast<unsigned long long>(h.percentile(99.9)),
+         static_cast<unsigned long long>(h.max()), last ? "" : ",");
+}
+
+// Numeric values must parse completely and lie in range, atoi() would read "1k" or "x" silently
+static bool parseInt(const std::string& text, long minimum, long maximum, long& value)
+{
+  char* end;
+  
+  errno = 0;
+  value = strtol(text.c_str(), &end, 10);
+  
+  return errno == 0 && end != text.c_str() && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+static bool parseDouble(const std::string& text, double minimum, double maximum, double& value)
+{
+  char* end;
+  
+  errno = 0;
+  value = strtod(text.c_str(), &end);
+  
+  return errno == 0 && end != text.c_str() && *end == '\0' && value >= minimum && value <= maximum;
+}
+
+static bool parseOption(Config& config, const std::string& key, const std::string& value)
+{
+  long number;
+  
+  if (key == "server")
+  {
+    config.server = value;
+    return value == "loopback" || value == "linux" || value == "none";
+  }
+  else if (key == "host")
+  {
+    config.host = value;
+    return !value.empty();
+  }
+  else if (key == "path")
+  {
+    config.path = value;
+    return !value.empty() && value[0] == '/';
+  }
+  else if (key == "mode")
+  {
+    config.echo = (value == "echo");
+    return value == "echo" || value == "fire";
+  }
+  else if (key == "seconds")
+    return parseDouble(value, 0.001, 86400, config.seconds);
+  else if (key == "rate")
+    return parseDouble(value, 0, 1e9, config.rate);
+  else if (key == "port" && parseInt(value, 1, 65535, number))
+    config.port = number;
+  else if (key == "connections" && parseInt(value, 1, 1000000, number))
+    config.connections = number;
+  else if (key == "threads" && parseInt(value, 1, 1024, number))
+    config.threads = number;
+  else if (key == "size" && parseInt(value, 0, 64 * 1024 * 1024, number))
+    config.size = number;
+  else if (key == "inflight" && parseInt(value, 1, 100000, number))
+    config.inflight = number;
+  else
+    return false;
+    
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  Config config;
+  
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    
+    if (eq == std::string::npos || !parseOption(config, arg.substr(0, eq), arg.substr(eq + 1)))
+    {
+      fprintf(stderr, "invalid argument %s\n"
+                      "usage: %s [server=loopback|linux|none] [host=127.0.0.1] [port=8080] [path=/] [connections=10]\n"
+                      "       [threads=1] [seconds=5] [size=64] [rate=0] [inflight=1] [mode=echo|fire]\n", argv[i], argv[0]);
+      return 2;
+    }
+  }
+  
+  if (config.echo && config.size < sizeof(uint64_t))
+  {
+    fprintf(stderr, "echo mode carries a timestamp, size raised to %zu\n", sizeof(uint64_t));
+    config.size = sizeof(uint64_t);
+  }
+  
+  std::thread serverThread;
+  
+  if (config.server != "none")
+  {
+    std::atomic<bool> listening(false);
+    serverThread = std::thread([&]() { runEchoServer(config, listening); });
+    
+    while (!listening)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<bool> start(false);
+  std::atomic<int> ready(0);
+  
+  for (int t = 0; t < config.threads; t++)
+  {
+    int share = config.connections / config.threads + (t < config.connections % config.threads ? 1 : 0);
+    workers.emplace_back(new Worker(config, share));
+  }
+  
+  for (auto& worker : workers)
+  {
+    Worker* w = worker.get();
+    threads.emplace_back([&, w]() { w->run(start, ready); });
+  }
+  
+  while (ready < config.threads)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    
+  start = true;
+  
+  for (auto& thread : threads)
+    thread.join();
+    
+  serverStop = true;
+  
+  if (serverThread.joinable())
+    serverThread.join();
+    
+  WorkerStats total;
+  double elapsed = 0;
+  
+  for (auto& worker : workers)
+  {
+    const WorkerStats& s = worker->stats();
+    
+    total.sent            += s.sent;
+    total.received        += s.received;
+    total.bytesSent       += s.bytesSent;
+    total.bytesReceived   += s.bytesReceived;
+    total.failedConnects  += s.failedConnects;
+    total.dropped         += s.dropped;
+    total.rttUs.merge(s.rttUs);
+    total.connectUs.merge(s.connectUs);
+    
+    if (worker->elapsed() > elapsed)
+      elapsed = worker->elapsed();
+  }
+  
+  printf("{\n");
+  printf("  \"server\": \"%s\", \"mode\": \"%s\", \"connections\": %d, \"threads\": %d, \"size\": %zu, \"rate\": %.1f, \"inflight\": %d,\n",
+         config.server.c_str(), config.echo ? "echo" : "fire", config.connections, config.threads, config.size, config.rate, config.inflight);
+  printf("  \"seconds\": %.3f, \"failed_connects\": %llu, \"dropped\": %llu,\n", elapsed,
+         static_cast<unsigned long long>(total.failedConnects), static_cast<unsigned long long>(total.dropped));
+  printf("  \"sent_msgs_per_sec\": %.0f, \"received_msgs_per_sec\": %.0f, \"sent_mb_per_sec\": %.2f, \"received_mb_per_sec\": %.2f,\n",
+         total.sent / elapsed, total.received / elapsed, total.bytesSent / elapsed / 1e6, total.bytesReceived / elapsed / 1e6);
+  printHistogram("connect_us", total.connectUs, false);
+  printHistogram("rtt_us", total.rttUs, true);
+  printf("}\n");
+  
+  return 0;
+}
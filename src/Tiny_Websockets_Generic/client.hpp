@@ -68,12 +68,17 @@
   #warning WEBSOCKETS_USE_WIFININA in client.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common_WiFiNINA.hpp>
 #else
-  #warning WEBSOCKETS_USE_ESP_WIFI in client.hpp
+  #if !( defined(__linux__) || defined(_WIN32) )
+    #warning WEBSOCKETS_USE_ESP_WIFI in client.hpp
+  #endif
   #include <Tiny_Websockets_Generic/internals/ws_common.hpp>  
 #endif
 //////
 
-
+// Frames one poll() reads at most, a peer that keeps sending can't hold the caller's loop
+#ifndef WS_CLIENT_POLL_BUDGET
+  #define WS_CLIENT_POLL_BUDGET   64
+#endif
 
 namespace websockets2_generic 
 {
@@ -114,7 +119,16 @@ namespace websockets2_generic
       void onEvent(const EventCallback callback);
       void onEvent(const PartialEventCallback callback);
   
+      // Reads up to WS_CLIENT_POLL_BUDGET frames, call it again for the rest
       bool poll();
+      
+      // poll() with a budget of maxFrames (0 reads until the socket has nothing left), numFrames returns how
+      // many were read
+      bool pollFrames(const size_t maxFrames, size_t& numFrames);
+      
+      // More to read without waiting for the socket to be reported again, once a budget stopped poll(). Also
+      // true while the inbound limits hold the data back
+      bool hasPendingData();
       bool available(const bool activeTest = false);
   
       bool send(const WSInterfaceString&& data);
@@ -144,11 +158,77 @@ namespace websockets2_generic
   
       void close(const CloseReason reason = CloseReason_NormalClosure);
       CloseReason getCloseReason() const;
+      
+      // Closing handshake without tearing the socket down: sends the close frame and stays open until the
+      // peer's close frame answers it (ConnectionClosed fires then, as usual), so keep polling. close()
+      // gives up waiting. Only ping() and pong() work in between, a ping from the peer is still answered
+      void beginClose(const CloseReason reason = CloseReason_NormalClosure);
+      
+      // beginClose() is waiting for the peer
+      bool closing();
   
       void setUseMasking(bool useMasking) 
       {
         _endpoint.setUseMasking(useMasking);
       }
+      
+      // Budget for the messages this connection receives, see InboundLimits. Replaces the one set by the
+      // server that accepted it
+      void setInboundLimits(const InboundLimits& limits) 
+      {
+        _endpoint.setInboundLimits(limits);
+      }
+      
+      const InboundLimits& getInboundLimits() const 
+      {
+        return _endpoint.getInboundLimits();
+      }
+      
+      // Milliseconds until a connection held back by RateLimitPolicy_Delay reads again, 0 when it isn't
+      uint32_t inboundWaitTime() 
+      {
+        return _endpoint.inboundWaitTime();
+      }
+      
+      // Socket tuning, see network2_generic::TransportOptions. Returns the options the backend ignored
+      uint16_t setTransportOptions(const network2_generic::TransportOptions& options);
+      
+      // Sends that never wait for a slow peer, for event loops. See TcpClient::setSendQueueLimit()
+      void setSendQueueLimit(const uint32_t limit)
+      {
+        if (_client)
+          _client->setSendQueueLimit(limit);
+      }
+      
+      // Bytes sent but still queued, flushSend() writes what the socket takes and is true once none are left
+      uint32_t pendingSend() const
+      {
+        return _client ? _client->pendingSend() : 0;
+      }
+      
+      bool flushSend()
+      {
+        return !_client || _client->flushSend();
+      }
+  
+      // Underlying socket descriptor (-1 when not connected or not supported by the stack)
+      int getSocket() const
+      {
+        return _client ? _client->getSocket() : -1;
+      }
+      
+  #if _WEBSOCKETS_LATENCY_STATS_
+      // Receive latency per stage of this connection, filled by poll()
+      const WebsocketsLatencyStats& getLatencyStats() const
+      {
+        return *_latencyStats;
+      }
+      
+      void resetLatencyStats()
+      {
+        _latencyStats->reset();
+      }
+  #endif
   
       void setInsecure();
   #ifdef ESP8266
@@ -179,6 +259,19 @@ namespace websockets2_generic
     
       std::shared_ptr<network2_generic::TcpClient> _client;
       std::vector<std::pair<WSString, WSString>> _customHeaders;
+      
+      // Upgrade request compiled on the first connect() and when headers change, only the key is
+      // patched in per attempt
+      WSString _handshakeTemplate;
+      WSString _handshakeHost;
+      WSString _handshakePath;
+      size_t _handshakeKeyOffset = 0;
+      bool _handshakeDirty = true;
+      
+      // Key of the next connect() and the accept value the server has to answer it with
+      WSString _nextKey;
+      WSString _nextAccept;
+      
       internals2_generic::WebsocketsEndpoint _endpoint;
       bool _connectionOpen;
       MessageCallback _messagesCallback;
@@ -188,6 +281,16 @@ namespace websockets2_generic
         SendMode_Normal,
         SendMode_Streaming
       } _sendMode;
+      
+      network2_generic::TransportOptions _transportOptions;
+      
+  #if _WEBSOCKETS_LATENCY_STATS_
+      std::shared_ptr<WebsocketsLatencyStats> _latencyStats;
+      // Totals of the server that accepted this connection, if any
+      std::shared_ptr<WebsocketsLatencyStats> _serverLatencyStats;
+      
+      void _recordLatency(const uint32_t enteredAt, const uint32_t returnedAt);
+  #endif
   
   
   #ifdef ESP8266
@@ -212,6 +315,11 @@ namespace websockets2_generic
       void _handleClose(WebsocketsMessage);
   
       void upgradeToSecuredConnection();
+      
+      void prepareHandshake(const WSString& host, const WSString& path);
+      void prepareNextKey();
+      
+      friend class WebsocketsServer;
   };
 }   // namespace websockets2_generic 
 
@@ -0,0 +1,205 @@
+/****************************************************************************************************************************
+  hub.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+#ifndef _HUB_HPP_
+#define _HUB_HPP_
+
+#pragma once
+
+#ifdef __linux__
+
+#include <Tiny_Websockets_Generic/client.hpp>
+#include <Tiny_Websockets_Generic/server.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#ifndef WS_HUB_MAX_EVENTS
+  #define WS_HUB_MAX_EVENTS     256
+#endif
+
+// Frames read from one connection before the others get their turn
+#ifndef WS_HUB_POLL_BUDGET
+  #define WS_HUB_POLL_BUDGET    16
+#endif
+
+// Bytes a connection may have queued for a peer that doesn't read before it is closed, see setSendQueueLimit()
+#ifndef WS_HUB_SEND_QUEUE_LIMIT
+  #define WS_HUB_SEND_QUEUE_LIMIT     WS_SERVER_SEND_QUEUE_LIMIT
+#endif
+
+namespace websockets2_generic
+{
+  typedef std::function<void(WebsocketsClient&)> ConnectionCallback;
+  typedef std::function<void()> TimerCallback;
+  typedef std::function<void(uint32_t)> WatchCallback;
+  
+  // Single threaded event loop for many connections. Every socket is registered with
+  // edge-triggered epoll, so idle connections cost nothing until the kernel reports them.
+  class WebsocketsHub 
+  {
+    public:
+      WebsocketsHub(const size_t maxEvents = WS_HUB_MAX_EVENTS);
+  
+      WebsocketsHub(const WebsocketsHub& other) = delete;
+      WebsocketsHub(const WebsocketsHub&& other) = delete;
+  
+      WebsocketsHub& operator=(const WebsocketsHub& other) = delete;
+      WebsocketsHub& operator=(const WebsocketsHub&& other) = delete;
+  
+      bool available() const;
+  
+      // Accept (and handshake) new connections whenever the server's socket becomes readable
+      bool attach(WebsocketsServer& server);
+      void onConnection(const ConnectionCallback callback);
+  
+      // Takes over the connection, the same way WebsocketsClient's copy does
+      bool add(WebsocketsClient& client);
+      size_t size() const;
+      
+      // Sends from the loop never wait: what a full socket doesn't take is queued and written once epoll reports
+      // it writable, and a peer with more than limit bytes queued is closed. Applies to connections added from
+      // now on, WS_HUB_SEND_QUEUE_LIMIT by default
+      void setSendQueueLimit(const uint32_t limit);
+  
+      // Calls `callback` on every connection owned by the hub
+      void forEach(const std::function<void(WebsocketsClient&)> callback);
+  
+      // Timers share the loop as timerfds, a repeating one fires at most every millisecond. Returns an id for
+      // cancelTimer(), or -1
+      int addTimer(const uint32_t intervalMs, const TimerCallback callback, const bool repeat = true);
+      void cancelTimer(const int id);
+  
+      // Millisecond timers run by poll(), which never sleeps past the next one. Unlike addTimer() they cost
+      // no descriptor and no system call to arm or cancel, so every connection can have its own (heartbeat,
+      // pong timeout, close timeout)
+      WebsocketsTimerWheel& timers()
+      {
+        return _timers;
+      }
+      
+      // Connections that received nothing for timeoutMs are closed with GoingAway, 0 (the default) never
+      void setIdleTimeout(const uint32_t timeoutMs);
+      
+      // Pings connections that received nothing for intervalMs and closes those that stay silent for timeoutMs
+      // more, see WebsocketsServer::setHeartbeat(). 0 (the default) turns it off
+      void setHeartbeat(const uint32_t intervalMs, const uint32_t timeoutMs = 0);
+      
+      // A connection whose beginClose() got no close frame back within timeoutMs is closed, counted from the
+      // hub's next look at it (a read, forEach() or onConnection()). 0 (the default) waits as long as the peer
+      // keeps the socket
+      void setCloseTimeout(const uint32_t timeoutMs);
+  
+      // Any other descriptor (eventfd, pipe, ...) can be dispatched from the same loop
+      bool watch(const int fd, const WatchCallback callback, const uint32_t events = EPOLLIN);
+      void unwatch(const int fd);
+  
+      // Graceful shutdown, see WebsocketsServer::drain(): the attached servers stop listening and refuse
+      // handshakes in progress, every connection gets GoingAway in one pass, then poll() runs until their
+      // close frames came back or timeoutMs passed and the rest is closed. Returns how many were still open
+      size_t drain(const uint32_t timeoutMs = WS_SERVER_DRAIN_TIMEOUT_MS);
+  
+      // Waits up to timeoutMs (-1 forever) and dispatches ready sockets and due timers() only.
+      // Returns the number of handled events and timers
+      size_t poll(const int timeoutMs = -1);
+  
+      virtual ~WebsocketsHub();
+  
+    private:
+      struct Entry 
+      {
+        enum Kind 
+        {
+          Kind_Client,
+          Kind_Server,
+          Kind_Handshake,
+          Kind_Timer,
+          Kind_Watch
+        } kind;
+        
+        int fd;
+        bool dead;
+        bool backlogged;
+        bool repeat;
+        std::unique_ptr<WebsocketsClient> client;
+        WebsocketsServer* server;
+        TimerCallback timerCallback;
+        WatchCallback watchCallback;
+        
+        // clients only, pushed back lazily like the server's
+        uint64_t lastActivity;
+        WebsocketsTimer idleTimer;
+        WebsocketsTimer heartbeatTimer;
+        uint64_t pingSentAt;
+        WebsocketsTimer closeTimer;
+      };
+  
+      int _epoll;
+      std::vector<struct epoll_event> _events;
+      
+      // indexed by descriptor, descriptors are small and dense
+      std::vector<Entry*> _entries;
+      
+      // entries released while dispatching, freed once the batch is done
+      std::vector<Entry*> _graveyard;
+      
+      // connections that used up their budget with data left, revisited on the next poll()
+      std::vector<Entry*> _backlog;
+      
+      // attached servers, asked for asynchronous completions after every batch
+      std::vector<WebsocketsServer*> _servers;
+      size_t _numClients;
+      ConnectionCallback _connectionCallback;
+      
+      WebsocketsTimerWheel _timers;
+      uint32_t _idleTimeoutMs;
+      uint32_t _heartbeatMs;
+      uint32_t _heartbeatTimeoutMs;
+      uint32_t _closeTimeoutMs;
+      uint32_t _sendQueueLimit;
+  
+      bool insert(Entry* entry, const uint32_t events);
+      void release(Entry* entry);
+      void dispatch(Entry* entry, const uint32_t events);
+      void acceptAll(WebsocketsServer& server, const int socket);
+      void dispatchCompletions(WebsocketsServer& server);
+      void expireIdle(Entry* entry);
+      void heartbeat(Entry* entry);
+      void watchClose(Entry* entry);
+      void expireClose(Entry* entry);
+  };
+}     // namespace websockets2_generic
+
+#endif    // #ifdef __linux__
+
+#endif    // _HUB_HPP_
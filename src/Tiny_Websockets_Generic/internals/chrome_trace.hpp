@@ -0,0 +1,332 @@
+/****************************************************************************************************************************
+  chrome_trace.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+// Host only: writes the records of the trace ring (ws_trace.hpp) as Chrome trace-event JSON, to be opened
+// in https://ui.perfetto.dev or chrome://tracing. Every connection gets its own track with "connect",
+// "handshake", "open" and "fragmented message" slices, frames / pings / pongs / closes are instants.
+//
+// Build with _WEBSOCKETS_TRACE_MASK_ 0x0F and call drain() often enough (e.g. once per poll loop) that
+// the ring doesn't wrap, overwritten records show up as "trace.dropped" instants.
+//
+//   ChromeTraceWriter trace;
+//   trace.open("ws_trace.json");
+//   while (running) { client.poll(); trace.drain(); }
+//   trace.close();
+
+#include <WebSockets2_Generic.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <map>
+
+namespace websockets2_generic
+{
+  class ChromeTraceWriter 
+  {
+    public:
+      ChromeTraceWriter() : _out(nullptr), _firstEvent(true), _started(false), _lastTimestamp(0), _lastMicros(0), _dropped(0), _lastTid(0) {}
+      
+      ~ChromeTraceWriter() 
+      {
+        close();
+      }
+      
+      bool open(const char* path) 
+      {
+        close();
+        
+        _out = fopen(path, "w");
+        
+        if (!_out)
+          return false;
+        
+        _firstEvent     = true;
+        _started        = false;
+        _lastTimestamp  = 0;
+        _lastMicros     = 0;
+        _dropped        = WebsocketsTrace::dropped();
+        _lastTid        = 0;
+        _tracks.clear();
+        
+        fprintf(_out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+        writeTrackName(0, "websockets");
+        
+        return true;
+      }
+      
+      // Moves everything recorded so far into the file, returns the number of records
+      size_t drain() 
+      {
+        if (!_out)
+          return 0;
+          
+        TraceRecord records[64];
+        size_t total = 0;
+        size_t count;
+        
+        while ((count = WebsocketsTrace::read(records, 64)) > 0)
+        {
+          for (size_t i = 0; i < count; i++)
+            writeRecord(records[i]);
+            
+          total += count;
+        }
+        
+        const uint32_t dropped = WebsocketsTrace::dropped();
+        
+        if (dropped != _dropped)
+        {
+          beginEvent("trace.dropped", "i", 0, _lastTimestamp);
+          fprintf(_out, ", \"s\": \"g\", \"args\": {\"records\": %lu}}", (unsigned long) (dropped - _dropped));
+          _dropped = dropped;
+        }
+        
+        return total;
+      }
+      
+      void close() 
+      {
+        if (!_out)
+          return;
+          
+        drain();
+        
+        // Slices still open at the end of the capture
+        for (auto& track : _tracks)
+        {
+          for (int i = 0; i < Slice_Count; i++)
+          {
+            if (track.second.open[i])
+              writeSlice(static_cast<Slice>(i), "E", track.second.tid, _lastTimestamp);
+          }
+        }
+        
+        fprintf(_out, "\n]}\n");
+        fclose(_out);
+        _out = nullptr;
+      }
+      
+    private:
+      enum Slice 
+      {
+        Slice_Connect,
+        Slice_Handshake,
+        Slice_Open,
+        Slice_Fragments,
+        
+        Slice_Count
+      };
+      
+      struct Track 
+      {
+        uint32_t tid;
+        bool open[Slice_Count];
+      };
+      
+      FILE* _out;
+      bool _firstEvent;
+      bool _started;
+      uint64_t _lastTimestamp;
+      uint32_t _lastMicros;
+      uint32_t _dropped;
+      uint32_t _lastTid;
+      std::map<uint32_t, Track> _tracks;
+      
+      Track& track(const uint32_t connection) 
+      {
+        auto found = _tracks.find(connection);
+        
+        if (found != _tracks.end())
+          return found->second;
+          
+        // records not tied to a connection share track 0
+        const uint32_t tid = connection ? ++_lastTid : 0;
+        Track& track = _tracks[connection];
+        
+        track.tid = tid;
+        
+        for (int i = 0; i < Slice_Count; i++)
+          track.open[i] = false;
+        
+        if (connection)
+        {
+          char name[32];
+          
+          snprintf(name, sizeof(name), "connection %lu", (unsigned long) tid);
+          writeTrackName(tid, name);
+        }
+        
+        return track;
+      }
+      
+      // micros() wraps every ~71 minutes and records from several threads may be slightly out of order,
+      // so each record is placed relative to the newest one seen
+      uint64_t timestamp(const uint32_t micros) 
+      {
+        if (!_started)
+        {
+          _started        = true;
+          _lastTimestamp  = micros;
+          _lastMicros     = micros;
+          
+          return micros;
+        }
+        
+        const int32_t delta = static_cast<int32_t>(micros - _lastMicros);
+        const uint64_t timestamp = _lastTimestamp + delta;
+        
+        if (delta > 0)
+        {
+          _lastTimestamp  = timestamp;
+          _lastMicros     = micros;
+        }
+        
+        return timestamp;
+      }
+      
+      void beginEvent(const char* name, const char* phase, const uint32_t tid, const uint64_t ts) 
+      {
+        fprintf(_out, "%s{\"name\": \"%s\", \"ph\": \"%s\", \"pid\": %d, \"tid\": %lu, \"ts\": %llu", 
+                _firstEvent ? "" : ",\n", name, phase, (int) getpid(), (unsigned long) tid, (unsigned long long) ts);
+        _firstEvent = false;
+      }
+      
+      void writeTrackName(const uint32_t tid, const char* name) 
+      {
+        fprintf(_out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %lu, \"args\": {\"name\": \"%s\"}}",
+                _firstEvent ? "" : ",\n", (int) getpid(), (unsigned long) tid, name);
+        _firstEvent = false;
+      }
+      
+      void writeSlice(const Slice slice, const char* phase, const uint32_t tid, const uint64_t ts) 
+      {
+        static const char* const names[Slice_Count] = { "connect", "handshake", "open", "fragmented message" };
+        
+        beginEvent(names[slice], phase, tid, ts);
+        fprintf(_out, "}");
+      }
+      
+      void setSlice(Track& track, const Slice slice, const bool open, const uint64_t ts) 
+      {
+        if (track.open[slice] == open)
+          return;
+          
+        track.open[slice] = open;
+        writeSlice(slice, open ? "B" : "E", track.tid, ts);
+      }
+      
+      void writeRecord(const TraceRecord& record) 
+      {
+        const uint64_t ts = timestamp(record.timestamp);
+        
+        // The TcpClient address of a finished connection can be reused by the next one, give it a new track
+        if (record.connection && (record.id == TraceEvent_ConnectStarted || record.id == TraceEvent_HandshakeRequestStarted))
+          _tracks.erase(record.connection);
+          
+        Track& current = track(record.connection);
+        const uint32_t tid = current.tid;
+        
+        // Slices ending here close before the instant, slices starting here open before it
+        switch (record.id)
+        {
+          case TraceEvent_ConnectStarted:
+            setSlice(current, Slice_Connect, true, ts);
+            break;
+            
+          case TraceEvent_HandshakeRequestStarted:
+            setSlice(current, Slice_Handshake, true, ts);
+            break;
+            
+          case TraceEvent_HandshakeAccepted:
+          case TraceEvent_HandshakeRejected:
+            setSlice(current, Slice_Handshake, false, ts);
+            break;
+            
+          case TraceEvent_TcpConnected:
+            if (!record.arg0)
+              setSlice(current, Slice_Connect, false, ts);
+            break;
+            
+          case TraceEvent_ConnectionOpened:
+            setSlice(current, Slice_Connect, false, ts);
+            break;
+            
+          case TraceEvent_FragmentsStarted:
+            setSlice(current, Slice_Fragments, true, ts);
+            break;
+            
+          case TraceEvent_ConnectionClosed:
+            setSlice(current, Slice_Fragments, false, ts);
+            setSlice(current, Slice_Open, false, ts);
+            setSlice(current, Slice_Connect, false, ts);
+            break;
+            
+          default:
+            break;
+        }
+        
+        beginEvent(WebsocketsTrace::eventName(record.id), "i", tid, ts);
+        fprintf(_out, ", \"s\": \"t\", \"args\": {");
+        
+        bool firstArg = true;
+        
+        for (int i = 0; i < 3; i++)
+        {
+          const char* name = WebsocketsTrace::argName(record.id, i);
+          char text[16];
+          
+          if (!name)
+            continue;
+            
+          fprintf(_out, "%s\"%s\": \"%s\"", firstArg ? "" : ", ", name, WebsocketsTrace::argText(record, i, text, sizeof(text)));
+          firstArg = false;
+        }
+        
+        fprintf(_out, "}}");
+        
+        switch (record.id)
+        {
+          case TraceEvent_ConnectionOpened:
+            setSlice(current, Slice_Open, true, ts);
+            break;
+            
+          case TraceEvent_FragmentsEnded:
+            setSlice(current, Slice_Fragments, false, ts);
+            break;
+            
+          default:
+            break;
+        }
+      }
+  };
+}     // namespace websockets2_generic
@@ -0,0 +1,341 @@
+/****************************************************************************************************************************
+  http_header_parser.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+#include <Tiny_Websockets_Generic/internals/ws_trace.hpp>
+
+#include <string.h>
+
+// Headers kept per parse, further ones are still validated and traced but can't be looked up
+#ifndef WS_HTTP_MAX_HEADERS
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define WS_HTTP_MAX_HEADERS     32
+  #else
+    #define WS_HTTP_MAX_HEADERS     16
+  #endif
+#endif
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+    // Header names the handshakes look at, same values as TraceHeader
+    enum HttpHeader 
+    {
+      HttpHeader_Other,
+      HttpHeader_Host,
+      HttpHeader_Upgrade,
+      HttpHeader_Connection,
+      HttpHeader_Key,
+      HttpHeader_Version,
+      HttpHeader_Accept,
+      HttpHeader_Protocol,
+      HttpHeader_Extensions,
+      HttpHeader_Authorization,
+      HttpHeader_Origin,
+      HttpHeader_UserAgent,
+      HttpHeader_Count
+    };
+    
+    // Bytes of a buffer owned by someone else
+    struct HttpStringView 
+    {
+      const char* data;
+      size_t size;
+      
+      bool empty() const 
+      {
+        return size == 0;
+      }
+      
+      bool equals(const char* text, const size_t len) const 
+      {
+        return size == len && memcmp(data, text, len) == 0;
+      }
+      
+      bool equals(const WSString& text) const 
+      {
+        return equals(text.data(), text.size());
+      }
+      
+      bool equalsIgnoreCase(const char* text, const size_t len) const 
+      {
+        if (size != len)
+          return false;
+          
+        for (size_t i = 0; i < len; i++) 
+        {
+          if (toLower(data[i]) != toLower(text[i]))
+            return false;
+        }
+        
+        return true;
+      }
+      
+      bool equalsIgnoreCase(const char* text) const 
+      {
+        return equalsIgnoreCase(text, strlen(text));
+      }
+      
+      bool startsWith(const char* prefix) const 
+      {
+        const size_t len = strlen(prefix);
+        
+        return size >= len && memcmp(data, prefix, len) == 0;
+      }
+      
+      // Whether the comma separated list holds token, e.g. "Upgrade" in "keep-alive, Upgrade"
+      bool hasToken(const char* token) const 
+      {
+        const size_t len = strlen(token);
+        size_t start = 0;
+        
+        while (start < size) 
+        {
+          size_t end = start;
+          
+          while (end < size && data[end] != ',')
+            end++;
+            
+          HttpStringView item = { data + start, end - start };
+          
+          if (item.trimmed().equalsIgnoreCase(token, len))
+            return true;
+            
+          start = end + 1;
+        }
+        
+        return false;
+      }
+      
+      // Without surrounding spaces, tabs and line endings
+      HttpStringView trimmed() const 
+      {
+        size_t first = 0, last = size;
+        
+        while (first < last && isSpace(data[first]))
+          first++;
+          
+        while (last > first && isSpace(data[last - 1]))
+          last--;
+          
+        return { data + first, last - first };
+      }
+      
+      WSString toString() const 
+      {
+        return WSString(data, size);
+      }
+      
+      static char toLower(const char ch) 
+      {
+        return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+      }
+      
+      static bool isSpace(const char ch) 
+      {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+      }
+    };
+    
+    // Splits an HTTP head (start line and headers, up to the empty line) into views over the caller's
+    // buffer. Nothing is copied or allocated, the buffer has to outlive the parser.
+    class HttpHeaderParser 
+    {
+      public:
+        HttpHeaderParser() : _count(0) 
+        {
+          clear();
+        }
+        
+        // Header names match case-insensitively, values are trimmed and kept as sent. A later line of
+        // a known header replaces the earlier one. traceEvent (0 for none) is recorded for every header.
+        // Returns false for a header line without ':'.
+        bool parse(const char* data, const size_t len, const uint16_t traceEvent = 0, const void* traceConnection = nullptr) 
+        {
+          clear();
+          
+          const char* end = data + len;
+          const char* line = data;
+          const char* lineEnd = nextLine(line, end);
+          
+          _startLine = HttpStringView { line, static_cast<size_t>(lineEnd - line) }.trimmed();
+          
+          for (line = lineEnd; line < end; line = lineEnd) 
+          {
+            lineEnd = nextLine(line, end);
+            
+            HttpStringView content = HttpStringView { line, static_cast<size_t>(lineEnd - line) }.trimmed();
+            
+            // the empty line ends the head
+            if (content.empty())
+              break;
+              
+            const char* colon = static_cast<const char*>(memchr(content.data, ':', content.size));
+            
+            if (!colon)
+              return false;
+              
+            HttpStringView name  = HttpStringView { content.data, static_cast<size_t>(colon - content.data) }.trimmed();
+            HttpStringView value = HttpStringView { colon + 1, static_cast<size_t>(content.data + content.size - colon - 1) }.trimmed();
+            
+            const HttpHeader header = classify(name.data, name.size);
+            
+            if (header != HttpHeader_Other)
+              _known[header] = value;
+              
+            if (_count < WS_HTTP_MAX_HEADERS) 
+            {
+              _names[_count]  = name;
+              _values[_count] = value;
+            }
+            
+            _count++;
+            
+            WSTRACE(traceEvent, traceConnection, header, value.size, name.size);
+            
+            // avoid an unused warning when tracing is compiled out
+            (void) traceEvent;
+            (void) traceConnection;
+          }
+          
+          return true;
+        }
+        
+        const HttpStringView& startLine() const 
+        {
+          return _startLine;
+        }
+        
+        // Empty view when the header wasn't sent
+        const HttpStringView& get(const HttpHeader header) const 
+        {
+          return _known[header];
+        }
+        
+        bool has(const HttpHeader header) const 
+        {
+          return _known[header].data != nullptr;
+        }
+        
+        // Any header, by case-insensitive name. Empty view when not found
+        HttpStringView get(const char* name) const 
+        {
+          const size_t len = strlen(name);
+          
+          for (size_t i = 0; i < headersKept(); i++) 
+          {
+            if (_names[i].equalsIgnoreCase(name, len))
+              return _values[i];
+          }
+          
+          return { nullptr, 0 };
+        }
+        
+        // Every header line, including the ones beyond WS_HTTP_MAX_HEADERS
+        size_t headerCount() const 
+        {
+          return _count;
+        }
+        
+        size_t headersKept() const 
+        {
+          return _count < WS_HTTP_MAX_HEADERS ? _count : WS_HTTP_MAX_HEADERS;
+        }
+        
+        const HttpStringView& headerName(const size_t index) const 
+        {
+          return _names[index];
+        }
+        
+        const HttpStringView& headerValue(const size_t index) const 
+        {
+          return _values[index];
+        }
+        
+        static HttpHeader classify(const char* name, const size_t len) 
+        {
+          HttpStringView view = { name, len };
+          
+          for (size_t i = 1; i < HttpHeader_Count; i++) 
+          {
+            if (view.equalsIgnoreCase(headerNames()[i]))
+              return static_cast<HttpHeader>(i);
+          }
+          
+          return HttpHeader_Other;
+        }
+        
+        static const char* name(const HttpHeader header) 
+        {
+          return header < HttpHeader_Count ? headerNames()[header] : headerNames()[HttpHeader_Other];
+        }
+        
+      private:
+        HttpStringView _startLine;
+        HttpStringView _known[HttpHeader_Count];
+        HttpStringView _names[WS_HTTP_MAX_HEADERS];
+        HttpStringView _values[WS_HTTP_MAX_HEADERS];
+        size_t _count;
+        
+        static const char* const* headerNames() 
+        {
+          static const char* const names[HttpHeader_Count] = 
+          {
+            "other", "Host", "Upgrade", "Connection", "Sec-WebSocket-Key", "Sec-WebSocket-Version",
+            "Sec-WebSocket-Accept", "Sec-WebSocket-Protocol", "Sec-WebSocket-Extensions", "Authorization",
+            "Origin", "User-Agent"
+          };
+          
+          return names;
+        }
+        
+        void clear() 
+        {
+          _startLine = { nullptr, 0 };
+          _count = 0;
+          
+          for (size_t i = 0; i < HttpHeader_Count; i++)
+            _known[i] = { nullptr, 0 };
+        }
+        
+        // Start of the line after the one at line
+        static const char* nextLine(const char* line, const char* end) 
+        {
+          const char* newline = static_cast<const char*>(memchr(line, '\n', end - line));
+          
+          return newline ? newline + 1 : end;
+        }
+    };
+  }   // namespace internals2_generic
+}     // namespace websockets2_generic
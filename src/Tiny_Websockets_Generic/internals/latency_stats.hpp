@@ -0,0 +1,225 @@
+/****************************************************************************************************************************
+  latency_stats.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+
+#include <stdio.h>
+
+// Per-stage receive latency, off by default. When enabled every connection keeps one histogram per
+// LatencyStage (and the server it was accepted by keeps the sum of its connections):
+//
+//   socket readable -> header parsed -> payload complete -> callback entered -> callback returned
+//        Header             Payload            Dispatch            Callback
+//   '-------------------------------------- Total --------------------------------------'
+//
+// Long Payload means the peer / network is slow, Header and Dispatch are our parsing and assembly,
+// Callback is the application's onMessage handler.
+#ifndef _WEBSOCKETS_LATENCY_STATS_
+  #define _WEBSOCKETS_LATENCY_STATS_      false
+#endif
+
+// Power of 2 buckets, the last one collects everything above 2^(n-2) us. 20 reaches ~0.5 s
+#ifndef _WEBSOCKETS_LATENCY_BUCKETS_
+  #define _WEBSOCKETS_LATENCY_BUCKETS_    20
+#endif
+
+namespace websockets2_generic
+{
+  enum LatencyStage 
+  {
+    LatencyStage_Header,
+    LatencyStage_Payload,
+    LatencyStage_Dispatch,
+    LatencyStage_Callback,
+    LatencyStage_Total,
+    
+    LatencyStage_Count
+  };
+  
+  // Fixed memory histogram of microsecond samples. Bucket 0 counts 0 us, bucket i counts [2^(i-1), 2^i).
+  class LatencyHistogram 
+  {
+    public:
+      static const int NumBuckets = _WEBSOCKETS_LATENCY_BUCKETS_;
+      
+      LatencyHistogram() 
+      {
+        reset();
+      }
+      
+      void record(const uint32_t sample) 
+      {
+        int bucket = 0;
+        
+        for (uint32_t value = sample; value && bucket < NumBuckets - 1; value >>= 1)
+          bucket++;
+          
+        _buckets[bucket]++;
+        _count++;
+        _sum += sample;
+        
+        if (sample > _max)
+          _max = sample;
+      }
+      
+      void merge(const LatencyHistogram& other) 
+      {
+        for (int i = 0; i < NumBuckets; i++)
+          _buckets[i] += other._buckets[i];
+          
+        _count += other._count;
+        _sum   += other._sum;
+        
+        if (other._max > _max)
+          _max = other._max;
+      }
+      
+      void reset() 
+      {
+        for (int i = 0; i < NumBuckets; i++)
+          _buckets[i] = 0;
+          
+        _count  = 0;
+        _sum    = 0;
+        _max    = 0;
+      }
+      
+      uint32_t count() const 
+      {
+        return _count;
+      }
+      
+      uint32_t maximum() const 
+      {
+        return _max;
+      }
+      
+      uint32_t mean() const 
+      {
+        return _count ? static_cast<uint32_t>(_sum / _count) : 0;
+      }
+      
+      uint32_t bucket(const int index) const 
+      {
+        return _buckets[index];
+      }
+      
+      // Largest value counted by a bucket (the last bucket reports the largest sample)
+      uint32_t bucketUpperBound(const int index) const 
+      {
+        if (index == 0)
+          return 0;
+          
+        return index == NumBuckets - 1 ? _max : (1UL << index) - 1;
+      }
+      
+      // Upper bound of the bucket holding the given percentile (0..100), never above maximum()
+      uint32_t percentile(const float percent) const 
+      {
+        if (_count == 0)
+          return 0;
+        
+        const uint32_t rank = static_cast<uint32_t>(_count * percent / 100.0f + 0.5f);
+        uint32_t seen = 0;
+        
+        for (int i = 0; i < NumBuckets; i++)
+        {
+          seen += _buckets[i];
+          
+          if (seen >= rank && seen > 0)
+            return bucketUpperBound(i) < _max ? bucketUpperBound(i) : _max;
+        }
+        
+        return _max;
+      }
+      
+    private:
+      uint32_t _buckets[NumBuckets];
+      uint32_t _count;
+      uint64_t _sum;
+      uint32_t _max;
+  };
+  
+  struct WebsocketsLatencyStats 
+  {
+    LatencyHistogram stages[LatencyStage_Count];
+    
+    static const char* stageName(const LatencyStage stage) 
+    {
+      static const char* const names[LatencyStage_Count] = { "header", "payload", "dispatch", "callback", "total" };
+      
+      return stage < LatencyStage_Count ? names[stage] : "?";
+    }
+    
+    void merge(const WebsocketsLatencyStats& other) 
+    {
+      for (int i = 0; i < LatencyStage_Count; i++)
+        stages[i].merge(other.stages[i]);
+    }
+    
+    void reset() 
+    {
+      for (int i = 0; i < LatencyStage_Count; i++)
+        stages[i].reset();
+    }
+    
+    // One line per stage to anything with println(const char*), e.g. Serial
+    template <class Port>
+    void print(Port& port) const 
+    {
+      char line[96];
+      
+      for (int i = 0; i < LatencyStage_Count; i++)
+      {
+        const LatencyHistogram& histogram = stages[i];
+        
+        snprintf(line, sizeof(line), "%-8s n=%lu mean=%luus p50=%luus p99=%luus max=%luus", 
+                 stageName(static_cast<LatencyStage>(i)), (unsigned long) histogram.count(), (unsigned long) histogram.mean(), 
+                 (unsigned long) histogram.percentile(50), (unsigned long) histogram.percentile(99), (unsigned long) histogram.maximum());
+        port.println(line);
+      }
+    }
+  };
+  
+  namespace internals2_generic
+  {
+    // micros() taken by the endpoint while reading the last frame, 0 when that read failed
+    struct FrameTimestamps 
+    {
+      // right before the read that got the first byte of its header, which may be polls before the rest
+      uint32_t readableAt;
+      uint32_t headerParsed;
+      uint32_t payloadComplete;
+    };
+  }   // namespace internals2_generic
+}     // namespace websockets2_generic
@@ -0,0 +1,569 @@
+/****************************************************************************************************************************
+  timer_wheel.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+
+#include <functional>
+
+#if defined(__linux__)
+  #include <time.h>
+#endif
+
+// Levels of 64 slots, level n ticks every 64^n ms. Deadlines beyond 64^levels ms wait in an overflow
+// list that is sorted in again every time the top level wraps. 4 levels reach ~4.6 hours, 3 ~4.4 minutes
+#ifndef WS_TIMER_WHEEL_LEVELS
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define WS_TIMER_WHEEL_LEVELS     4
+  #else
+    #define WS_TIMER_WHEEL_LEVELS     3
+  #endif
+#endif
+
+namespace websockets2_generic
+{
+  // Millisecond clock of a WebsocketsTimerWheel. Only differences are used, so it may wrap
+  typedef unsigned long (*WebsocketsClock)();
+  
+  // CLOCK_MONOTONIC on Linux, millis() everywhere else
+  inline unsigned long monotonicMillis() 
+  {
+  #if defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return static_cast<unsigned long>(ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000);
+  #else
+    return millis();
+  #endif
+  }
+  
+  class WebsocketsTimerWheel;
+  
+  // One timer, embedded in whatever it times (a pending handshake, a connection slot), so arming and
+  // cancelling never allocate. Moving it keeps it armed, destroying it cancels it. Its callback may arm
+  // or cancel any timer, its own included, but must not destroy its own timer
+  class WebsocketsTimer 
+  {
+    public:
+      typedef std::function<void()> Callback;
+      
+      WebsocketsTimer() : _wheel(nullptr), _link(nullptr), _next(nullptr), _deadline(0), _level(0), _slot(0) 
+      {
+        // Empty
+      }
+      
+      WebsocketsTimer(const Callback callback) : WebsocketsTimer() 
+      {
+        _callback = callback;
+      }
+      
+      WebsocketsTimer(const WebsocketsTimer& other) = delete;
+      WebsocketsTimer& operator=(const WebsocketsTimer& other) = delete;
+      
+      WebsocketsTimer(WebsocketsTimer&& other) noexcept : 
+        _wheel(other._wheel), 
+        _link(other._link), 
+        _next(other._next), 
+        _deadline(other._deadline), 
+        _level(other._level), 
+        _slot(other._slot), 
+        _callback(std::move(other._callback)) 
+      {
+        adopt(other);
+      }
+      
+      WebsocketsTimer& operator=(WebsocketsTimer&& other) noexcept 
+      {
+        if (this != &other) 
+        {
+          cancel();
+          
+          _wheel    = other._wheel;
+          _link     = other._link;
+          _next     = other._next;
+          _deadline = other._deadline;
+          _level    = other._level;
+          _slot     = other._slot;
+          _callback = std::move(other._callback);
+          
+          adopt(other);
+        }
+        
+        return *this;
+      }
+      
+      ~WebsocketsTimer() 
+      {
+        cancel();
+      }
+      
+      void setCallback(const Callback callback) 
+      {
+        _callback = callback;
+      }
+      
+      bool armed() const 
+      {
+        return _link != nullptr;
+      }
+      
+      // In the time of the wheel it is armed on, see WebsocketsTimerWheel::now()
+      uint64_t deadline() const 
+      {
+        return _deadline;
+      }
+      
+      inline void cancel();
+      
+    private:
+      WebsocketsTimerWheel* _wheel;
+      
+      // the pointer that points at this timer (a slot head or the previous timer's _next), nullptr while
+      // not armed. Unlinking needs no search and no back pointer to the slot
+      WebsocketsTimer** _link;
+      WebsocketsTimer* _next;
+      
+      uint64_t _deadline;
+      uint8_t _level;     // WS_TIMER_WHEEL_LEVELS for the overflow list, one more for the due list
+      uint8_t _slot;
+      Callback _callback;
+      
+      // other's place in its list is ours now
+      void adopt(WebsocketsTimer& other) 
+      {
+        if (_link) 
+        {
+          *_link = this;
+          
+          if (_next)
+            _next->_link = &_next;
+        }
+        
+        other._wheel = nullptr;
+        other._link  = nullptr;
+        other._next  = nullptr;
+      }
+      
+      friend class WebsocketsTimerWheel;
+  };
+  
+  // Hierarchical timer wheel (Varghese & Lauck) with 1 ms ticks. Arming and cancelling are O(1), a
+  // timer is moved down a level at most WS_TIMER_WHEEL_LEVELS - 1 times before it expires, and a bitmap
+  // per level lets advance() and nextDeadline() skip empty slots instead of walking them. Single threaded,
+  // callbacks run from advance()
+  class WebsocketsTimerWheel 
+  {
+    public:
+      static const unsigned SlotBits = 6;
+      static const unsigned NumSlots = 1 << SlotBits;
+      static const unsigned NumLevels = WS_TIMER_WHEEL_LEVELS;
+      
+      WebsocketsTimerWheel(const WebsocketsClock clock = monotonicMillis) : 
+        _clock(clock), 
+        _lastClock(clock()), 
+        _time(0), 
+        _current(0), 
+        _overflow(nullptr), 
+        _due(nullptr), 
+        _count(0), 
+        _expiring(false)
+      {
+        for (unsigned level = 0; level < NumLevels; level++) 
+        {
+          _occupied[level] = 0;
+          
+          for (unsigned slot = 0; slot < NumSlots; slot++)
+            _slots[level][slot] = nullptr;
+        }
+      }
+      
+      WebsocketsTimerWheel(const WebsocketsTimerWheel& other) = delete;
+      WebsocketsTimerWheel& operator=(const WebsocketsTimerWheel& other) = delete;
+      
+      // Timers that outlive the wheel are left disarmed
+      ~WebsocketsTimerWheel() 
+      {
+        for (unsigned level = 0; level < NumLevels; level++) 
+        {
+          for (unsigned slot = 0; slot < NumSlots; slot++)
+            detach(_slots[level][slot]);
+        }
+        
+        detach(_overflow);
+        detach(_due);
+      }
+      
+      // Milliseconds since the wheel was created, 64 bits wide whatever the width of the clock
+      uint64_t now() 
+      {
+        const unsigned long clock = _clock();
+        
+        // unsigned difference, survives the wrap of a 32 bit millis()
+        _time += static_cast<unsigned long>(clock - _lastClock);
+        _lastClock = clock;
+        
+        return _time;
+      }
+      
+      // (Re)arms timer to fire delayMs from now
+      void arm(WebsocketsTimer& timer, const uint32_t delayMs) 
+      {
+        armAt(timer, now() + delayMs);
+      }
+      
+      // Deadlines already past fire on the next advance()
+      void armAt(WebsocketsTimer& timer, const uint64_t deadline) 
+      {
+        timer.cancel();
+        
+        timer._wheel    = this;
+        timer._deadline = deadline;
+        
+        link(timer);
+        _count++;
+      }
+      
+      void cancel(WebsocketsTimer& timer) 
+      {
+        if (timer._wheel == this && timer._link) 
+        {
+          unlink(timer);
+          _count--;
+        }
+      }
+      
+      // Runs the callbacks of every timer due by now(), in deadline order (timers due in the same
+      // millisecond, and those armed for a time advance() had passed already, in no particular order).
+      // Returns how many fired
+      size_t advance() 
+      {
+        // a callback calling advance() again
+        if (_expiring)
+          return 0;
+          
+        const uint64_t target = now();
+        size_t fired = expireDue();
+        
+        while (_current <= target) 
+        {
+          // straight to the next slot that has something to do, empty ticks are never visited
+          const uint64_t next = nextTick();
+          
+          if (next > target) 
+          {
+            moveTo(target + 1);
+            break;
+          }
+          
+          if (next != _current)
+            moveTo(next);
+            
+          fired += expire();
+          moveTo(_current + 1);
+        }
+        
+        return fired;
+      }
+      
+      // Earliest deadline of an armed timer, UINT64_MAX when there is none. A scan of one slot at most
+      uint64_t nextDeadline() const 
+      {
+        if (_due)
+          return earliest(_due);
+          
+        if (_occupied[0])
+          return (_current & ~static_cast<uint64_t>(NumSlots - 1)) | lowestBit(_occupied[0]);
+          
+        for (unsigned level = 1; level < NumLevels; level++) 
+        {
+          if (_occupied[level])
+            return earliest(_slots[level][lowestBit(_occupied[level])]);
+        }
+        
+        return _overflow ? earliest(_overflow) : UINT64_MAX;
+      }
+      
+      // Milliseconds until the next timer is due as a poll() / epoll_wait() timeout: 0 when one is due
+      // already, -1 when nothing is armed
+      int timeUntilNext() 
+      {
+        const uint64_t deadline = nextDeadline();
+        
+        if (deadline == UINT64_MAX)
+          return -1;
+          
+        const uint64_t time = now();
+        
+        if (deadline <= time)
+          return 0;
+          
+        return deadline - time > 0x7FFFFFFF ? 0x7FFFFFFF : static_cast<int>(deadline - time);
+      }
+      
+      size_t size() const 
+      {
+        return _count;
+      }
+      
+    private:
+      WebsocketsClock _clock;
+      unsigned long _lastClock;
+      uint64_t _time;
+      
+      // next tick to process, every tick before it has been
+      uint64_t _current;
+      
+      // A timer sits on the lowest level where its deadline and _current only differ in that level's
+      // bits, in the slot of its deadline's bits there. Level n is sorted into level n - 1 when _current
+      // reaches the slot
+      WebsocketsTimer* _slots[NumLevels][NumSlots];
+      uint64_t _occupied[NumLevels];
+      WebsocketsTimer* _overflow;
+      
+      // armed for a tick advance() has processed already, they fire first thing in the next advance()
+      WebsocketsTimer* _due;
+      
+      size_t _count;
+      bool _expiring;
+      
+      static unsigned lowestBit(const uint64_t bits) 
+      {
+        return __builtin_ctzll(bits);
+      }
+      
+      static uint64_t earliest(const WebsocketsTimer* timer) 
+      {
+        uint64_t deadline = UINT64_MAX;
+        
+        for (; timer; timer = timer->_next) 
+        {
+          if (timer->_deadline < deadline)
+            deadline = timer->_deadline;
+        }
+        
+        return deadline;
+      }
+      
+      void link(WebsocketsTimer& timer) 
+      {
+        // processed ticks, and the one being expired, are never visited again
+        if (timer._deadline < _current || (_expiring && timer._deadline == _current)) 
+        {
+          timer._level = static_cast<uint8_t>(NumLevels + 1);
+          timer._slot  = 0;
+          push(_due, timer);
+          return;
+        }
+          
+        const uint64_t differs = timer._deadline ^ _current;
+        unsigned level = 0;
+        
+        while (level < NumLevels && (differs >> (SlotBits * (level + 1))) != 0)
+          level++;
+          
+        WebsocketsTimer** head = &_overflow;
+        
+        timer._level = static_cast<uint8_t>(level);
+        timer._slot  = 0;
+        
+        if (level < NumLevels) 
+        {
+          timer._slot = static_cast<uint8_t>((timer._deadline >> (SlotBits * level)) & (NumSlots - 1));
+          head = &_slots[level][timer._slot];
+          _occupied[level] |= 1ULL << timer._slot;
+        }
+        
+        push(*head, timer);
+      }
+      
+      static void push(WebsocketsTimer*& head, WebsocketsTimer& timer) 
+      {
+        timer._next = head;
+        
+        if (timer._next)
+          timer._next->_link = &timer._next;
+          
+        timer._link = &head;
+        head = &timer;
+      }
+      
+      void unlink(WebsocketsTimer& timer) 
+      {
+        *timer._link = timer._next;
+        
+        if (timer._next)
+          timer._next->_link = timer._link;
+          
+        if (timer._level < NumLevels && !_slots[timer._level][timer._slot])
+          _occupied[timer._level] &= ~(1ULL << timer._slot);
+          
+        timer._link = nullptr;
+        timer._next = nullptr;
+      }
+      
+      // First tick where a slot has to be expired or sorted down, UINT64_MAX when nothing is armed
+      uint64_t nextTick() const 
+      {
+        if (_occupied[0])
+          return (_current & ~static_cast<uint64_t>(NumSlots - 1)) | lowestBit(_occupied[0]);
+          
+        for (unsigned level = 1; level < NumLevels; level++) 
+        {
+          if (_occupied[level]) 
+          {
+            const unsigned shift = SlotBits * level;
+            
+            return ((_current >> (shift + SlotBits)) << (shift + SlotBits)) | (static_cast<uint64_t>(lowestBit(_occupied[level])) << shift);
+          }
+        }
+        
+        if (_overflow) 
+        {
+          const unsigned shift = SlotBits * NumLevels;
+          
+          return ((_current >> shift) + 1) << shift;
+        }
+        
+        return UINT64_MAX;
+      }
+      
+      // Every tick skipped on the way holds nothing, but a boundary has to be sorted down as soon as it
+      // is reached, or the timers of its slot would sit behind later ones of the level below
+      void moveTo(const uint64_t tick) 
+      {
+        _current = tick;
+        
+        if ((_current & (NumSlots - 1)) == 0)
+          cascade();
+      }
+      
+      // _current is on a level 1 boundary: every level whose boundary it is too gets its current slot
+      // sorted down, from the top so timers can fall through several levels at once
+      void cascade() 
+      {
+        unsigned top = 1;
+        
+        while (top + 1 < NumLevels && ((_current >> (SlotBits * top)) & (NumSlots - 1)) == 0)
+          top++;
+          
+        if ((_current & ((1ULL << (SlotBits * NumLevels)) - 1)) == 0)
+          relink(_overflow);
+          
+        for (unsigned level = top; level >= 1 && level < NumLevels; level--) 
+        {
+          const unsigned slot = (_current >> (SlotBits * level)) & (NumSlots - 1);
+          
+          if (_slots[level][slot]) 
+          {
+            _occupied[level] &= ~(1ULL << slot);
+            relink(_slots[level][slot]);
+          }
+        }
+      }
+      
+      void relink(WebsocketsTimer*& head) 
+      {
+        WebsocketsTimer* timer = head;
+        head = nullptr;
+        
+        while (timer) 
+        {
+          WebsocketsTimer* next = timer->_next;
+          
+          link(*timer);
+          timer = next;
+        }
+      }
+      
+      size_t expire() 
+      {
+        return expireList(_slots[0][_current & (NumSlots - 1)]);
+      }
+      
+      // Taken out of _due first, so a callback arming a timer for now runs it on the next advance(), not
+      // in a loop here
+      size_t expireDue() 
+      {
+        WebsocketsTimer* head = _due;
+        _due = nullptr;
+        
+        if (head)
+          head->_link = &head;
+          
+        return expireList(head);
+      }
+      
+      size_t expireList(WebsocketsTimer*& head) 
+      {
+        size_t fired = 0;
+        
+        _expiring = true;
+        
+        // one at a time, a callback may cancel the ones behind it
+        while (head) 
+        {
+          WebsocketsTimer& timer = *head;
+          
+          unlink(timer);
+          _count--;
+          fired++;
+          
+          if (timer._callback)
+            timer._callback();
+        }
+        
+        _expiring = false;
+        
+        return fired;
+      }
+      
+      static void detach(WebsocketsTimer* timer) 
+      {
+        while (timer) 
+        {
+          WebsocketsTimer* next = timer->_next;
+          
+          timer->_wheel = nullptr;
+          timer->_link  = nullptr;
+          timer->_next  = nullptr;
+          timer = next;
+        }
+      }
+  };
+  
+  inline void WebsocketsTimer::cancel() 
+  {
+    if (_wheel)
+      _wheel->cancel(*this);
+  }
+}     // namespace websockets2_generic
@@ -0,0 +1,150 @@
+/****************************************************************************************************************************
+  token_bucket.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+    // Rate limiter refilled from a millisecond clock the caller passes in. Tokens are kept in
+    // thousandths, so any rate refills exactly with integer math. A rate of 0 never limits
+    class TokenBucket 
+    {
+      public:
+        TokenBucket() : _rate(0), _capacity(0), _milliTokens(0), _lastRefill(0) 
+        {
+          // Empty
+        }
+        
+        // Starts full. burst 0 allows one second's worth at once
+        void configure(const uint32_t perSecond, const uint32_t burst, const unsigned long now) 
+        {
+          _rate        = perSecond;
+          _capacity    = static_cast<int64_t>(burst ? burst : perSecond) * 1000;
+          _milliTokens = _capacity;
+          _lastRefill  = now;
+        }
+        
+        bool limited() const 
+        {
+          return _rate != 0;
+        }
+        
+        uint32_t rate() const 
+        {
+          return _rate;
+        }
+        
+        // All or nothing
+        bool take(const unsigned long now, const uint32_t count = 1) 
+        {
+          if (_rate == 0)
+            return true;
+            
+          refill(now);
+          
+          const int64_t cost = static_cast<int64_t>(count) * 1000;
+          
+          if (_milliTokens < cost)
+            return false;
+            
+          _milliTokens -= cost;
+          
+          return true;
+        }
+        
+        // Takes count even when that goes into debt, for costs only known once they are paid (bytes of a
+        // message). The debt is paid off by the refill before ready() is true again
+        void charge(const unsigned long now, const uint32_t count) 
+        {
+          if (_rate == 0)
+            return;
+            
+          refill(now);
+          
+          _milliTokens -= static_cast<int64_t>(count) * 1000;
+        }
+        
+        // At least one token
+        bool ready(const unsigned long now) 
+        {
+          if (_rate == 0)
+            return true;
+            
+          refill(now);
+          
+          return _milliTokens >= 1000;
+        }
+        
+        // Milliseconds until count tokens are there, 0 when they already are
+        uint32_t waitTime(const unsigned long now, const uint32_t count = 1) 
+        {
+          if (_rate == 0)
+            return 0;
+            
+          refill(now);
+          
+          const int64_t missing = static_cast<int64_t>(count) * 1000 - _milliTokens;
+          
+          return missing > 0 ? static_cast<uint32_t>((missing + _rate - 1) / _rate) : 0;
+        }
+        
+      private:
+        uint32_t _rate;             // tokens per second, so thousandths per millisecond
+        int64_t _capacity;
+        int64_t _milliTokens;
+        unsigned long _lastRefill;
+        
+        void refill(const unsigned long now) 
+        {
+          // unsigned difference, survives the millis() wrap
+          const unsigned long elapsed = now - _lastRefill;
+          
+          _lastRefill = now;
+          
+          // full anyway, and elapsed * rate could overflow after a long idle time
+          if (elapsed >= static_cast<unsigned long>((_capacity - _milliTokens) / _rate + 1))
+          {
+            _milliTokens = _capacity;
+            return;
+          }
+          
+          _milliTokens += static_cast<int64_t>(elapsed) * _rate;
+          
+          if (_milliTokens > _capacity)
+            _milliTokens = _capacity;
+        }
+    };
+  }   // namespace internals2_generic
+}     // namespace websockets2_generic
@@ -35,10 +35,18 @@
 #include <Tiny_Websockets_Generic/network/tcp_client.hpp>
 #include <Tiny_Websockets_Generic/internals/data_frame.hpp>
 #include <Tiny_Websockets_Generic/message.hpp>
+#include <Tiny_Websockets_Generic/internals/latency_stats.hpp>
+#include <Tiny_Websockets_Generic/internals/token_bucket.hpp>
 #include <memory>
 
 #define __TINY_WS_INTERNAL_DEFAULT_MASK "\00\00\00\00"
 
+// A frame that gets no further for this long closes the connection (checked while it is polled), so a peer
+// stopping half way doesn't hold it forever. A read timeout from setTransportOptions() replaces it, 0 never
+#ifndef WS_PARTIAL_FRAME_TIMEOUT_MS
+  #define WS_PARTIAL_FRAME_TIMEOUT_MS     10000
+#endif
+
 namespace websockets2_generic 
 {
   enum FragmentsPolicy 
@@ -64,6 +72,27 @@ namespace websockets2_generic
   
   CloseReason GetCloseReason(uint16_t reasonCode);
   
+  // What a connection does with a peer over its InboundLimits
+  enum RateLimitPolicy 
+  {
+    RateLimitPolicy_Delay,      // stop reading until the budget refills, TCP flow control slows the peer down
+    RateLimitPolicy_Drop,       // read and discard whole messages without allocating their payload
+    RateLimitPolicy_Close       // close with CloseReason_PolicyViolation
+  };
+  
+  // Budget for the data messages a connection receives, checked on each frame header before the payload
+  // is read. Rates are per second, a burst of 0 allows one second's worth, a rate of 0 doesn't limit.
+  // A message is let in while both budgets have something left, its bytes are charged even past that.
+  // Control frames are never limited
+  struct InboundLimits 
+  {
+    uint32_t messagesPerSecond;
+    uint32_t messageBurst;
+    uint32_t bytesPerSecond;
+    uint32_t byteBurst;
+    RateLimitPolicy policy;
+  };
+  
   namespace internals2_generic 
   {
   
@@ -81,7 +110,36 @@ namespace websockets2_generic
         void setInternalSocket(std::shared_ptr<network2_generic::TcpClient> socket);
     
         bool poll();
+        
+        // Reads what the stack has right now. A frame split over several readiness events is kept and resumed
+        // by the next call, so the result is empty until one is complete
         WebsocketsMessage recv();
+        
+        // The last recv() found nothing more to read, the socket has to report new data before the next one
+        bool readStalled() const 
+        {
+          return _rxStalled;
+        }
+        
+        // Data buffered here or in the socket, whatever the inbound limits say
+        bool hasPendingData() 
+        {
+          return !_rxEarly.empty() || this->_client->poll();
+        }
+        
+        // Bytes read from the socket before the endpoint took it over (frames the peer pipelined behind its
+        // upgrade request), recv() consumes them before anything from the socket
+        void pushReceived(const WSString& data) 
+        {
+          _rxEarly.append(data);
+        }
+        
+        // See WS_PARTIAL_FRAME_TIMEOUT_MS
+        void setPartialFrameTimeout(const uint32_t timeoutMs) 
+        {
+          _rxTimeoutMs = timeoutMs;
+        }
+        
         bool send(const char* data, const size_t len, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey = __TINY_WS_INTERNAL_DEFAULT_MASK);
         bool send(const WSString& data, const uint8_t opcode, const bool fin, const bool mask, const char* maskingKey = __TINY_WS_INTERNAL_DEFAULT_MASK);
     
@@ -96,6 +154,22 @@ namespace websockets2_generic
     
         void close(const CloseReason reason = CloseReason_NormalClosure);
         CloseReason getCloseReason() const;
+        
+        // Sends the close frame but keeps the connection until the peer's close frame answers it, which
+        // close()s it. Only pings and pongs are sent after it (RFC 6455 5.5.1)
+        void beginClose(const CloseReason reason = CloseReason_NormalClosure);
+        
+        bool closeSent() const 
+        {
+          return _closeSent;
+        }
+        
+        // A new connection on the same socket (a reconnect), nothing has been sent on it yet
+        void reopen() 
+        {
+          _closeSent = false;
+          resetReceive();
+        }
     
         void setFragmentsPolicy(const FragmentsPolicy newPolicy);
         FragmentsPolicy getFragmentsPolicy() const;
@@ -104,6 +178,26 @@ namespace websockets2_generic
         {
           _useMasking = useMasking;
         }
+        
+    #if _WEBSOCKETS_LATENCY_STATS_
+        const FrameTimestamps& getFrameTimestamps() const 
+        {
+          return _frameTimestamps;
+        }
+    #endif
+    
+        void setInboundLimits(const InboundLimits& limits);
+        
+        const InboundLimits& getInboundLimits() const 
+        {
+          return _inboundLimits;
+        }
+        
+        // Milliseconds until a connection held back by RateLimitPolicy_Delay reads again, 0 when it isn't
+        uint32_t inboundWaitTime();
+        
+        // Frame header for a payload of len bytes, without the masking key
+        static std::string getHeader(uint64_t len, uint8_t opcode, bool fin, bool mask);
     
         virtual ~WebsocketsEndpoint();
         
@@ -119,15 +213,57 @@ namespace websockets2_generic
         
         WebsocketsMessage::StreamBuilder _streamBuilder;
         CloseReason _closeReason;
+        bool _closeSent = false;
         bool _useMasking = true;
+        
+        InboundLimits _inboundLimits = { 0, 0, 0, 0, RateLimitPolicy_Delay };
+        bool _inboundLimited = false;
+        bool _inboundDelayed = false;
+        // the rest of a dropped fragmented message is dropped too
+        bool _droppingMessage = false;
+        TokenBucket _inboundMessages;
+        TokenBucket _inboundBytes;
+        
+    #if _WEBSOCKETS_LATENCY_STATS_
+        FrameTimestamps _frameTimestamps = { 0, 0, 0 };
+    #endif
     
+        // Frame being received, kept across recv() calls
+        enum RxStage 
+        {
+          RxStage_Header,
+          RxStage_Payload,
+          RxStage_Skip            // payload of a dropped frame, read and discarded
+        } _rxStage = RxStage_Header;
+        
+        // 2 bytes, extended payload length and masking key
+        uint8_t _rxHeader[14];
+        
+        // bytes of the current stage read so far
+        uint64_t _rxDone = 0;
+        WebsocketsFrame _rxFrame = WebsocketsFrame();
+        bool _rxStalled = false;
+        
+        // a frame is half read and the last read found nothing, since _rxStalledAt (millis())
+        bool _rxWaiting = false;
+        unsigned long _rxStalledAt = 0;
+        uint32_t _rxTimeoutMs = WS_PARTIAL_FRAME_TIMEOUT_MS;
+        
+        // see pushReceived()
+        WSString _rxEarly;
+        
         WebsocketsFrame _recv();
+        uint32_t readSome(uint8_t* buffer, const uint64_t len);
+        bool readPart(uint8_t* buffer, const uint64_t len);
+        bool readFrameHeader();
+        void resetReceive();
+        bool partialFrameExpired();
+        bool admitInbound(const uint8_t opcode, const bool fin, const uint64_t payloadLength);
+        void sendCloseFrame(const CloseReason reason);
         void handleMessageInternally(WebsocketsMessage& msg);
     
         WebsocketsMessage handleFrameInStreamingMode(WebsocketsFrame& frame);
         WebsocketsMessage handleFrameInStandardMode(WebsocketsFrame& frame);
-    
-        std::string getHeader(uint64_t len, uint8_t opcode, bool fin, bool mask);
     };    // class WebsocketsEndpoint
   }       // namespace internals2_generic 
 }         // websockets::internals
@@ -83,6 +83,23 @@ namespace websockets2_generic
   // OpenSSL Dependent
   #define WSDefaultSecuredTcpClient websockets2_generic::network2_generic::SecuredEsp32TcpClient
   #endif //_WS_CONFIG_NO_SSL
+
+#elif defined(__linux__)
+
+  // Using Linux BSD sockets
+  
+  #define _WS_CONFIG_NO_SSL   true
+  
+  #include <Tiny_Websockets_Generic/network/linux/linux_tcp_server.hpp>
+  #define WSDefaultTcpClient websockets2_generic::network2_generic::LinuxTcpClient
+  
+  #if WS_USE_IO_URING
+    // io_uring server, falls back to plain sockets at runtime on kernels without support
+    #include <Tiny_Websockets_Generic/network/linux/linux_uring_tcp.hpp>
+    #define WSDefaultTcpServer websockets2_generic::network2_generic::IoUringTcpServer
+  #else
+    #define WSDefaultTcpServer websockets2_generic::network2_generic::LinuxTcpServer
+  #endif
       
 #endif    // ESP8266
 
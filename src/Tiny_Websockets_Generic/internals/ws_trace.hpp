@@ -0,0 +1,389 @@
+/****************************************************************************************************************************
+  ws_trace.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+
+// Structured tracing: events are numeric IDs with a connection tag and three binary arguments, recorded into a ring in a few
+// instructions. Nothing is formatted or printed on the recording side, WebsocketsTrace::flush() does that
+// later from the application's idle loop (or WebsocketsTrace::read() hands the raw records to a host tool).
+//
+// _WEBSOCKETS_TRACE_MASK_ selects the compiled-in categories, WSTRACE() of any other category compiles
+// to nothing and its arguments are not evaluated. 0 removes tracing, including the ring.
+//   0x01: handshake (request sent / received, headers seen, accepted / rejected)
+//   0x02: connection (connect started, opened, closed)
+//   0x04: frame (every frame sent / received and fragment boundaries, hot path)
+//   0x08: control (ping, pong and close frames)
+// A host timeline (chrome_trace.hpp) wants all of them: 0x0F
+#ifndef _WEBSOCKETS_TRACE_MASK_
+  #define _WEBSOCKETS_TRACE_MASK_       0x03
+#endif
+
+// Records kept before the oldest are overwritten, must be a power of 2. 24 bytes each.
+#ifndef _WEBSOCKETS_TRACE_RING_SIZE_
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define _WEBSOCKETS_TRACE_RING_SIZE_      4096
+  #else
+    #define _WEBSOCKETS_TRACE_RING_SIZE_      16
+  #endif
+#endif
+
+#if ( defined(__linux__) || defined(_WIN32) )
+  #include <atomic>
+#endif
+
+namespace websockets2_generic
+{
+  enum TraceCategory 
+  {
+    TraceCategory_Handshake   = 0x01,
+    TraceCategory_Connection  = 0x02,
+    TraceCategory_Frame       = 0x04,
+    TraceCategory_Control     = 0x08
+  };
+  
+  // High byte is the category, so the compile-time filter is a shift and a mask
+  enum TraceEventId 
+  {
+    // arg0: custom headers, arg1: request bytes, arg2: authorization bytes
+    TraceEvent_HandshakeRequestSent     = (TraceCategory_Handshake << 8) | 1,
+    // arg0: TraceHeader, arg1: value length, arg2: name length
+    TraceEvent_HandshakeResponseHeader  = (TraceCategory_Handshake << 8) | 2,
+    // arg0: success, arg1: upgrade | connection << 1 | accept << 2, arg2: header count
+    TraceEvent_HandshakeResponseParsed  = (TraceCategory_Handshake << 8) | 3,
+    // arg0: TraceHeader, arg1: value length, arg2: name length
+    TraceEvent_HandshakeRequestHeader   = (TraceCategory_Handshake << 8) | 4,
+    // arg0: TraceReject, arg1: header count, arg2: HTTP status for TraceReject_Application
+    TraceEvent_HandshakeRejected        = (TraceCategory_Handshake << 8) | 5,
+    // arg1: header count
+    TraceEvent_HandshakeAccepted        = (TraceCategory_Handshake << 8) | 6,
+    // Client got the status line. arg0: is 101, arg1: line length
+    TraceEvent_HandshakeResponseStatus  = (TraceCategory_Handshake << 8) | 7,
+    // Server accepted the TCP connection and starts reading the request
+    TraceEvent_HandshakeRequestStarted  = (TraceCategory_Handshake << 8) | 8,
+    
+    // arg0: 0 connected as client / 1 accepted by server, arg1: port (client)
+    TraceEvent_ConnectionOpened         = (TraceCategory_Connection << 8) | 1,
+    // arg0: CloseReason
+    TraceEvent_ConnectionClosed         = (TraceCategory_Connection << 8) | 2,
+    // Client starts connecting. arg1: port
+    TraceEvent_ConnectStarted           = (TraceCategory_Connection << 8) | 3,
+    // arg0: success
+    TraceEvent_TcpConnected             = (TraceCategory_Connection << 8) | 4,
+    // Peer's close frame. arg0: CloseReason
+    TraceEvent_CloseReceived            = (TraceCategory_Connection << 8) | 5,
+    // Peer went over its InboundLimits. arg0: RateLimitPolicy, arg1: payload length (0 when delayed)
+    TraceEvent_InboundLimited           = (TraceCategory_Connection << 8) | 6,
+    // Our close frame, the connection stays open for the peer's. arg0: CloseReason
+    TraceEvent_CloseSent                = (TraceCategory_Connection << 8) | 7,
+    
+    // arg0: opcode | fin << 4 | mask << 5, arg1: payload length
+    TraceEvent_FrameReceived            = (TraceCategory_Frame << 8) | 1,
+    TraceEvent_FrameSent                = (TraceCategory_Frame << 8) | 2,
+    // First / last frame of a fragmented message. arg0: opcode of the message, arg1: frame payload length
+    TraceEvent_FragmentsStarted         = (TraceCategory_Frame << 8) | 3,
+    TraceEvent_FragmentsEnded           = (TraceCategory_Frame << 8) | 4,
+    
+    // arg0: opcode (0x8 close, 0x9 ping, 0xA pong), arg1: payload length
+    TraceEvent_ControlReceived          = (TraceCategory_Control << 8) | 1,
+    TraceEvent_ControlSent              = (TraceCategory_Control << 8) | 2
+  };
+  
+  // Header names are traced as codes (the values of internals2_generic::HttpHeader), values only by length
+  enum TraceHeader 
+  {
+    TraceHeader_Other,
+    TraceHeader_Host,
+    TraceHeader_Upgrade,
+    TraceHeader_Connection,
+    TraceHeader_Key,
+    TraceHeader_Version,
+    TraceHeader_Accept,
+    TraceHeader_Protocol,
+    TraceHeader_Extensions,
+    TraceHeader_Authorization,
+    TraceHeader_Origin,
+    TraceHeader_UserAgent
+  };
+  
+  enum TraceReject 
+  {
+    TraceReject_Connection = 1,
+    TraceReject_Upgrade,
+    TraceReject_Version,
+    TraceReject_Key,
+    TraceReject_Timeout,
+    TraceReject_TooLarge,
+    TraceReject_EarlyData,      // no longer reported, pipelined frames go to the endpoint
+    TraceReject_Capacity,
+    TraceReject_Malformed,
+    TraceReject_Application,    // onHandshake() refused it, arg2: the HTTP status
+    TraceReject_Overload,       // over an admission limit in overload mode
+    TraceReject_Draining        // still in progress when the server was drained
+  };
+  
+  struct TraceRecord 
+  {
+    uint32_t timestamp;     // micros()
+    uint32_t connection;    // traceConnectionId() of the connection, 0 when not tied to one
+    uint16_t id;            // TraceEventId
+    uint16_t arg0;
+    uint32_t arg1;
+    uint32_t arg2;
+  };
+  
+  namespace internals2_generic
+  {
+  #if ( defined(__linux__) || defined(_WIN32) )
+    typedef std::atomic<uint32_t> TraceWord;
+    
+    inline uint32_t traceLoad(const TraceWord& word, std::memory_order order = std::memory_order_relaxed) 
+    {
+      return word.load(order);
+    }
+    
+    inline void traceStore(TraceWord& word, uint32_t value, std::memory_order order = std::memory_order_relaxed) 
+    {
+      word.store(value, order);
+    }
+    
+    inline uint32_t traceFetchAdd(TraceWord& word) 
+    {
+      return word.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    inline void traceFence(std::memory_order order) 
+    {
+      std::atomic_thread_fence(order);
+    }
+    
+    #define WS_TRACE_ACQUIRE      std::memory_order_acquire
+    #define WS_TRACE_RELEASE      std::memory_order_release
+  #else
+    // Boards run loop() on a single thread, plain words are enough (records from ISRs are not supported)
+    typedef volatile uint32_t TraceWord;
+    
+    inline uint32_t traceLoad(const TraceWord& word, int = 0) 
+    {
+      return word;
+    }
+    
+    inline void traceStore(TraceWord& word, uint32_t value, int = 0) 
+    {
+      word = value;
+    }
+    
+    inline uint32_t traceFetchAdd(TraceWord& word) 
+    {
+      return word++;
+    }
+    
+    inline void traceFence(int) {}
+    
+    #define WS_TRACE_ACQUIRE      0
+    #define WS_TRACE_RELEASE      0
+  #endif
+  
+    // Multi-producer, single-consumer flight recorder. Writers never wait: a slot is claimed with one
+    // fetch-add and overwritten when the reader falls behind, the reader counts what it lost. Every
+    // slot carries the sequence number of its record (0 while being written) so a torn read is detected.
+    class TraceRing 
+    {
+      public:
+        static const uint32_t Size = _WEBSOCKETS_TRACE_RING_SIZE_;
+        
+        TraceRing() : _head(0), _tail(0), _dropped(0)
+        {
+          for (uint32_t i = 0; i < Size; i++)
+            traceStore(_slots[i].sequence, 0);
+        }
+        
+        void record(const uint16_t id, const uint32_t connection, const uint16_t arg0, const uint32_t arg1, const uint32_t arg2) 
+        {
+          const uint32_t position = traceFetchAdd(_head);
+          Slot& slot = _slots[position & (Size - 1)];
+          
+          traceStore(slot.sequence, 0);
+          traceFence(WS_TRACE_RELEASE);
+          
+          traceStore(slot.words[0], micros());
+          traceStore(slot.words[1], id | (static_cast<uint32_t>(arg0) << 16));
+          traceStore(slot.words[2], arg1);
+          traceStore(slot.words[3], arg2);
+          traceStore(slot.words[4], connection);
+          
+          traceStore(slot.sequence, position + 1, WS_TRACE_RELEASE);
+        }
+        
+        // Single consumer. Copies up to maxRecords completed records, oldest first.
+        size_t read(TraceRecord* records, const size_t maxRecords) 
+        {
+          const uint32_t head = traceLoad(_head, WS_TRACE_ACQUIRE);
+          size_t count = 0;
+          
+          if (head - _tail > Size)
+          {
+            _dropped += head - _tail - Size;
+            _tail = head - Size;
+          }
+          
+          while (count < maxRecords && _tail != head)
+          {
+            Slot& slot = _slots[_tail & (Size - 1)];
+            const uint32_t expected = _tail + 1;
+            const uint32_t sequence = traceLoad(slot.sequence, WS_TRACE_ACQUIRE);
+            
+            // Still being written, come back on the next read
+            if (sequence == 0 || static_cast<int32_t>(sequence - expected) < 0)
+              break;
+            
+            uint32_t words[WordsPerRecord];
+            
+            for (int i = 0; i < WordsPerRecord; i++)
+              words[i] = traceLoad(slot.words[i]);
+            
+            traceFence(WS_TRACE_ACQUIRE);
+            
+            _tail++;
+            
+            // Lapped by the writers while copying
+            if (sequence != expected || traceLoad(slot.sequence) != sequence)
+            {
+              _dropped++;
+              continue;
+            }
+            
+            TraceRecord& record = records[count++];
+            
+            record.timestamp  = words[0];
+            record.id         = static_cast<uint16_t>(words[1]);
+            record.arg0       = static_cast<uint16_t>(words[1] >> 16);
+            record.arg1       = words[2];
+            record.arg2       = words[3];
+            record.connection = words[4];
+          }
+          
+          return count;
+        }
+        
+        uint32_t dropped() const 
+        {
+          return _dropped;
+        }
+        
+        void clear() 
+        {
+          _tail     = traceLoad(_head, WS_TRACE_ACQUIRE);
+          _dropped  = 0;
+        }
+        
+      private:
+        static const int WordsPerRecord = 5;
+        
+        struct Slot 
+        {
+          TraceWord sequence;
+          TraceWord words[WordsPerRecord];
+        };
+        
+        Slot _slots[Size];
+        TraceWord _head;
+        uint32_t _tail;
+        uint32_t _dropped;
+    };
+    
+  #if (_WEBSOCKETS_TRACE_MASK_ != 0)
+    extern TraceRing traceRing;
+  #endif
+  
+    // Connections are told apart by the address of their TcpClient, which lives as long as the connection
+    inline uint32_t traceConnectionId(const void* connection) 
+    {
+      return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(connection) >> 3);
+    }
+  }   // namespace internals2_generic
+  
+  // Draining side, meant for the idle part of loop() or a host tool
+  class WebsocketsTrace 
+  {
+    public:
+      // Copies up to maxRecords records (oldest first) and removes them from the ring
+      static size_t read(TraceRecord* records, const size_t maxRecords);
+      
+      // Records overwritten before they could be read
+      static uint32_t dropped();
+      
+      static void clear();
+      
+      static const char* eventName(const uint16_t id);
+      
+      // Name of argument 0..2 of an event, nullptr when the event doesn't use it
+      static const char* argName(const uint16_t id, const int index);
+      
+      // Text of an argument as format() prints it (header names, hex flags...), into buffer
+      static const char* argText(const TraceRecord& record, const int index, char* buffer, const size_t len);
+      
+      // One line of text, e.g. "12345678 #1a2b3c handshake.request_header header=Upgrade value_len=9 name_len=7"
+      static size_t format(const TraceRecord& record, char* buffer, const size_t len);
+      
+      // Formats and prints up to maxRecords records to port (anything with println(const char*)),
+      // returns how many were printed
+      template <class Port>
+      static size_t flush(Port& port, const size_t maxRecords = 4) 
+      {
+        TraceRecord record;
+        char line[112];
+        size_t count = 0;
+        
+        while (count < maxRecords && read(&record, 1) == 1)
+        {
+          format(record, line, sizeof(line));
+          port.println(line);
+          count++;
+        }
+        
+        return count;
+      }
+  };
+}     // namespace websockets2_generic
+
+// connection: pointer to the connection's TcpClient (or nullptr)
+#if (_WEBSOCKETS_TRACE_MASK_ != 0)
+  #define WSTRACE(id, connection, arg0, arg1, arg2)   \
+    do { if (((id) >> 8) & (_WEBSOCKETS_TRACE_MASK_)) \
+      websockets2_generic::internals2_generic::traceRing.record((id), websockets2_generic::internals2_generic::traceConnectionId(connection), \
+        static_cast<uint16_t>(arg0), static_cast<uint32_t>(arg1), static_cast<uint32_t>(arg2)); } while (0)
+#else
+  // Arguments stay referenced (never evaluated) so that variables kept only for tracing don't warn
+  #define WSTRACE(id, connection, arg0, arg1, arg2)   \
+    do { if (false) { (void) (connection); (void) (arg0); (void) (arg1); (void) (arg2); } } while (0)
+#endif
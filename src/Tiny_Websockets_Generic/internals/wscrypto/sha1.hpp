@@ -209,7 +209,10 @@ namespace websockets2_generic
             state[2] = 0x98BADCFE;
             state[3] = 0x10325476;
             state[4] = 0xC3D2E1F0;
-            add(text);
+            
+            // the default, an empty hash to add() to
+            if (text)
+              add(text);
           }
       
           sha1& add(uint8_t x)
@@ -62,7 +62,9 @@
   #warning WEBSOCKETS_USE_WIFININA in message.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common_WiFiNINA.hpp>
 #else
-  #warning WEBSOCKETS_USE_ESP_WIFI in message.hpp
+  #if !( defined(__linux__) || defined(_WIN32) )
+    #warning WEBSOCKETS_USE_ESP_WIFI in message.hpp
+  #endif
   #include <Tiny_Websockets_Generic/internals/ws_common.hpp>  
 #endif
 //////
@@ -61,7 +61,7 @@ namespace websockets2_generic
 {
   namespace network2_generic
   {
-    typedef GenericEspTcpClient<EthernetClient> EthernetTcpClient;
+    typedef GenericEthernetTcpClient<EthernetClient> EthernetTcpClient;
 
 #if 0
     // KH, no SSL support for Ethernet
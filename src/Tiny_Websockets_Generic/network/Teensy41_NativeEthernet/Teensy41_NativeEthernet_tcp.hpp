@@ -35,6 +35,7 @@
 
 #include <Tiny_Websockets_Generic/internals/ws_common.hpp>
 #include <Tiny_Websockets_Generic/network/tcp_client.hpp>
+#include <Tiny_Websockets_Generic/network/line_reader.hpp>
 #include <Tiny_Websockets_Generic/network/tcp_server.hpp>
 
 #include <NativeEthernet.h>
@@ -58,16 +59,36 @@ namespace websockets2_generic
           // as an IP (it will try to resolve it). So we have to convert
           // it if necessary.
           IPAddress ip;
+          
+          // 0 keeps the library default
+          if (_options.has(TransportOptions::Option_ConnectTimeout) && _options.connectTimeoutMs > 0)
+            client.setConnectionTimeout(_options.connectTimeoutMs > 0xFFFF ? 0xFFFF : _options.connectTimeoutMs);
+            
           return (ip.fromString(hostStr)
                   ? client.connect(ip, port)
                   : client.connect(hostStr, port)
                  );
         }
     
+        // The connect and read timeouts, NativeEthernet has no socket options to tune
+        uint16_t setOptions(const TransportOptions& options) override
+        {
+          _options = options;
+          
+          const uint16_t ignored = options.options & ~(TransportOptions::Option_ConnectTimeout | TransportOptions::Option_ReadTimeout);
+          
+          if (ignored)
+          {
+            LOGWARN1("EthernetTcpClient::setOptions: ignored options =", ignored);
+          }
+          
+          return ignored;
+        }
+    
         bool poll()
         {
           yield();
-          return client.available();
+          return _lineReader.buffered() > 0 || client.available();
         }
     
         bool available() override
@@ -98,30 +119,44 @@ namespace websockets2_generic
     
         WSString readLine() override
         {
-          WSString line = "";
-    
-          int ch = -1;
-    
-          while ( ch != '\n' && available())
-          {
-            // It is important to call `client.available()`. Otherwise no data can be read.
-            if (client.available())
+          const bool hasTimeout = _options.has(TransportOptions::Option_ReadTimeout) && _options.readTimeoutMs > 0;
+          unsigned long lastRead = millis();
+          
+          return _lineReader.readLine(
+            [this, &lastRead](uint8_t* buffer, const uint32_t len)
             {
-              ch = client.read();
-    
-              if (ch >= 0)
+              // It is important to call `client.available()`. Otherwise no data can be read.
+              int count = client.available();
+    
+              if (count <= 0)
+                return static_cast<int32_t>(0);
+    
+              count = client.read(buffer, (static_cast<uint32_t>(count) < len) ? count : len);
+              
+              if (count > 0)
+                lastRead = millis();
+                
+              return static_cast<int32_t>(count);
+            },
+            [this, hasTimeout, &lastRead]()
+            {
+              if (hasTimeout && (millis() - lastRead > _options.readTimeoutMs))
               {
-                line += (char) ch;
+                LOGWARN("EthernetTcpClient::readLine: read timeout");
+                close();
               }
-            }
-          }
-    
-          return line;
+              
+              return available();
+            });
         }
     
         uint32_t read(uint8_t* buffer, const uint32_t len) override
         {
           yield();
+          
+          if (_lineReader.buffered() > 0)
+            return _lineReader.drain(buffer, len);
+            
           return client.read(buffer, len);
         }
     
@@ -129,6 +164,7 @@ namespace websockets2_generic
         {
           yield();
           client.stop();
+          _lineReader.clear();
         }
     
         virtual ~EthernetTcpClient()
@@ -138,6 +174,8 @@ namespace websockets2_generic
     
       protected:
         EthernetClient client;
+        TransportOptions _options;
+        BufferedLineReader _lineReader;
     
         int getSocket() const override
         {
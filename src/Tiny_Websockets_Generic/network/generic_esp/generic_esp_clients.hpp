@@ -33,6 +33,7 @@
 
 #include <Tiny_Websockets_Generic/internals/ws_common.hpp>
 #include <Tiny_Websockets_Generic/network/tcp_client.hpp>
+#include <Tiny_Websockets_Generic/network/line_reader.hpp>
 
 namespace websockets2_generic
 {
@@ -44,10 +45,7 @@ namespace websockets2_generic
       public:
         GenericEspTcpClient(WifiClientImpl c) : client(c) 
         {
-        
-#if ( defined(ESP32)  || defined(ESP8266) )   
-          client.setNoDelay(true);
-#endif          
+          applyOptions();
         }
     
         GenericEspTcpClient() {}
@@ -55,19 +53,45 @@ namespace websockets2_generic
         bool connect(const WSString& host, const int port) 
         {
           yield();
+          
+#if defined(ESP8266)
+          // ESP8266 connect() waits for the Stream timeout, which is also the sketch's timeout for
+          // readBytes() and friends: only borrowed for the connect
+          const unsigned long streamTimeout = client.getTimeout();
+          
+          if (_options.has(TransportOptions::Option_ConnectTimeout)) 
+            client.setTimeout(_options.connectTimeoutMs);
+#endif
+          
           auto didConnect = client.connect(host.c_str(), port);
           
-#if ( defined(ESP32)  || defined(ESP8266) )           
-          client.setNoDelay(true);
+#if defined(ESP8266)
+          client.setTimeout(streamTimeout);
 #endif
           
+          applyOptions();
+          
           return didConnect;
         }
+        
+        uint16_t setOptions(const TransportOptions& options) override 
+        {
+          _options = options;
+          
+          const uint16_t ignored = applyOptions() | (options.options & unsupportedOptions());
+          
+          if (ignored) 
+          {
+            LOGWARN1("GenericEspTcpClient::setOptions: ignored options =", ignored);
+          }
+          
+          return ignored;
+        }
     
         bool poll() 
         {
           yield();
-          return client.available();
+          return _lineReader.buffered() > 0 || client.available();
         }
     
         bool available() override 
@@ -98,27 +122,44 @@ namespace websockets2_generic
     
         WSString readLine() override 
         {
-          WSString line = "";
-    
-          int ch = -1;
+          const bool hasTimeout = _options.has(TransportOptions::Option_ReadTimeout) && _options.readTimeoutMs > 0;
+          unsigned long lastRead = millis();
           
-          while ( ch != '\n' && available()) 
-          {
-            ch = client.read();
-            
-            if (ch < 0) 
-              continue;
+          return _lineReader.readLine(
+            [this, &lastRead](uint8_t* buffer, const uint32_t len) 
+            {
+              // Only ask for what is there, so a block read never waits on the stack
+              int count = client.available();
               
-            line += (char) ch;
-          }
-    
-          return line;
+              if (count <= 0) 
+                return static_cast<int32_t>(0);
+                
+              count = client.read(buffer, (static_cast<uint32_t>(count) < len) ? count : len);
+              
+              if (count > 0) 
+                lastRead = millis();
+                
+              return static_cast<int32_t>(count);
+            },
+            [this, hasTimeout, &lastRead]() 
+            {
+              if (hasTimeout && (millis() - lastRead > _options.readTimeoutMs))
+              {
+                LOGWARN("GenericEspTcpClient::readLine: read timeout");
+                close();
+              }
+              
+              return available();
+            });
         }
     
         uint32_t read(uint8_t* buffer, const uint32_t len) override 
         {
           yield();
           
+          if (_lineReader.buffered() > 0) 
+            return _lineReader.drain(buffer, len);
+          
           return 
             client.read(buffer, len);
         }
@@ -127,6 +168,7 @@ namespace websockets2_generic
         {
           yield();
           client.stop();
+          _lineReader.clear();
         }
     
         virtual ~GenericEspTcpClient() 
@@ -136,11 +178,86 @@ namespace websockets2_generic
     
       protected:
         WifiClientImpl client;
+        TransportOptions _options;
+        BufferedLineReader _lineReader;
+        
+        // Options the stack has no call for at all. The read timeout is kept by readLine() itself
+        virtual uint16_t unsupportedOptions() const 
+        {
+          // no socket level buffer tuning on these stacks, and write() can't be bounded
+          uint16_t unsupported = TransportOptions::Option_SendBuffer | TransportOptions::Option_ReceiveBuffer | 
+                                 TransportOptions::Option_SendTimeout;
+          
+#if !defined(ESP8266)
+          unsupported |= TransportOptions::Option_KeepAlive | TransportOptions::Option_ConnectTimeout;
+#endif
+
+          return unsupported;
+        }
+        
+        // Applies what the stack supports, returns the options it could not set on this client
+        uint16_t applyOptions() 
+        {
+          uint16_t ignored = 0;
+          
+#if ( defined(ESP32)  || defined(ESP8266) )
+          // KH, NoDelay stays the default on ESP unless the application asks otherwise
+          client.setNoDelay(_options.has(TransportOptions::Option_NoDelay) ? _options.noDelay : true);
+#else
+          ignored |= _options.options & TransportOptions::Option_NoDelay;
+#endif
+
+#if defined(ESP8266)
+          if (_options.has(TransportOptions::Option_KeepAlive)) 
+          {
+            if (_options.keepAliveIdle > 0) 
+            {
+              client.keepAlive(_options.keepAliveIdle, 
+                               _options.keepAliveInterval > 0 ? _options.keepAliveInterval : TCP_DEFAULT_KEEPALIVE_INTERVAL_SEC, 
+                               _options.keepAliveCount > 0 ? _options.keepAliveCount : TCP_DEFAULT_KEEPALIVE_COUNT);
+            }
+            else 
+            {
+              client.disableKeepAlive();
+            }
+          }
+#endif
+
+          return ignored;
+        }
     
         int getSocket() const override 
         {
           return -1;
         }
     };
+    
+    // The Ethernet library and the ones that follow its API (EthernetLarge, EthernetENC, NativeEthernet,
+    // STM32Ethernet) bound connect() with setConnectionTimeout()
+    template <class EthernetClientImpl>
+    class GenericEthernetTcpClient : public GenericEspTcpClient<EthernetClientImpl> 
+    {
+      public:
+        GenericEthernetTcpClient(EthernetClientImpl c) : GenericEspTcpClient<EthernetClientImpl>(c) {}
+        
+        GenericEthernetTcpClient() {}
+        
+        bool connect(const WSString& host, const int port) override 
+        {
+          const TransportOptions& options = this->_options;
+          
+          // 0 keeps the library default
+          if (options.has(TransportOptions::Option_ConnectTimeout) && options.connectTimeoutMs > 0) 
+            this->client.setConnectionTimeout(options.connectTimeoutMs > 0xFFFF ? 0xFFFF : options.connectTimeoutMs);
+            
+          return GenericEspTcpClient<EthernetClientImpl>::connect(host, port);
+        }
+        
+      protected:
+        uint16_t unsupportedOptions() const override 
+        {
+          return GenericEspTcpClient<EthernetClientImpl>::unsupportedOptions() & ~TransportOptions::Option_ConnectTimeout;
+        }
+    };
   }   // namespace network2_generic
 }     // namespace websockets2_generic
@@ -0,0 +1,135 @@
+/****************************************************************************************************************************
+  line_reader.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+
+#include <string.h>
+
+#ifndef WS_LINE_READER_BUFFER_SIZE
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define WS_LINE_READER_BUFFER_SIZE      1024
+  #else
+    // one SPI burst on W5x00 / WiFiNINA instead of a bus transaction per byte
+    #define WS_LINE_READER_BUFFER_SIZE      128
+  #endif
+#endif
+
+namespace websockets2_generic
+{
+  namespace network2_generic
+  {
+    // Reads handshake lines in blocks instead of byte by byte. Bytes that follow the last line
+    // (the first frames of the peer) stay buffered and must be handed out by the client's read()
+    // before touching the stack again, see drain().
+    class BufferedLineReader 
+    {
+      public:
+        BufferedLineReader() : _start(0), _end(0) {}
+        
+        // Appends data up to and including the first '\n' to line. Returns the number of bytes consumed,
+        // complete tells whether the '\n' was found.
+        static size_t scanLine(const uint8_t* data, const size_t len, WSString& line, bool& complete) 
+        {
+          const uint8_t* newline = static_cast<const uint8_t*>(memchr(data, '\n', len));
+          const size_t count = newline ? static_cast<size_t>(newline - data) + 1 : len;
+          
+          line.append(reinterpret_cast<const char*>(data), count);
+          complete = newline != nullptr;
+          
+          return count;
+        }
+        
+        // fill(buffer, maxLen) pulls a block from the stack and returns the byte count (<= 0 when nothing
+        // is there yet), alive() tells whether to keep waiting for the rest of the line.
+        template <class Fill, class Alive>
+        WSString readLine(Fill fill, Alive alive) 
+        {
+          WSString line = "";
+          
+          while (true) 
+          {
+            if (_start < _end) 
+            {
+              bool complete;
+              
+              _start += scanLine(_buffer + _start, _end - _start, line, complete);
+              
+              if (complete) 
+                return line;
+            }
+            
+            if (!alive()) 
+              return line;
+              
+            _start = 0;
+            _end = 0;
+            
+            int32_t count = fill(_buffer, sizeof(_buffer));
+            
+            if (count > 0) 
+              _end = static_cast<size_t>(count);
+          }
+        }
+        
+        size_t buffered() const 
+        {
+          return _end - _start;
+        }
+        
+        // Hands out bytes read ahead by readLine()
+        uint32_t drain(uint8_t* buffer, const uint32_t len) 
+        {
+          size_t count = buffered();
+          
+          if (count > len) 
+            count = len;
+            
+          memcpy(buffer, _buffer + _start, count);
+          _start += count;
+          
+          return static_cast<uint32_t>(count);
+        }
+        
+        void clear() 
+        {
+          _start = 0;
+          _end = 0;
+        }
+    
+      private:
+        uint8_t _buffer[WS_LINE_READER_BUFFER_SIZE];
+        size_t _start;
+        size_t _end;
+    };
+  }   // namespace network2_generic
+}     // namespace websockets2_generic
@@ -36,6 +36,18 @@
 #include <Tiny_Websockets_Generic/internals/ws_common.hpp>
 #include <Tiny_Websockets_Generic/network/tcp_client.hpp>
 #include <Tiny_Websockets_Generic/network/tcp_socket.hpp>
+#include <Tiny_Websockets_Generic/network/line_reader.hpp>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
 
 #define INVALID_SOCKET -1
 
@@ -43,6 +55,8 @@ namespace websockets2_generic
 {
   namespace network2_generic
   {
+    // The socket is non-blocking, so a frame split over several readiness events never stalls an event
+    // loop. Handshake lines, sends and waitReadable() wait with poll() instead, unless a send queue is set
     class LinuxTcpClient : public TcpClient 
     {
       public:
@@ -54,7 +68,13 @@ namespace websockets2_generic
         void send(const WSString&& data) override;
         void send(const uint8_t* data, const uint32_t len) override;
         WSString readLine() override;
-        void read(uint8_t* buffer, const uint32_t len) override;
+        uint32_t read(uint8_t* buffer, const uint32_t len) override;
+        uint16_t setOptions(const TransportOptions& options) override;
+        void waitReadable() override;
+        bool waitReadableFor(const int timeoutMs) override;
+        void setSendQueueLimit(const uint32_t limit) override;
+        uint32_t pendingSend() const override;
+        bool flushSend() override;
         void close() override;
         virtual ~LinuxTcpClient();
     
@@ -63,10 +83,530 @@ namespace websockets2_generic
         {
           return _socket;
         }
+        
+        bool connectSocket(const struct sockaddr* addr, const socklen_t addrLen);
+        uint16_t applyOptions();
+        
+        // recv() without the read-ahead of readLine()
+        uint32_t readSocket(uint8_t* buffer, const uint32_t len);
+        
+        // as much as the socket takes without waiting, -1 when the connection failed
+        ssize_t sendSome(const uint8_t* data, const uint32_t len);
+        
+        // every byte, waiting for room up to the send timeout each time. False when the connection is gone
+        bool sendAll(const uint8_t* data, const uint32_t len);
+        void queueSend(const uint8_t* data, const uint32_t len);
+        
+        static bool makeNonBlocking(const int socket);
     
-      private:
         int _socket;
+        TransportOptions _options;
+        BufferedLineReader _lineReader;
+        
+        // the last recv() found nothing, poll() has to ask the kernel again
+        bool _drained;
+        
+        // see setSendQueueLimit(), 0 while sends block
+        uint32_t _sendQueueLimit;
+        WSString _sendQueue;
     };
+    
+    LinuxTcpClient::LinuxTcpClient(int socket) : _socket(socket), _drained(false), _sendQueueLimit(0) 
+    {
+      if (_socket != INVALID_SOCKET && !makeNonBlocking(_socket)) 
+      {
+        ::close(_socket);
+        _socket = INVALID_SOCKET;
+      }
+    }
+    
+    bool LinuxTcpClient::makeNonBlocking(const int socket) 
+    {
+      int flags = fcntl(socket, F_GETFL, 0);
+      
+      return flags >= 0 && ((flags & O_NONBLOCK) || fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0);
+    }
+    
+    uint16_t LinuxTcpClient::setOptions(const TransportOptions& options) 
+    {
+      _options = options;
+      
+      return applyOptions();
+    }
+    
+    uint16_t LinuxTcpClient::applyOptions() 
+    {
+      // connect timeout is used by connect() itself, the rest needs an open socket
+      if (_socket == INVALID_SOCKET) 
+        return 0;
+        
+      uint16_t ignored = 0;
+      
+      if (_options.has(TransportOptions::Option_NoDelay)) 
+      {
+        int value = _options.noDelay ? 1 : 0;
+        
+        if (setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value)) != 0) 
+          ignored |= TransportOptions::Option_NoDelay;
+      }
+    
+      if (_options.has(TransportOptions::Option_SendBuffer)) 
+      {
+        int value = static_cast<int>(_options.sendBufferSize);
+        
+        if (setsockopt(_socket, SOL_SOCKET, SO_SNDBUF, &value, sizeof(value)) != 0) 
+          ignored |= TransportOptions::Option_SendBuffer;
+      }
+      
+      if (_options.has(TransportOptions::Option_ReceiveBuffer)) 
+      {
+        int value = static_cast<int>(_options.receiveBufferSize);
+        
+        if (setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &value, sizeof(value)) != 0) 
+          ignored |= TransportOptions::Option_ReceiveBuffer;
+      }
+      
+      if (_options.has(TransportOptions::Option_KeepAlive)) 
+      {
+        int enable  = _options.keepAliveIdle > 0 ? 1 : 0;
+        bool failed = setsockopt(_socket, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable)) != 0;
+        
+        if (enable) 
+        {
+          int idle      = static_cast<int>(_options.keepAliveIdle);
+          int interval  = static_cast<int>(_options.keepAliveInterval);
+          int count     = static_cast<int>(_options.keepAliveCount);
+          
+          failed |= setsockopt(_socket, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) != 0;
+          
+          if (interval > 0) 
+            failed |= setsockopt(_socket, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) != 0;
+            
+          if (count > 0) 
+            failed |= setsockopt(_socket, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count)) != 0;
+        }
+        
+        if (failed) 
+          ignored |= TransportOptions::Option_KeepAlive;
+      }
+      
+      // The read and send timeouts bound the poll() of waitReadable() and send(), SO_RCVTIMEO and SO_SNDTIMEO
+      // mean nothing on a non-blocking socket
+      
+      if (ignored) 
+      {
+        LOGWARN1("LinuxTcpClient::setOptions: ignored options =", ignored);
+      }
+      
+      return ignored;
+    }
+    
+    bool LinuxTcpClient::connectSocket(const struct sockaddr* addr, const socklen_t addrLen) 
+    {
+      if (!makeNonBlocking(_socket)) 
+        return false;
+        
+      // Non-blocking connect, waiting for writability up to the connect timeout (forever without one)
+      const int timeoutMs = _options.has(TransportOptions::Option_ConnectTimeout) && _options.connectTimeoutMs > 0 ? 
+                            static_cast<int>(_options.connectTimeoutMs) : -1;
+                            
+      bool connected = ::connect(_socket, addr, addrLen) == 0;
+      
+      if (!connected && errno == EINPROGRESS) 
+      {
+        struct pollfd pfd;
+        pfd.fd      = _socket;
+        pfd.events  = POLLOUT;
+        pfd.revents = 0;
+        
+        int res;
+        
+        do 
+        {
+          res = ::poll(&pfd, 1, timeoutMs);
+        } while (res < 0 && errno == EINTR);
+        
+        if (res > 0) 
+        {
+          int error = 0;
+          socklen_t errorLen = sizeof(error);
+          
+          connected = getsockopt(_socket, SOL_SOCKET, SO_ERROR, &error, &errorLen) == 0 && error == 0;
+        }
+      }
+      
+      return connected;
+    }
+    
+    bool LinuxTcpClient::connect(const WSString& host, int port) 
+    {
+      struct addrinfo hints, *servinfo, *p;
+      
+      memset(&hints, 0, sizeof hints);
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+    
+      if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &servinfo) != 0) 
+      {
+        return false;
+      }
+    
+      // connect to the first address that accepts us
+      for (p = servinfo; p != NULL; p = p->ai_next) 
+      {
+        _socket = ::socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        
+        if (_socket == INVALID_SOCKET) 
+          continue;
+    
+        if (connectSocket(p->ai_addr, p->ai_addrlen)) 
+          break;
+    
+        ::close(_socket);
+        _socket = INVALID_SOCKET;
+      }
+    
+      freeaddrinfo(servinfo);
+      
+      if (_socket == INVALID_SOCKET) 
+        return false;
+      
+      _drained = false;
+      applyOptions();
+      
+      return true;
+    }
+    
+    bool LinuxTcpClient::poll() 
+    {
+      if (!available()) 
+        return false;
+        
+      if (_lineReader.buffered() > 0) 
+        return true;
+        
+      // Until a recv() came back empty there may be more, and trying it costs no more than asking
+      if (!_drained) 
+        return true;
+    
+      struct pollfd pfd;
+      pfd.fd = _socket;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      
+      if (::poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) 
+      {
+        _drained = false;
+        return true;
+      }
+      
+      return false;
+    }
+    
+    void LinuxTcpClient::waitReadable() 
+    {
+      if (!available() || _lineReader.buffered() > 0) 
+        return;
+        
+      struct pollfd pfd;
+      pfd.fd = _socket;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      
+      const int timeoutMs = _options.has(TransportOptions::Option_ReadTimeout) && _options.readTimeoutMs > 0 ? 
+                            static_cast<int>(_options.readTimeoutMs) : -1;
+      int res;
+      
+      do 
+      {
+        res = ::poll(&pfd, 1, timeoutMs);
+      } while (res < 0 && errno == EINTR);
+      
+      if (res == 0) 
+      {
+        // the peer stalled
+        LOGWARN("LinuxTcpClient::read: read timeout");
+        close();
+        return;
+      }
+      
+      _drained = false;
+    }
+    
+    bool LinuxTcpClient::waitReadableFor(const int timeoutMs) 
+    {
+      if (poll()) 
+        return true;
+        
+      if (!available()) 
+        return false;
+        
+      struct pollfd pfd;
+      pfd.fd = _socket;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      
+      int res;
+      
+      do 
+      {
+        res = ::poll(&pfd, 1, timeoutMs);
+      } while (res < 0 && errno == EINTR);
+      
+      if (res <= 0) 
+        return false;
+        
+      _drained = false;
+      
+      return true;
+    }
+    
+    bool LinuxTcpClient::available() 
+    {
+      return _socket != INVALID_SOCKET;
+    }
+    
+    void LinuxTcpClient::send(const WSString& data) 
+    {
+      this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+    
+    void LinuxTcpClient::send(const WSString&& data) 
+    {
+      this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+    
+    void LinuxTcpClient::send(const uint8_t* data, const uint32_t len) 
+    {
+      if (!available()) 
+        return;
+        
+      if (_sendQueueLimit > 0) 
+      {
+        queueSend(data, len);
+        return;
+      }
+      
+      // what was queued before the queue was turned off goes first
+      if (!_sendQueue.empty()) 
+      {
+        WSString queued;
+        queued.swap(_sendQueue);
+        
+        if (!sendAll(reinterpret_cast<const uint8_t*>(queued.data()), static_cast<uint32_t>(queued.size()))) 
+          return;
+      }
+      
+      sendAll(data, len);
+    }
+    
+    ssize_t LinuxTcpClient::sendSome(const uint8_t* data, const uint32_t len) 
+    {
+      uint32_t sent = 0;
+      
+      while (sent < len) 
+      {
+        const ssize_t res = ::send(_socket, data + sent, len - sent, MSG_NOSIGNAL);
+        
+        if (res >= 0) 
+        {
+          sent += res;
+          continue;
+        }
+        
+        if (errno == EINTR) 
+          continue;
+          
+        if (errno == EAGAIN || errno == EWOULDBLOCK) 
+          break;
+          
+        return -1;
+      }
+      
+      return sent;
+    }
+    
+    bool LinuxTcpClient::sendAll(const uint8_t* data, const uint32_t len) 
+    {
+      const int timeoutMs = _options.has(TransportOptions::Option_SendTimeout) && _options.sendTimeoutMs > 0 ? 
+                            static_cast<int>(_options.sendTimeoutMs) : -1;
+      uint32_t sent = 0;
+      
+      while (true) 
+      {
+        const ssize_t res = sendSome(data + sent, len - sent);
+        
+        if (res < 0) 
+        {
+          close();
+          return false;
+        }
+        
+        sent += res;
+        
+        if (sent == len) 
+          return true;
+          
+        // Send buffer full: wait for room, as a blocking socket would, but not beyond the send timeout
+        struct pollfd pfd;
+        pfd.fd = _socket;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        
+        int ready;
+        
+        do 
+        {
+          ready = ::poll(&pfd, 1, timeoutMs);
+        } while (ready < 0 && errno == EINTR);
+        
+        if (ready == 0) 
+        {
+          // the peer stopped reading
+          LOGWARN("LinuxTcpClient::send: send timeout");
+          close();
+          return false;
+        }
+      }
+    }
+    
+    void LinuxTcpClient::queueSend(const uint8_t* data, const uint32_t len) 
+    {
+      ssize_t sent = 0;
+      
+      // never ahead of what is queued already
+      if (_sendQueue.empty()) 
+      {
+        sent = sendSome(data, len);
+        
+        if (sent < 0) 
+        {
+          close();
+          return;
+        }
+        
+        if (static_cast<uint32_t>(sent) == len) 
+          return;
+      }
+      
+      const uint32_t rest = len - static_cast<uint32_t>(sent);
+      
+      if (_sendQueue.size() + rest > _sendQueueLimit) 
+      {
+        LOGWARN1("LinuxTcpClient::send: the peer stopped reading, queued bytes =", _sendQueue.size() + rest);
+        close();
+        return;
+      }
+      
+      _sendQueue.append(reinterpret_cast<const char*>(data) + sent, rest);
+    }
+    
+    void LinuxTcpClient::setSendQueueLimit(const uint32_t limit) 
+    {
+      _sendQueueLimit = limit;
+    }
+    
+    uint32_t LinuxTcpClient::pendingSend() const 
+    {
+      return static_cast<uint32_t>(_sendQueue.size());
+    }
+    
+    bool LinuxTcpClient::flushSend() 
+    {
+      if (_sendQueue.empty()) 
+        return true;
+        
+      const ssize_t sent = sendSome(reinterpret_cast<const uint8_t*>(_sendQueue.data()), static_cast<uint32_t>(_sendQueue.size()));
+      
+      if (sent < 0) 
+      {
+        close();
+        return false;
+      }
+      
+      if (static_cast<size_t>(sent) < _sendQueue.size()) 
+      {
+        _sendQueue.erase(0, sent);
+        return false;
+      }
+      
+      // an idle connection doesn't keep the memory of a burst
+      WSString().swap(_sendQueue);
+      
+      return true;
+    }
+    
+    WSString LinuxTcpClient::readLine() 
+    {
+      return _lineReader.readLine(
+        [this](uint8_t* buffer, const uint32_t len) 
+        {
+          const uint32_t count = readSocket(buffer, len);
+          
+          // the rest of the line isn't there yet
+          if (count == static_cast<uint32_t>(-1)) 
+            waitReadable();
+            
+          return static_cast<int32_t>(count);
+        },
+        [this]() 
+        {
+          return available();
+        });
+    }
+    
+    uint32_t LinuxTcpClient::read(uint8_t* buffer, const uint32_t len) 
+    {
+      if (_lineReader.buffered() > 0) 
+        return _lineReader.drain(buffer, len);
+        
+      return readSocket(buffer, len);
+    }
+    
+    uint32_t LinuxTcpClient::readSocket(uint8_t* buffer, const uint32_t len) 
+    {
+      ssize_t res = ::recv(_socket, buffer, len, 0);
+      
+      if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) 
+      {
+        // Nothing there, the caller may retry while available() once poll() or waitReadable() tells
+        _drained = true;
+        return static_cast<uint32_t>(-1);
+      }
+      
+      if (res < 0 && errno == EINTR) 
+        return static_cast<uint32_t>(-1);
+      
+      if (res <= 0) 
+      {
+        // Orderly shutdown by the peer or a socket error
+        close();
+        return 0;
+      }
+      
+      return static_cast<uint32_t>(res);
+    }
+    
+    void LinuxTcpClient::close() 
+    {
+      if (_socket != INVALID_SOCKET) 
+      {
+        // last chance for what send() queued, the close frame most of all
+        if (!_sendQueue.empty()) 
+          sendSome(reinterpret_cast<const uint8_t*>(_sendQueue.data()), static_cast<uint32_t>(_sendQueue.size()));
+          
+        ::close(_socket);
+        _socket = INVALID_SOCKET;
+      }
+      
+      WSString().swap(_sendQueue);
+      _lineReader.clear();
+    }
+    
+    LinuxTcpClient::~LinuxTcpClient() 
+    {
+      close();
+    }
   }   // namespace network2_generic
 }     // namespace websockets2_generic
 
@@ -37,6 +37,11 @@
 #include <Tiny_Websockets_Generic/network/tcp_server.hpp>
 #include <Tiny_Websockets_Generic/network/linux/linux_tcp_client.hpp>
 
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+
 #define DEFAULT_BACKLOG_SIZE 5
 
 namespace websockets2_generic
@@ -46,7 +51,9 @@ namespace websockets2_generic
     class LinuxTcpServer : public TcpServer 
     {
       public:
-        LinuxTcpServer(size_t backlog = DEFAULT_BACKLOG_SIZE) : _num_backlog(backlog) {}
+        // reusePort lets several servers (one per thread) listen on the same port, the kernel spreads accepts between them
+        LinuxTcpServer(size_t backlog = DEFAULT_BACKLOG_SIZE, bool reusePort = false) : 
+          _socket(INVALID_SOCKET), _num_backlog(backlog), _reusePort(reusePort) {}
         bool listen(const uint16_t port) override;
         bool poll() override;
         TcpClient* accept() override;
@@ -60,10 +67,84 @@ namespace websockets2_generic
           return _socket;
         }
     
-      private:
         int _socket;
+        
+      private:
         size_t _num_backlog;
+        bool _reusePort;
     };
+    
+    bool LinuxTcpServer::listen(const uint16_t port) 
+    {
+      _socket = ::socket(AF_INET, SOCK_STREAM, 0);
+      
+      if (_socket == INVALID_SOCKET) 
+        return false;
+    
+      int enable = 1;
+      setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+      
+      if (_reusePort && setsockopt(_socket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0) 
+      {
+        close();
+        return false;
+      }
+    
+      struct sockaddr_in addr;
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(port);
+    
+      if (::bind(_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+          ::listen(_socket, _num_backlog) != 0) 
+      {
+        close();
+        return false;
+      }
+    
+      return true;
+    }
+    
+    bool LinuxTcpServer::poll() 
+    {
+      if (!available()) 
+        return false;
+    
+      struct pollfd pfd;
+      pfd.fd = _socket;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      
+      return ::poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+    }
+    
+    TcpClient* LinuxTcpServer::accept() 
+    {
+      // non-blocking from the start, see LinuxTcpClient
+      int client = ::accept4(_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      
+      return new LinuxTcpClient(client);
+    }
+    
+    bool LinuxTcpServer::available() 
+    {
+      return _socket != INVALID_SOCKET;
+    }
+    
+    void LinuxTcpServer::close() 
+    {
+      if (_socket != INVALID_SOCKET) 
+      {
+        ::close(_socket);
+        _socket = INVALID_SOCKET;
+      }
+    }
+    
+    LinuxTcpServer::~LinuxTcpServer() 
+    {
+      close();
+    }
   }   // namespace network2_generic
 }     // namespace websockets2_generic
 
@@ -0,0 +1,1046 @@
+/****************************************************************************************************************************
+  linux_uring_tcp.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#ifdef __linux__ 
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+#include <Tiny_Websockets_Generic/network/linux/linux_tcp_client.hpp>
+#include <Tiny_Websockets_Generic/network/linux/linux_tcp_server.hpp>
+
+#include <linux/io_uring.h>
+#include <linux/version.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <stdio.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef WS_URING_ENTRIES
+  #define WS_URING_ENTRIES        4096
+#endif
+
+// Provided receive buffers, shared by every connection of a ring. Must be a power of 2
+#ifndef WS_URING_BUFFERS
+  #define WS_URING_BUFFERS        1024
+#endif
+
+#ifndef WS_URING_BUFFER_SIZE
+  #define WS_URING_BUFFER_SIZE    4096
+#endif
+
+namespace websockets2_generic
+{
+  namespace network2_generic
+  {
+    class IoUringTcpClient;
+    
+    // Minimal io_uring ring (raw syscalls, no liburing) shared by a server and the clients it accepted.
+    // Submissions are queued and only handed to the kernel by submit(), so one io_uring_enter
+    // carries the sends of every connection. Completions are reaped from shared memory without syscalls.
+    class IoUringContext 
+    {
+      public:
+        IoUringContext(const unsigned entries = WS_URING_ENTRIES);
+        
+        IoUringContext(const IoUringContext& other) = delete;
+        IoUringContext& operator=(const IoUringContext& other) = delete;
+        
+        static bool isSupported();
+        
+        bool available() const 
+        {
+          return _ringFd >= 0;
+        }
+        
+        int fd() const 
+        {
+          return _ringFd;
+        }
+    
+        void attach(IoUringTcpClient* client);
+        void detach(IoUringTcpClient* client);
+        
+        void armAccept(const int listenFd);
+        void armRecv(IoUringTcpClient* client);
+        void armSend(IoUringTcpClient* client);
+        
+        // Returns the buffer to the kernel once its content was consumed
+        void recycle(const uint16_t bid);
+        
+        const uint8_t* buffer(const uint16_t bid) const 
+        {
+          return _buffers + (static_cast<size_t>(bid) * WS_URING_BUFFER_SIZE);
+        }
+    
+        void submit(const bool wait = false);
+        void reap(const bool wait = false);
+    
+        int popAccepted();
+        int popReady();
+        
+        ~IoUringContext();
+    
+      private:
+        enum Op 
+        {
+          Op_Accept = 1,
+          Op_Recv,
+          Op_Send
+        };
+        
+        int _ringFd;
+        
+        // submission queue
+        void* _sqRing;
+        size_t _sqRingSize;
+        unsigned* _sqHead;
+        unsigned* _sqTail;
+        unsigned _sqMask;
+        unsigned* _sqArray;
+        struct io_uring_sqe* _sqes;
+        size_t _sqesSize;
+        unsigned _sqLocalTail;
+        unsigned _pending;
+        
+        // completion queue
+        void* _cqRing;
+        size_t _cqRingSize;
+        unsigned* _cqHead;
+        unsigned* _cqTail;
+        unsigned _cqMask;
+        struct io_uring_cqe* _cqes;
+        
+        // provided buffers ring. Addressed as a plain array: in C++ the uapi flex array union
+        // places io_uring_buf_ring::bufs at offset 8, while the kernel expects it at 0
+        struct io_uring_buf* _bufRing;
+        size_t _bufRingSize;
+        uint8_t* _buffers;
+        uint16_t _bufTail;
+        
+        int _listenFd;
+        bool _listenReady;
+        
+        // indexed by socket descriptor, a generation tells completions of a reused descriptor apart
+        std::vector<IoUringTcpClient*> _clients;
+        std::vector<uint32_t> _generations;
+        
+        // send buffers of clients destroyed while the kernel was still reading them
+        std::vector<std::pair<uint64_t, std::string*>> _orphans;
+        
+        // clients that ran out of provided buffers and wait for a recycle to re-arm
+        std::vector<int> _starved;
+        
+        std::deque<int> _accepted;
+        std::vector<int> _ready;
+    
+        struct io_uring_sqe* getSqe();
+        uint64_t userData(const Op op, const int fd) const;
+        IoUringTcpClient* clientFor(const uint64_t userData) const;
+        void handle(const struct io_uring_cqe& cqe);
+        void markReady(IoUringTcpClient* client);
+        void release();
+        
+        friend class IoUringTcpClient;
+        friend class IoUringTcpServer;
+    };
+    
+    // Falls back to plain LinuxTcpClient behaviour when it has no ring
+    class IoUringTcpClient : public LinuxTcpClient 
+    {
+      public:
+        IoUringTcpClient(std::shared_ptr<IoUringContext> context, int socket);
+        IoUringTcpClient();
+        
+        bool connect(const WSString& host, int port) override;
+        bool poll() override;
+        void send(const WSString& data) override;
+        void send(const WSString&& data) override;
+        void send(const uint8_t* data, const uint32_t len) override;
+        WSString readLine() override;
+        uint32_t read(uint8_t* buffer, const uint32_t len) override;
+        uint16_t setOptions(const TransportOptions& options) override;
+        uint32_t pendingSend() const override;
+        void close() override;
+        virtual ~IoUringTcpClient();
+    
+      private:
+        struct Chunk 
+        {
+          uint16_t bid;
+          uint32_t len;
+          uint32_t offset;
+        };
+        
+        std::shared_ptr<IoUringContext> _context;
+        std::deque<Chunk> _received;
+        bool _eof;
+        bool _queuedReady;
+        
+        // bytes waiting for the next submission, and the ones the kernel is sending
+        std::string _outbox;
+        std::string* _inflight;
+        uint32_t _inflightOffset;
+        
+        friend class IoUringContext;
+    };
+    
+    // Multishot accept on an io_uring, falls back to LinuxTcpServer (epoll/poll) when the kernel lacks support.
+    // getSocket() returns the ring descriptor, which becomes readable on any completion.
+    class IoUringTcpServer : public LinuxTcpServer 
+    {
+      public:
+        IoUringTcpServer(size_t backlog = DEFAULT_BACKLOG_SIZE, bool reusePort = false) : LinuxTcpServer(backlog, reusePort) {}
+        bool listen(const uint16_t port) override;
+        bool poll() override;
+        TcpClient* accept() override;
+        int nextReadySocket() override;
+        void flush() override;
+        void close() override;
+        
+        bool usingIoUring() const 
+        {
+          return _context != nullptr;
+        }
+        
+        virtual ~IoUringTcpServer();
+    
+      protected:
+        int getSocket() const override 
+        {
+          return _context ? _context->fd() : _socket;
+        }
+    
+      private:
+        std::shared_ptr<IoUringContext> _context;
+    };
+    
+    ///////////////////////////////////////////////////////////////////
+    
+    inline int io_uring_setup(unsigned entries, struct io_uring_params* params)
+    {
+      return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+    
+    inline int io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+      return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+    
+    inline int io_uring_register(int fd, unsigned opcode, void* arg, unsigned numArgs)
+    {
+      return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, numArgs));
+    }
+    
+    IoUringContext::IoUringContext(const unsigned entries) :
+      _ringFd(-1), _sqRing(MAP_FAILED), _sqRingSize(0), _sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED)), _sqesSize(0),
+      _sqLocalTail(0), _pending(0), _cqRing(MAP_FAILED), _cqRingSize(0),
+      _bufRing(static_cast<struct io_uring_buf*>(MAP_FAILED)), _bufRingSize(0), _buffers(static_cast<uint8_t*>(MAP_FAILED)),
+      _bufTail(0), _listenFd(-1), _listenReady(false)
+    {
+      struct io_uring_params params;
+      memset(&params, 0, sizeof(params));
+      
+      // CQ twice the SQ, multishot operations post many completions per submission
+      params.flags = IORING_SETUP_CQSIZE;
+      params.cq_entries = entries * 2;
+    
+      _ringFd = io_uring_setup(entries, &params);
+      
+      if (_ringFd < 0) 
+        return;
+    
+      _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+      
+      if (params.features & IORING_FEAT_SINGLE_MMAP) 
+      {
+        _sqRingSize = _cqRingSize = (_sqRingSize > _cqRingSize ? _sqRingSize : _cqRingSize);
+      }
+    
+      _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+      
+      _cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? _sqRing :
+                mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+                
+      _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+      _sqes = static_cast<struct io_uring_sqe*>(mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES));
+    
+      if (_sqRing == MAP_FAILED || _cqRing == MAP_FAILED || _sqes == MAP_FAILED) 
+      {
+        release();
+        return;
+      }
+    
+      uint8_t* sq = static_cast<uint8_t*>(_sqRing);
+      _sqHead   = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+      _sqTail   = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+      _sqMask   = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+      _sqArray  = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+      _sqLocalTail = *_sqTail;
+    
+      uint8_t* cq = static_cast<uint8_t*>(_cqRing);
+      _cqHead   = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+      _cqTail   = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+      _cqMask   = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+      _cqes     = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    
+      // Provided buffer ring (group 0), registered with the kernel for buffer selection
+      _bufRingSize = WS_URING_BUFFERS * sizeof(struct io_uring_buf);
+      _bufRing = static_cast<struct io_uring_buf*>(mmap(nullptr, _bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+      _buffers = static_cast<uint8_t*>(mmap(nullptr, static_cast<size_t>(WS_URING_BUFFERS) * WS_URING_BUFFER_SIZE, 
+                                            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    
+      if (_bufRing == MAP_FAILED || _buffers == MAP_FAILED) 
+      {
+        release();
+        return;
+      }
+    
+      struct io_uring_buf_reg reg;
+      memset(&reg, 0, sizeof(reg));
+      reg.ring_addr     = reinterpret_cast<uint64_t>(_bufRing);
+      reg.ring_entries  = WS_URING_BUFFERS;
+      reg.bgid          = 0;
+    
+      if (io_uring_register(_ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) 
+      {
+        release();
+        return;
+      }
+    
+      for (uint16_t bid = 0; bid < WS_URING_BUFFERS; bid++) 
+      {
+        recycle(bid);
+      }
+    }
+    
+    bool IoUringContext::isSupported() 
+    {
+      static int supported = -1;
+      
+      if (supported < 0) 
+      {
+        // Multishot recv needs 6.0+, provided buffer rings 5.19+
+        const int required = KERNEL_VERSION(6, 0, 0);
+        
+        struct utsname name;
+        int major = 0, minor = 0;
+        
+        supported = uname(&name) == 0 && sscanf(name.release, "%d.%d", &major, &minor) == 2 && 
+                    KERNEL_VERSION(major, minor, 0) >= required;
+        
+        if (supported) 
+        {
+          IoUringContext probe(8);
+          supported = probe.available();
+        }
+      }
+      
+      return supported == 1;
+    }
+    
+    void IoUringContext::release() 
+    {
+      if (_buffers != MAP_FAILED) 
+        munmap(_buffers, static_cast<size_t>(WS_URING_BUFFERS) * WS_URING_BUFFER_SIZE);
+        
+      if (_bufRing != MAP_FAILED) 
+        munmap(_bufRing, _bufRingSize);
+        
+      if (_sqes != MAP_FAILED) 
+        munmap(_sqes, _sqesSize);
+        
+      if (_cqRing != MAP_FAILED && _cqRing != _sqRing) 
+        munmap(_cqRing, _cqRingSize);
+        
+      if (_sqRing != MAP_FAILED) 
+        munmap(_sqRing, _sqRingSize);
+    
+      if (_ringFd >= 0) 
+        ::close(_ringFd);
+    
+      _buffers  = static_cast<uint8_t*>(MAP_FAILED);
+      _bufRing  = static_cast<struct io_uring_buf*>(MAP_FAILED);
+      _sqes     = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+      _cqRing   = _sqRing = MAP_FAILED;
+      _ringFd   = -1;
+    }
+    
+    IoUringContext::~IoUringContext() 
+    {
+      for (auto& orphan : _orphans) 
+      {
+        delete orphan.second;
+      }
+      
+      release();
+    }
+    
+    uint64_t IoUringContext::userData(const Op op, const int fd) const 
+    {
+      uint32_t generation = static_cast<size_t>(fd) < _generations.size() ? _generations[fd] : 0;
+      
+      return (static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(fd) << 8) | op;
+    }
+    
+    IoUringTcpClient* IoUringContext::clientFor(const uint64_t userData) const 
+    {
+      size_t fd = (userData >> 8) & 0xFFFFFF;
+      uint32_t generation = userData >> 32;
+    
+      if (fd < _clients.size() && _generations[fd] == generation) 
+        return _clients[fd];
+    
+      return nullptr;
+    }
+    
+    struct io_uring_sqe* IoUringContext::getSqe() 
+    {
+      unsigned head = __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+      
+      if (_sqLocalTail - head > _sqMask) 
+      {
+        // Submission queue full, hand the batch to the kernel first
+        submit();
+        head = __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+        
+        if (_sqLocalTail - head > _sqMask) 
+          return nullptr;
+      }
+    
+      unsigned index = _sqLocalTail & _sqMask;
+      struct io_uring_sqe* sqe = &_sqes[index];
+      
+      memset(sqe, 0, sizeof(*sqe));
+      _sqArray[index] = index;
+      _sqLocalTail++;
+      _pending++;
+      
+      return sqe;
+    }
+    
+    void IoUringContext::submit(const bool wait) 
+    {
+      if (!available() || (_pending == 0 && !wait)) 
+        return;
+    
+      __atomic_store_n(_sqTail, _sqLocalTail, __ATOMIC_RELEASE);
+    
+      int res = io_uring_enter(_ringFd, _pending, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0);
+      
+      if (res >= 0) 
+      {
+        _pending -= (static_cast<unsigned>(res) < _pending ? res : _pending);
+      }
+    }
+    
+    void IoUringContext::attach(IoUringTcpClient* client) 
+    {
+      int fd = client->_socket;
+      
+      if (static_cast<size_t>(fd) >= _clients.size()) 
+      {
+        _clients.resize(fd + 1, nullptr);
+        _generations.resize(fd + 1, 0);
+      }
+    
+      _generations[fd]++;
+      _clients[fd] = client;
+    }
+    
+    void IoUringContext::detach(IoUringTcpClient* client) 
+    {
+      int fd = client->_socket;
+    
+      if (fd >= 0 && static_cast<size_t>(fd) < _clients.size() && _clients[fd] == client) 
+      {
+        // keep the kernel's pointer alive until the send completes
+        if (client->_inflight) 
+        {
+          _orphans.push_back(std::make_pair(userData(Op_Send, fd), client->_inflight));
+          client->_inflight = nullptr;
+        }
+        
+        _clients[fd] = nullptr;
+        _generations[fd]++;
+      }
+    
+      for (const IoUringTcpClient::Chunk& chunk : client->_received) 
+      {
+        recycle(chunk.bid);
+      }
+      
+      client->_received.clear();
+    }
+    
+    void IoUringContext::armAccept(const int listenFd) 
+    {
+      struct io_uring_sqe* sqe = getSqe();
+      
+      if (!sqe) 
+        return;
+    
+      _listenFd         = listenFd;
+      sqe->opcode       = IORING_OP_ACCEPT;
+      sqe->fd           = listenFd;
+      sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+      sqe->accept_flags = SOCK_CLOEXEC;
+      sqe->user_data    = Op_Accept;
+    }
+    
+    void IoUringContext::armRecv(IoUringTcpClient* client) 
+    {
+      struct io_uring_sqe* sqe = getSqe();
+      
+      if (!sqe) 
+        return;
+    
+      sqe->opcode     = IORING_OP_RECV;
+      sqe->fd         = client->_socket;
+      sqe->ioprio     = IORING_RECV_MULTISHOT;
+      sqe->flags      = IOSQE_BUFFER_SELECT;
+      sqe->buf_group  = 0;
+      sqe->user_data  = userData(Op_Recv, client->_socket);
+    }
+    
+    void IoUringContext::armSend(IoUringTcpClient* client) 
+    {
+      // One send in flight per connection keeps the stream ordered, everything queued meanwhile goes out in the next one
+      if (client->_inflight || client->_outbox.empty()) 
+        return;
+    
+      struct io_uring_sqe* sqe = getSqe();
+      
+      if (!sqe) 
+        return;
+    
+      client->_inflight = new std::string();
+      client->_inflight->swap(client->_outbox);
+      client->_inflightOffset = 0;
+    
+      sqe->opcode     = IORING_OP_SEND;
+      sqe->fd         = client->_socket;
+      sqe->addr       = reinterpret_cast<uint64_t>(client->_inflight->data());
+      sqe->len        = client->_inflight->size();
+      sqe->msg_flags  = MSG_NOSIGNAL;
+      sqe->user_data  = userData(Op_Send, client->_socket);
+    }
+    
+    void IoUringContext::recycle(const uint16_t bid) 
+    {
+      const unsigned mask = WS_URING_BUFFERS - 1;
+      struct io_uring_buf* buf = &_bufRing[_bufTail & mask];
+      
+      buf->addr = reinterpret_cast<uint64_t>(buffer(bid));
+      buf->len  = WS_URING_BUFFER_SIZE;
+      buf->bid  = bid;
+      
+      _bufTail++;
+      // the ring tail shares its slot with the reserved field of the first entry
+      __atomic_store_n(&_bufRing[0].resv, _bufTail, __ATOMIC_RELEASE);
+    
+      // buffers are back, connections that ran dry can receive again
+      if (!_starved.empty()) 
+      {
+        for (int fd : _starved) 
+        {
+          if (static_cast<size_t>(fd) < _clients.size() && _clients[fd]) 
+            armRecv(_clients[fd]);
+        }
+        
+        _starved.clear();
+      }
+    }
+    
+    void IoUringContext::markReady(IoUringTcpClient* client) 
+    {
+      if (!client->_queuedReady) 
+      {
+        client->_queuedReady = true;
+        _ready.push_back(client->_socket);
+      }
+    }
+    
+    void IoUringContext::handle(const struct io_uring_cqe& cqe) 
+    {
+      const Op op = static_cast<Op>(cqe.user_data & 0xFF);
+      const bool hasBuffer = cqe.flags & IORING_CQE_F_BUFFER;
+      const uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+    
+      if (op == Op_Accept) 
+      {
+        if (cqe.res >= 0) 
+        {
+          _accepted.push_back(cqe.res);
+          _listenReady = true;
+        }
+        
+        // the listening socket is still open: the multishot accept was terminated, arm it again
+        if (!(cqe.flags & IORING_CQE_F_MORE) && _listenFd >= 0 && cqe.res != -EINVAL && cqe.res != -EBADF) 
+          armAccept(_listenFd);
+          
+        return;
+      }
+    
+      if (op == Op_Send) 
+      {
+        for (size_t i = 0; i < _orphans.size(); i++) 
+        {
+          if (_orphans[i].first == cqe.user_data) 
+          {
+            delete _orphans[i].second;
+            _orphans.erase(_orphans.begin() + i);
+            return;
+          }
+        }
+      }
+    
+      IoUringTcpClient* client = clientFor(cqe.user_data);
+    
+      if (!client) 
+      {
+        // completion of a closed connection
+        if (hasBuffer) 
+          recycle(bid);
+          
+        return;
+      }
+    
+      if (op == Op_Recv) 
+      {
+        if (cqe.res > 0 && hasBuffer) 
+        {
+          client->_received.push_back({ bid, static_cast<uint32_t>(cqe.res), 0 });
+        }
+        else if (hasBuffer) 
+        {
+          recycle(bid);
+        }
+    
+        if (cqe.res == -ENOBUFS) 
+        {
+          _starved.push_back(client->_socket);
+        }
+        else if (cqe.res <= 0) 
+        {
+          client->_eof = true;
+        }
+        else if (!(cqe.flags & IORING_CQE_F_MORE)) 
+        {
+          armRecv(client);
+        }
+    
+        markReady(client);
+      }
+      else if (op == Op_Send) 
+      {
+        if (cqe.res < 0) 
+        {
+          client->_eof = true;
+          markReady(client);
+          return;
+        }
+    
+        client->_inflightOffset += cqe.res;
+    
+        if (client->_inflightOffset < client->_inflight->size()) 
+        {
+          // short send, queue the rest in front of anything appended meanwhile
+          client->_outbox.insert(0, *client->_inflight, client->_inflightOffset, std::string::npos);
+        }
+    
+        delete client->_inflight;
+        client->_inflight = nullptr;
+        
+        armSend(client);
+      }
+    }
+    
+    void IoUringContext::reap(const bool wait) 
+    {
+      if (!available()) 
+        return;
+    
+      unsigned head = *_cqHead;
+    
+      // Only enter the kernel if there is something to submit, or nothing to reap and the caller wants to wait
+      if (_pending > 0 || (wait && head == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE))) 
+      {
+        submit(wait);
+      }
+    
+      unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    
+      while (head != tail) 
+      {
+        struct io_uring_cqe cqe = _cqes[head & _cqMask];
+        head++;
+        
+        __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+        
+        handle(cqe);
+        
+        tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+      }
+    }
+    
+    int IoUringContext::popAccepted() 
+    {
+      if (_accepted.empty()) 
+        return -1;
+    
+      int fd = _accepted.front();
+      _accepted.pop_front();
+      
+      return fd;
+    }
+    
+    int IoUringContext::popReady() 
+    {
+      if (_listenReady) 
+      {
+        _listenReady = false;
+        return _ringFd;
+      }
+      
+      while (!_ready.empty()) 
+      {
+        int fd = _ready.back();
+        _ready.pop_back();
+        
+        if (static_cast<size_t>(fd) < _clients.size() && _clients[fd]) 
+        {
+          _clients[fd]->_queuedReady = false;
+          return fd;
+        }
+      }
+    
+      return -1;
+    }
+    
+    ///////////////////////////////////////////////////////////////////
+    
+    IoUringTcpClient::IoUringTcpClient(std::shared_ptr<IoUringContext> context, int socket) : 
+      LinuxTcpClient(socket), _context(context), _eof(false), _queuedReady(false), _inflight(nullptr), _inflightOffset(0)
+    {
+      if (_context && _socket != INVALID_SOCKET) 
+      {
+        _context->attach(this);
+        _context->armRecv(this);
+      }
+    }
+    
+    IoUringTcpClient::IoUringTcpClient() : IoUringTcpClient(nullptr, INVALID_SOCKET) {}
+    
+    bool IoUringTcpClient::connect(const WSString& host, int port) 
+    {
+      if (!LinuxTcpClient::connect(host, port)) 
+        return false;
+    
+      if (!_context && IoUringContext::isSupported()) 
+      {
+        // A standalone client gets its own (small) ring
+        _context = std::make_shared<IoUringContext>(64);
+      }
+    
+      if (_context && _context->available()) 
+      {
+        _context->attach(this);
+        _context->armRecv(this);
+        _context->submit();
+      }
+      else 
+      {
+        _context = nullptr;
+      }
+    
+      return true;
+    }
+    
+    bool IoUringTcpClient::poll() 
+    {
+      if (!_context) 
+        return LinuxTcpClient::poll();
+    
+      if (!available()) 
+        return false;
+    
+      _context->reap(false);
+      
+      return !_received.empty() || _eof;
+    }
+    
+    void IoUringTcpClient::send(const WSString& data) 
+    {
+      this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+    
+    void IoUringTcpClient::send(const WSString&& data) 
+    {
+      this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+    
+    void IoUringTcpClient::send(const uint8_t* data, const uint32_t len) 
+    {
+      if (!_context) 
+      {
+        LinuxTcpClient::send(data, len);
+        return;
+      }
+    
+      if (!available() || _eof) 
+        return;
+        
+      // Sends never wait here anyway, but an event loop's queue limit still holds for the outbox
+      if (_sendQueueLimit > 0 && _outbox.size() + len > _sendQueueLimit) 
+      {
+        LOGWARN1("IoUringTcpClient::send: the peer stopped reading, queued bytes =", _outbox.size() + len);
+        close();
+        return;
+      }
+    
+      // Queued only, the owner of the ring submits every connection's sends in one go
+      _outbox.append(reinterpret_cast<const char*>(data), len);
+      _context->armSend(this);
+    }
+    
+    uint32_t IoUringTcpClient::pendingSend() const 
+    {
+      if (!_context) 
+        return LinuxTcpClient::pendingSend();
+        
+      return static_cast<uint32_t>(_outbox.size());
+    }
+    
+    WSString IoUringTcpClient::readLine() 
+    {
+      if (!_context) 
+        return LinuxTcpClient::readLine();
+        
+      // Scan the received buffers in place, whatever follows the line stays queued for read()
+      WSString line = "";
+      bool complete = false;
+      
+      while (!complete) 
+      {
+        while (_received.empty() && !_eof && available()) 
+        {
+          _context->reap(true);
+        }
+        
+        if (_received.empty()) 
+        {
+          close();
+          break;
+        }
+          
+        Chunk& chunk = _received.front();
+        
+        chunk.offset += BufferedLineReader::scanLine(_context->buffer(chunk.bid) + chunk.offset, chunk.len - chunk.offset, line, complete);
+        
+        if (chunk.offset == chunk.len) 
+        {
+          _context->recycle(chunk.bid);
+          _received.pop_front();
+        }
+      }
+      
+      return line;
+    }
+    
+    uint16_t IoUringTcpClient::setOptions(const TransportOptions& options) 
+    {
+      uint16_t ignored = LinuxTcpClient::setOptions(options);
+      
+      // reads wait on ring completions, SO_RCVTIMEO never comes into play
+      if (_context && options.has(TransportOptions::Option_ReadTimeout)) 
+        ignored |= TransportOptions::Option_ReadTimeout;
+        
+      return ignored;
+    }
+    
+    uint32_t IoUringTcpClient::read(uint8_t* buffer, const uint32_t len) 
+    {
+      if (!_context) 
+        return LinuxTcpClient::read(buffer, len);
+    
+      // Blocking semantics like the plain socket: wait for completions of this connection
+      while (_received.empty() && !_eof && available()) 
+      {
+        _context->reap(true);
+      }
+    
+      if (_received.empty()) 
+      {
+        close();
+        return 0;
+      }
+    
+      uint32_t done = 0;
+    
+      while (done < len && !_received.empty()) 
+      {
+        Chunk& chunk = _received.front();
+        uint32_t count = chunk.len - chunk.offset;
+        
+        if (count > len - done) 
+          count = len - done;
+    
+        memcpy(buffer + done, _context->buffer(chunk.bid) + chunk.offset, count);
+        
+        chunk.offset += count;
+        done += count;
+    
+        if (chunk.offset == chunk.len) 
+        {
+          _context->recycle(chunk.bid);
+          _received.pop_front();
+        }
+      }
+    
+      return done;
+    }
+    
+    void IoUringTcpClient::close() 
+    {
+      if (_context && _socket != INVALID_SOCKET) 
+      {
+        // Flush what is queued, then shutdown() completes the pending multishot recv (close() alone would not)
+        _context->submit();
+        ::shutdown(_socket, SHUT_RDWR);
+        _context->detach(this);
+      }
+    
+      LinuxTcpClient::close();
+    }
+    
+    IoUringTcpClient::~IoUringTcpClient() 
+    {
+      close();
+    }
+    
+    ///////////////////////////////////////////////////////////////////
+    
+    bool IoUringTcpServer::listen(const uint16_t port) 
+    {
+      if (!LinuxTcpServer::listen(port)) 
+        return false;
+    
+      if (IoUringContext::isSupported()) 
+      {
+        _context = std::make_shared<IoUringContext>();
+    
+        if (_context->available()) 
+        {
+          _context->armAccept(_socket);
+          _context->submit();
+        }
+        else 
+        {
+          _context = nullptr;
+        }
+      }
+    
+      if (!_context) 
+      {
+        LOGWARN("IoUringTcpServer::listen: io_uring unavailable, using plain sockets");
+      }
+    
+      return true;
+    }
+    
+    bool IoUringTcpServer::poll() 
+    {
+      if (!_context) 
+        return LinuxTcpServer::poll();
+    
+      _context->reap(false);
+      
+      return !_context->_accepted.empty();
+    }
+    
+    TcpClient* IoUringTcpServer::accept() 
+    {
+      if (!_context) 
+        return LinuxTcpServer::accept();
+    
+      int fd = _context->popAccepted();
+    
+      while (fd < 0 && available()) 
+      {
+        _context->reap(true);
+        fd = _context->popAccepted();
+      }
+    
+      return new IoUringTcpClient(_context, fd);
+    }
+    
+    int IoUringTcpServer::nextReadySocket() 
+    {
+      if (!_context) 
+        return -1;
+    
+      _context->reap(false);
+      
+      return _context->popReady();
+    }
+    
+    void IoUringTcpServer::flush() 
+    {
+      if (_context) 
+        _context->submit();
+    }
+    
+    void IoUringTcpServer::close() 
+    {
+      if (_context && _socket != INVALID_SOCKET) 
+      {
+        // terminates the multishot accept
+        _context->_listenFd = -1;
+        ::shutdown(_socket, SHUT_RDWR);
+      }
+    
+      LinuxTcpServer::close();
+    }
+    
+    IoUringTcpServer::~IoUringTcpServer() 
+    {
+      close();
+    }
+  }   // namespace network2_generic
+}     // namespace websockets2_generic
+
+#endif // #ifdef __linux__ 
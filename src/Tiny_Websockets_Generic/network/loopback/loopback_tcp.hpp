@@ -0,0 +1,487 @@
+/****************************************************************************************************************************
+  loopback_tcp.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+#include <Tiny_Websockets_Generic/network/tcp_client.hpp>
+#include <Tiny_Websockets_Generic/network/tcp_server.hpp>
+#include <Tiny_Websockets_Generic/network/line_reader.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef WS_LOOPBACK_PIPE_SIZE
+  #define WS_LOOPBACK_PIPE_SIZE     65536
+#endif
+
+// In-process transport: a LoopbackTcpClient connects to the LoopbackTcpServer listening on the same
+// port of this process, bytes travel through ring buffers. Both ends block like sockets do, so client
+// and server run on different threads.
+//
+// Include explicitly, it is not part of WebSockets2_Generic.h:
+//   #include <Tiny_Websockets_Generic/network/loopback/loopback_tcp.hpp>
+
+namespace websockets2_generic
+{
+  namespace network2_generic
+  {
+    // Partial I/O injection. 0 keeps the full size, otherwise every read returns and every write is split
+    // into at most that many bytes. With a non-zero seed the sizes are drawn from 1..max instead,
+    // reproducibly for a given seed. With nonBlocking, read() on an empty pipe returns (uint32_t) -1 like
+    // a non-blocking socket instead of waiting, so a frame the peer writes in parts spans several polls
+    // (readLine() still waits).
+    struct LoopbackFaults 
+    {
+      LoopbackFaults(const uint32_t maxRead = 0, const uint32_t maxWrite = 0, const uint32_t randomSeed = 0, 
+                     const bool nonBlockingReads = false) : 
+        maxReadSize(maxRead), maxWriteSize(maxWrite), seed(randomSeed), nonBlocking(nonBlockingReads) {}
+        
+      uint32_t maxReadSize;
+      uint32_t maxWriteSize;
+      uint32_t seed;
+      bool nonBlocking;
+    };
+    
+    // One direction of a connection
+    class LoopbackPipe 
+    {
+      public:
+        LoopbackPipe(const size_t capacity = WS_LOOPBACK_PIPE_SIZE) : 
+          _ring(capacity), _head(0), _count(0), _closed(false) {}
+        
+        // Blocks while the ring is full. Returns what was written, less than len once the pipe is closed.
+        uint32_t write(const uint8_t* data, const uint32_t len) 
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          uint32_t done = 0;
+          
+          while (done < len) 
+          {
+            _cond.wait(lock, [this]() { return _closed || _count < _ring.size(); });
+            
+            if (_closed) 
+              break;
+              
+            while (done < len && _count < _ring.size()) 
+            {
+              _ring[(_head + _count) % _ring.size()] = data[done++];
+              _count++;
+            }
+            
+            _cond.notify_all();
+          }
+          
+          return done;
+        }
+        
+        // Blocks until data arrives. Returns 0 once the pipe is closed and drained.
+        uint32_t read(uint8_t* buffer, const uint32_t len) 
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          
+          _cond.wait(lock, [this]() { return _closed || _count > 0; });
+          
+          uint32_t done = 0;
+          
+          while (done < len && _count > 0) 
+          {
+            buffer[done++] = _ring[_head];
+            _head = (_head + 1) % _ring.size();
+            _count--;
+          }
+          
+          _cond.notify_all();
+          
+          return done;
+        }
+        
+        size_t size() 
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          return _count;
+        }
+        
+        bool closed() 
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          return _closed;
+        }
+        
+        void close() 
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _closed = true;
+          _cond.notify_all();
+        }
+    
+      private:
+        std::vector<uint8_t> _ring;
+        size_t _head;
+        size_t _count;
+        bool _closed;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+    };
+    
+    class LoopbackTcpServer;
+    
+    class LoopbackTcpClient : public TcpClient 
+    {
+      public:
+        LoopbackTcpClient(const LoopbackFaults& faults = LoopbackFaults());
+        LoopbackTcpClient(std::shared_ptr<LoopbackPipe> in, std::shared_ptr<LoopbackPipe> out, const LoopbackFaults& faults);
+        
+        bool connect(const WSString& host, int port) override;
+        bool poll() override;
+        bool available() override;
+        void send(const WSString& data) override;
+        void send(const WSString&& data) override;
+        void send(const uint8_t* data, const uint32_t len) override;
+        WSString readLine() override;
+        uint32_t read(uint8_t* buffer, const uint32_t len) override;
+        void close() override;
+        virtual ~LoopbackTcpClient();
+        
+        void setFaults(const LoopbackFaults& faults) 
+        {
+          _faults = faults;
+          _random = faults.seed;
+        }
+        
+        int getSocket() const override 
+        {
+          return -1;
+        }
+    
+      private:
+        std::shared_ptr<LoopbackPipe> _in;
+        std::shared_ptr<LoopbackPipe> _out;
+        LoopbackFaults _faults;
+        uint32_t _random;
+        BufferedLineReader _lineReader;
+        
+        uint32_t limit(const uint32_t len, const uint32_t maxSize);
+        uint32_t readPipe(uint8_t* buffer, const uint32_t len);
+    };
+    
+    class LoopbackTcpServer : public TcpServer 
+    {
+      public:
+        LoopbackTcpServer(const LoopbackFaults& faults = LoopbackFaults()) : 
+          _port(0), _listening(false), _faults(faults) {}
+        
+        bool poll() override;
+        bool listen(const uint16_t port) override;
+        TcpClient* accept() override;
+        bool available() override;
+        void close() override;
+        virtual ~LoopbackTcpServer();
+        
+        // Faults of the server side of connections accepted from now on
+        void setFaults(const LoopbackFaults& faults) 
+        {
+          _faults = faults;
+        }
+        
+        int getSocket() const override 
+        {
+          return -1;
+        }
+        
+        // Called by LoopbackTcpClient::connect(), false when nobody listens on port
+        static bool connectTo(const uint16_t port, std::shared_ptr<LoopbackPipe> toServer, std::shared_ptr<LoopbackPipe> toClient);
+    
+      private:
+        uint16_t _port;
+        bool _listening;
+        LoopbackFaults _faults;
+        std::deque<std::pair<std::shared_ptr<LoopbackPipe>, std::shared_ptr<LoopbackPipe>>> _pending;
+        std::condition_variable _cond;
+        
+        // listening servers by port, one lock for the registry and every pending queue
+        static std::mutex& registryMutex() 
+        {
+          static std::mutex mutex;
+          return mutex;
+        }
+        
+        static std::map<uint16_t, LoopbackTcpServer*>& registry() 
+        {
+          static std::map<uint16_t, LoopbackTcpServer*> servers;
+          return servers;
+        }
+    };
+    
+    ///////////////////////////////////////////////////////////////////
+    
+    LoopbackTcpClient::LoopbackTcpClient(const LoopbackFaults& faults) : 
+      _faults(faults), _random(faults.seed) {}
+    
+    LoopbackTcpClient::LoopbackTcpClient(std::shared_ptr<LoopbackPipe> in, std::shared_ptr<LoopbackPipe> out, const LoopbackFaults& faults) : 
+      _in(in), _out(out), _faults(faults), _random(faults.seed) {}
+    
+    bool LoopbackTcpClient::connect(const WSString& host, int port) 
+    {
+      // host is irrelevant, every loopback server lives in this process
+      (void) host;
+      
+      close();
+      
+      std::shared_ptr<LoopbackPipe> toServer(new LoopbackPipe());
+      std::shared_ptr<LoopbackPipe> toClient(new LoopbackPipe());
+      
+      if (!LoopbackTcpServer::connectTo(static_cast<uint16_t>(port), toServer, toClient)) 
+        return false;
+        
+      _in   = toClient;
+      _out  = toServer;
+      
+      return true;
+    }
+    
+    bool LoopbackTcpClient::poll() 
+    {
+      if (!available()) 
+        return false;
+        
+      // a closed pipe is readable too: the next read reports the end of the stream
+      return _lineReader.buffered() > 0 || _in->size() > 0 || _in->closed();
+    }
+    
+    bool LoopbackTcpClient::available() 
+    {
+      return _in && _out;
+    }
+    
+    void LoopbackTcpClient::send(const WSString& data) 
+    {
+      this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+    
+    void LoopbackTcpClient::send(const WSString&& data) 
+    {
+      this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+    
+    void LoopbackTcpClient::send(const uint8_t* data, const uint32_t len) 
+    {
+      uint32_t sent = 0;
+      
+      while (sent < len && available()) 
+      {
+        const uint32_t chunk = limit(len - sent, _faults.maxWriteSize);
+        
+        if (_out->write(data + sent, chunk) < chunk) 
+        {
+          // the peer closed the connection
+          close();
+          return;
+        }
+        
+        sent += chunk;
+      }
+    }
+    
+    WSString LoopbackTcpClient::readLine() 
+    {
+      return _lineReader.readLine(
+        [this](uint8_t* buffer, const uint32_t len) 
+        {
+          return static_cast<int32_t>(readPipe(buffer, len));
+        },
+        [this]() 
+        {
+          return available();
+        });
+    }
+    
+    uint32_t LoopbackTcpClient::read(uint8_t* buffer, const uint32_t len) 
+    {
+      if (_lineReader.buffered() > 0) 
+        return _lineReader.drain(buffer, limit(len, _faults.maxReadSize));
+        
+      if (_faults.nonBlocking && available() && _in->size() == 0 && !_in->closed()) 
+        return static_cast<uint32_t>(-1);
+        
+      return readPipe(buffer, len);
+    }
+    
+    uint32_t LoopbackTcpClient::readPipe(uint8_t* buffer, const uint32_t len) 
+    {
+      if (!available()) 
+        return 0;
+        
+      uint32_t res = _in->read(buffer, limit(len, _faults.maxReadSize));
+      
+      if (res == 0) 
+      {
+        // Orderly shutdown by the peer
+        close();
+      }
+      
+      return res;
+    }
+    
+    uint32_t LoopbackTcpClient::limit(const uint32_t len, const uint32_t maxSize) 
+    {
+      if (maxSize == 0 || len == 0) 
+        return len;
+        
+      uint32_t size = maxSize;
+      
+      if (_faults.seed != 0) 
+      {
+        // xorshift32, same sequence for the same seed
+        _random ^= _random << 13;
+        _random ^= _random >> 17;
+        _random ^= _random << 5;
+        size = 1 + (_random % maxSize);
+      }
+      
+      return size < len ? size : len;
+    }
+    
+    void LoopbackTcpClient::close() 
+    {
+      if (_in) 
+        _in->close();
+        
+      if (_out) 
+        _out->close();
+        
+      _in.reset();
+      _out.reset();
+      _lineReader.clear();
+    }
+    
+    LoopbackTcpClient::~LoopbackTcpClient() 
+    {
+      close();
+    }
+    
+    ///////////////////////////////////////////////////////////////////
+    
+    bool LoopbackTcpServer::connectTo(const uint16_t port, std::shared_ptr<LoopbackPipe> toServer, std::shared_ptr<LoopbackPipe> toClient) 
+    {
+      std::lock_guard<std::mutex> lock(registryMutex());
+      
+      auto it = registry().find(port);
+      
+      if (it == registry().end()) 
+        return false;
+        
+      it->second->_pending.push_back(std::make_pair(toServer, toClient));
+      it->second->_cond.notify_all();
+      
+      return true;
+    }
+    
+    bool LoopbackTcpServer::poll() 
+    {
+      std::lock_guard<std::mutex> lock(registryMutex());
+      
+      return !_pending.empty();
+    }
+    
+    bool LoopbackTcpServer::listen(const uint16_t port) 
+    {
+      close();
+      
+      std::lock_guard<std::mutex> lock(registryMutex());
+      
+      if (registry().count(port)) 
+      {
+        LOGERROR1("LoopbackTcpServer::listen: port already in use", port);
+        return false;
+      }
+      
+      registry()[port] = this;
+      _port = port;
+      _listening = true;
+      
+      return true;
+    }
+    
+    TcpClient* LoopbackTcpServer::accept() 
+    {
+      std::unique_lock<std::mutex> lock(registryMutex());
+      
+      // Blocks like accept() on a socket
+      _cond.wait(lock, [this]() { return !_listening || !_pending.empty(); });
+      
+      if (_pending.empty()) 
+        return nullptr;
+        
+      auto pipes = _pending.front();
+      _pending.pop_front();
+      
+      return new LoopbackTcpClient(pipes.first, pipes.second, _faults);
+    }
+    
+    bool LoopbackTcpServer::available() 
+    {
+      std::lock_guard<std::mutex> lock(registryMutex());
+      
+      return _listening;
+    }
+    
+    void LoopbackTcpServer::close() 
+    {
+      std::lock_guard<std::mutex> lock(registryMutex());
+      
+      if (!_listening) 
+        return;
+        
+      registry().erase(_port);
+      _listening = false;
+      
+      // refuse connections that were never accepted
+      for (auto& pipes : _pending) 
+      {
+        pipes.first->close();
+        pipes.second->close();
+      }
+      
+      _pending.clear();
+      _cond.notify_all();
+    }
+    
+    LoopbackTcpServer::~LoopbackTcpServer() 
+    {
+      close();
+    }
+  }   // namespace network2_generic
+}     // namespace websockets2_generic
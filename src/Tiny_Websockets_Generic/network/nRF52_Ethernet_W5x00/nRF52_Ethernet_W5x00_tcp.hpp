@@ -63,7 +63,12 @@ namespace websockets2_generic
 {
   namespace network2_generic
   {
+#if ( (USE_ETHERNET2_LIB || USE_ETHERNET2) && !(USE_ETHERNET_LIB || USE_ETHERNET) )
+    // Ethernet2 has no setConnectionTimeout()
     typedef GenericEspTcpClient<EthernetClient> EthernetTcpClient;
+#else
+    typedef GenericEthernetTcpClient<EthernetClient> EthernetTcpClient;
+#endif
 
 #if 0
     // KH, no SSL support for Ethernet
@@ -0,0 +1,580 @@
+/****************************************************************************************************************************
+  simulated_tcp.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+ 
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_common.hpp>
+#include <Tiny_Websockets_Generic/network/tcp_client.hpp>
+#include <Tiny_Websockets_Generic/network/tcp_server.hpp>
+#include <Tiny_Websockets_Generic/network/line_reader.hpp>
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <thread>
+
+#ifndef WS_SIMULATOR_READ_SIZE
+  #define WS_SIMULATOR_READ_SIZE      1024
+#endif
+
+// Network condition simulator: SimulatedTcpClient wraps any TcpClient and delays what goes through it
+// according to NetworkConditions (latency, jitter, bandwidth, segment splitting, stalls).
+// Time comes from a NetworkClock. With a VirtualClock a blocked read jumps straight to the next
+// scheduled delivery, so a run costs no wall time and is reproducible for a given seed.
+//
+// Include explicitly, it is not part of WebSockets2_Generic.h:
+//   #include <Tiny_Websockets_Generic/network/simulator/simulated_tcp.hpp>
+
+namespace websockets2_generic
+{
+  namespace network2_generic
+  {
+    struct NetworkConditions 
+    {
+      NetworkConditions() : 
+        latencyMs(0), jitterMs(0), bytesPerSecond(0), maxSegmentSize(0), 
+        stallPerMille(0), stallMs(0), seed(1) {}
+      
+      // one way delay, plus a random 0..jitterMs on top (ordering is kept, like TCP)
+      uint32_t latencyMs;
+      uint32_t jitterMs;
+      
+      // serialisation rate of the link, 0 for unlimited
+      uint32_t bytesPerSecond;
+      
+      // writes are split at random offsets into segments of 1..maxSegmentSize bytes, 0 keeps them whole
+      uint32_t maxSegmentSize;
+      
+      // chance per segment (in 1/1000) that the link freezes for stallMs
+      uint32_t stallPerMille;
+      uint32_t stallMs;
+      
+      uint32_t seed;
+      
+      // GPRS/EDGE class link
+      static NetworkConditions link2G() 
+      {
+        NetworkConditions conditions;
+        conditions.latencyMs      = 300;
+        conditions.jitterMs       = 150;
+        conditions.bytesPerSecond = 12000;
+        conditions.maxSegmentSize = 536;
+        conditions.stallPerMille  = 10;
+        conditions.stallMs        = 2000;
+        return conditions;
+      }
+      
+      // busy access point: moderate bandwidth, bursty delays and the odd retransmission stall
+      static NetworkConditions congestedWifi() 
+      {
+        NetworkConditions conditions;
+        conditions.latencyMs      = 40;
+        conditions.jitterMs       = 80;
+        conditions.bytesPerSecond = 250000;
+        conditions.maxSegmentSize = 1460;
+        conditions.stallPerMille  = 20;
+        conditions.stallMs        = 300;
+        return conditions;
+      }
+    };
+    
+    class NetworkClock 
+    {
+      public:
+        virtual uint64_t nowUs() = 0;
+        
+        // Called when nothing can happen before timeUs
+        virtual void waitUntil(const uint64_t timeUs) = 0;
+        
+        virtual ~NetworkClock() {}
+    };
+    
+    class SystemClock : public NetworkClock 
+    {
+      public:
+        SystemClock() : _start(std::chrono::steady_clock::now()) {}
+        
+        uint64_t nowUs() override 
+        {
+          return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start).count();
+        }
+        
+        void waitUntil(const uint64_t timeUs) override 
+        {
+          std::this_thread::sleep_until(_start + std::chrono::microseconds(timeUs));
+        }
+    
+      private:
+        std::chrono::steady_clock::time_point _start;
+    };
+    
+    // Only moves when told to: by advance(), or by a simulated read that waits for the next delivery
+    class VirtualClock : public NetworkClock 
+    {
+      public:
+        VirtualClock() : _now(0) {}
+        
+        uint64_t nowUs() override 
+        {
+          return _now;
+        }
+        
+        void waitUntil(const uint64_t timeUs) override 
+        {
+          if (timeUs > _now) 
+            _now = timeUs;
+        }
+        
+        void advance(const uint64_t us) 
+        {
+          _now += us;
+        }
+    
+      private:
+        uint64_t _now;
+    };
+    
+    // One direction of a simulated connection: bytes become segments with a delivery time
+    class SimulatedLink 
+    {
+      public:
+        SimulatedLink(const NetworkConditions& conditions, const uint32_t seed) : 
+          _conditions(conditions), _random(seed ? seed : 1), _freeAtUs(0), _lastDueUs(0), _queuedBytes(0) {}
+        
+        void push(const uint8_t* data, const uint32_t len, const uint64_t nowUs);
+        
+        // Delivery time of the next segment, UINT64_MAX when nothing is in flight
+        uint64_t nextDueUs() const 
+        {
+          return _segments.empty() ? UINT64_MAX : _segments.front().dueUs;
+        }
+        
+        bool ready(const uint64_t nowUs) const 
+        {
+          return !_segments.empty() && _segments.front().dueUs <= nowUs;
+        }
+        
+        // Copies from the front segment only, so reads come out split like the segments
+        uint32_t pop(uint8_t* buffer, const uint32_t len);
+        
+        const WSString& front() const 
+        {
+          return _segments.front().data;
+        }
+        
+        void dropFront() 
+        {
+          _queuedBytes -= _segments.front().data.size() - _segments.front().offset;
+          _segments.pop_front();
+        }
+        
+        size_t queuedBytes() const 
+        {
+          return _queuedBytes;
+        }
+        
+        void clear() 
+        {
+          _segments.clear();
+          _queuedBytes = 0;
+        }
+    
+      private:
+        struct Segment 
+        {
+          uint64_t dueUs;
+          WSString data;
+          size_t offset;
+        };
+        
+        NetworkConditions _conditions;
+        uint32_t _random;
+        uint64_t _freeAtUs;
+        uint64_t _lastDueUs;
+        size_t _queuedBytes;
+        std::deque<Segment> _segments;
+        
+        // xorshift32, same sequence for the same seed
+        uint32_t random(const uint32_t range) 
+        {
+          _random ^= _random << 13;
+          _random ^= _random >> 17;
+          _random ^= _random << 5;
+          
+          return range ? _random % range : 0;
+        }
+    };
+    
+    class SimulatedTcpClient : public TcpClient 
+    {
+      public:
+        SimulatedTcpClient(std::shared_ptr<TcpClient> inner, const NetworkConditions& conditions, 
+                           std::shared_ptr<NetworkClock> clock = std::make_shared<SystemClock>());
+        
+        bool connect(const WSString& host, int port) override;
+        bool poll() override;
+        bool available() override;
+        void send(const WSString& data) override;
+        void send(const WSString&& data) override;
+        void send(const uint8_t* data, const uint32_t len) override;
+        WSString readLine() override;
+        uint32_t read(uint8_t* buffer, const uint32_t len) override;
+        uint16_t setOptions(const TransportOptions& options) override;
+        void close() override;
+        virtual ~SimulatedTcpClient();
+        
+        int getSocket() const override 
+        {
+          return _inner->getSocket();
+        }
+        
+        // Bytes sent by the application that the simulated link has not delivered yet (backpressure)
+        size_t queuedOutbound() const 
+        {
+          return _outbound.queuedBytes();
+        }
+        
+        size_t queuedInbound() const 
+        {
+          return _inbound.queuedBytes();
+        }
+    
+      private:
+        std::shared_ptr<TcpClient> _inner;
+        std::shared_ptr<NetworkClock> _clock;
+        NetworkConditions _conditions;
+        SimulatedLink _outbound;
+        SimulatedLink _inbound;
+        BufferedLineReader _lineReader;
+        
+        // Forwards due outbound segments and takes in whatever the real transport has
+        void pump();
+        uint32_t readSimulated(uint8_t* buffer, const uint32_t len);
+    };
+    
+    // Wraps every accepted connection of a server into a SimulatedTcpClient
+    class SimulatedTcpServer : public TcpServer 
+    {
+      public:
+        SimulatedTcpServer(TcpServer* inner, const NetworkConditions& conditions, 
+                           std::shared_ptr<NetworkClock> clock = std::make_shared<SystemClock>()) : 
+          _inner(inner), _clock(clock), _conditions(conditions) {}
+        
+        bool poll() override 
+        {
+          return _inner->poll();
+        }
+        
+        bool listen(const uint16_t port) override 
+        {
+          return _inner->listen(port);
+        }
+        
+        TcpClient* accept() override;
+        
+        bool available() override 
+        {
+          return _inner->available();
+        }
+        
+        void close() override 
+        {
+          _inner->close();
+        }
+        
+        int getSocket() const override 
+        {
+          return _inner->getSocket();
+        }
+        
+        int nextReadySocket() override 
+        {
+          return _inner->nextReadySocket();
+        }
+        
+        void flush() override 
+        {
+          _inner->flush();
+        }
+        
+        virtual ~SimulatedTcpServer() 
+        {
+          delete _inner;
+        }
+    
+      private:
+        TcpServer* _inner;
+        std::shared_ptr<NetworkClock> _clock;
+        NetworkConditions _conditions;
+    };
+    
+    ///////////////////////////////////////////////////////////////////
+    
+    void SimulatedLink::push(const uint8_t* data, const uint32_t len, const uint64_t nowUs) 
+    {
+      uint32_t offset = 0;
+      
+      while (offset < len) 
+      {
+        uint32_t size = len - offset;
+        
+        if (_conditions.maxSegmentSize > 0) 
+        {
+          const uint32_t segment = 1 + random(_conditions.maxSegmentSize);
+          
+          if (segment < size) 
+            size = segment;
+        }
+        
+        // the link serialises one segment after the other
+        uint64_t start = nowUs > _freeAtUs ? nowUs : _freeAtUs;
+        
+        if (_conditions.bytesPerSecond > 0) 
+          start += static_cast<uint64_t>(size) * 1000000 / _conditions.bytesPerSecond;
+          
+        if (_conditions.stallPerMille > 0 && random(1000) < _conditions.stallPerMille) 
+          start += static_cast<uint64_t>(_conditions.stallMs) * 1000;
+          
+        _freeAtUs = start;
+        
+        uint64_t due = start + static_cast<uint64_t>(_conditions.latencyMs) * 1000 + static_cast<uint64_t>(random(_conditions.jitterMs + 1)) * 1000;
+        
+        // a stream never overtakes itself
+        if (due < _lastDueUs) 
+          due = _lastDueUs;
+          
+        _lastDueUs = due;
+        
+        Segment segment;
+        segment.dueUs   = due;
+        segment.data    = WSString(reinterpret_cast<const char*>(data + offset), size);
+        segment.offset  = 0;
+        _segments.push_back(segment);
+        
+        _queuedBytes += size;
+        offset += size;
+      }
+    }
+    
+    uint32_t SimulatedLink::pop(uint8_t* buffer, const uint32_t len) 
+    {
+      Segment& segment = _segments.front();
+      size_t count = segment.data.size() - segment.offset;
+      
+      if (count > len) 
+        count = len;
+        
+      memcpy(buffer, segment.data.data() + segment.offset, count);
+      segment.offset += count;
+      _queuedBytes -= count;
+      
+      if (segment.offset == segment.data.size()) 
+        _segments.pop_front();
+      
+      return static_cast<uint32_t>(count);
+    }
+    
+    ///////////////////////////////////////////////////////////////////
+    
+    SimulatedTcpClient::SimulatedTcpClient(std::shared_ptr<TcpClient> inner, const NetworkConditions& conditions, 
+                                           std::shared_ptr<NetworkClock> clock) : 
+      _inner(inner), _clock(clock), _conditions(conditions), 
+      _outbound(conditions, conditions.seed), _inbound(conditions, conditions.seed * 2654435761u) {}
+    
+    bool SimulatedTcpClient::connect(const WSString& host, int port) 
+    {
+      _outbound.clear();
+      _inbound.clear();
+      _lineReader.clear();
+      
+      if (!_inner->connect(host, port)) 
+        return false;
+        
+      // SYN / SYN-ACK: one round trip before the first byte can go out
+      _clock->waitUntil(_clock->nowUs() + static_cast<uint64_t>(_conditions.latencyMs) * 2000);
+      
+      return true;
+    }
+    
+    void SimulatedTcpClient::pump() 
+    {
+      const uint64_t now = _clock->nowUs();
+      
+      while (_outbound.ready(now) && _inner->available()) 
+      {
+        _inner->send(_outbound.front());
+        _outbound.dropFront();
+      }
+      
+      uint8_t buffer[WS_SIMULATOR_READ_SIZE];
+      
+      while (_inner->available() && _inner->poll()) 
+      {
+        uint32_t count = _inner->read(buffer, sizeof(buffer));
+        
+        if (count == 0 || count == static_cast<uint32_t>(-1)) 
+          break;
+          
+        _inbound.push(buffer, count, now);
+      }
+    }
+    
+    bool SimulatedTcpClient::poll() 
+    {
+      if (!available()) 
+        return false;
+        
+      pump();
+      
+      return _lineReader.buffered() > 0 || _inbound.ready(_clock->nowUs()) || !_inner->available();
+    }
+    
+    bool SimulatedTcpClient::available() 
+    {
+      // what is already in flight can still be read after the peer closed
+      return _inner && (_inner->available() || _inbound.queuedBytes() > 0 || _lineReader.buffered() > 0);
+    }
+    
+    void SimulatedTcpClient::send(const WSString& data) 
+    {
+      this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+    
+    void SimulatedTcpClient::send(const WSString&& data) 
+    {
+      this->send(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+    }
+    
+    void SimulatedTcpClient::send(const uint8_t* data, const uint32_t len) 
+    {
+      if (!_inner->available()) 
+        return;
+        
+      _outbound.push(data, len, _clock->nowUs());
+      pump();
+    }
+    
+    WSString SimulatedTcpClient::readLine() 
+    {
+      return _lineReader.readLine(
+        [this](uint8_t* buffer, const uint32_t len) 
+        {
+          return static_cast<int32_t>(readSimulated(buffer, len));
+        },
+        [this]() 
+        {
+          return available();
+        });
+    }
+    
+    uint32_t SimulatedTcpClient::read(uint8_t* buffer, const uint32_t len) 
+    {
+      if (_lineReader.buffered() > 0) 
+        return _lineReader.drain(buffer, len);
+        
+      return readSimulated(buffer, len);
+    }
+    
+    uint32_t SimulatedTcpClient::readSimulated(uint8_t* buffer, const uint32_t len) 
+    {
+      uint8_t incoming[WS_SIMULATOR_READ_SIZE];
+      
+      while (available()) 
+      {
+        pump();
+        
+        if (_inbound.ready(_clock->nowUs())) 
+          return _inbound.pop(buffer, len);
+          
+        // Nothing deliverable yet: move on to the next scheduled event, our own sends included,
+        // the peer may be waiting for them
+        const uint64_t inboundDue   = _inbound.nextDueUs();
+        const uint64_t outboundDue  = _outbound.nextDueUs();
+        const uint64_t next         = inboundDue < outboundDue ? inboundDue : outboundDue;
+        
+        if (next != UINT64_MAX) 
+        {
+          _clock->waitUntil(next);
+          continue;
+        }
+        
+        if (!_inner->available()) 
+          break;
+        
+        // Nothing in flight: block on the real transport like a socket read would
+        uint32_t count = _inner->read(incoming, sizeof(incoming));
+        
+        if (count == static_cast<uint32_t>(-1)) 
+          continue;
+          
+        if (count == 0) 
+          break;
+          
+        _inbound.push(incoming, count, _clock->nowUs());
+      }
+      
+      return 0;
+    }
+    
+    uint16_t SimulatedTcpClient::setOptions(const TransportOptions& options) 
+    {
+      return _inner->setOptions(options);
+    }
+    
+    void SimulatedTcpClient::close() 
+    {
+      // whatever the link still holds is lost, like unacknowledged data on a reset
+      _outbound.clear();
+      _inbound.clear();
+      _lineReader.clear();
+      _inner->close();
+    }
+    
+    SimulatedTcpClient::~SimulatedTcpClient() 
+    {
+      close();
+    }
+    
+    TcpClient* SimulatedTcpServer::accept() 
+    {
+      TcpClient* client = _inner->accept();
+      
+      if (!client) 
+        return nullptr;
+        
+      // a different random sequence per connection
+      NetworkConditions conditions = _conditions;
+      conditions.seed = _conditions.seed++;
+      
+      return new SimulatedTcpClient(std::shared_ptr<TcpClient>(client), conditions, _clock);
+    }
+  }   // namespace network2_generic
+}     // namespace websockets2_generic
@@ -38,6 +38,99 @@ namespace websockets2_generic
 {
   namespace network2_generic 
   {
+    // Socket tuning requested by the application. Only the options that were set are applied,
+    // everything else keeps the stack default.
+    struct TransportOptions 
+    {
+      enum Option 
+      {
+        Option_NoDelay        = 1 << 0,
+        Option_SendBuffer     = 1 << 1,
+        Option_ReceiveBuffer  = 1 << 2,
+        Option_KeepAlive      = 1 << 3,
+        Option_ConnectTimeout = 1 << 4,
+        Option_ReadTimeout    = 1 << 5,
+        Option_SendTimeout    = 1 << 6
+      };
+      
+      TransportOptions() : 
+        options(0), noDelay(false), sendBufferSize(0), receiveBufferSize(0), 
+        keepAliveIdle(0), keepAliveInterval(0), keepAliveCount(0), 
+        connectTimeoutMs(0), readTimeoutMs(0), sendTimeoutMs(0) {}
+      
+      TransportOptions& setNoDelay(const bool enable) 
+      {
+        noDelay = enable;
+        options |= Option_NoDelay;
+        return *this;
+      }
+      
+      TransportOptions& setSendBufferSize(const uint32_t size) 
+      {
+        sendBufferSize = size;
+        options |= Option_SendBuffer;
+        return *this;
+      }
+      
+      TransportOptions& setReceiveBufferSize(const uint32_t size) 
+      {
+        receiveBufferSize = size;
+        options |= Option_ReceiveBuffer;
+        return *this;
+      }
+      
+      // idleSec == 0 disables keepalive, interval and count of 0 keep the stack defaults
+      TransportOptions& setKeepAlive(const uint32_t idleSec, const uint32_t intervalSec = 0, const uint32_t count = 0) 
+      {
+        keepAliveIdle     = idleSec;
+        keepAliveInterval = intervalSec;
+        keepAliveCount    = count;
+        options |= Option_KeepAlive;
+        return *this;
+      }
+      
+      TransportOptions& setConnectTimeout(const uint32_t timeoutMs) 
+      {
+        connectTimeoutMs = timeoutMs;
+        options |= Option_ConnectTimeout;
+        return *this;
+      }
+      
+      // 0 waits forever
+      TransportOptions& setReadTimeout(const uint32_t timeoutMs) 
+      {
+        readTimeoutMs = timeoutMs;
+        options |= Option_ReadTimeout;
+        return *this;
+      }
+      
+      // Longest a send() waits for room in a full send buffer before the connection is closed, 0 waits forever
+      TransportOptions& setSendTimeout(const uint32_t timeoutMs) 
+      {
+        sendTimeoutMs = timeoutMs;
+        options |= Option_SendTimeout;
+        return *this;
+      }
+      
+      bool has(const Option option) const 
+      {
+        return (options & option) != 0;
+      }
+      
+      // Bitmask of Option values that were set
+      uint16_t options;
+      
+      bool noDelay;
+      uint32_t sendBufferSize;
+      uint32_t receiveBufferSize;
+      uint32_t keepAliveIdle;
+      uint32_t keepAliveInterval;
+      uint32_t keepAliveCount;
+      uint32_t connectTimeoutMs;
+      uint32_t readTimeoutMs;
+      uint32_t sendTimeoutMs;
+    };
+    
     struct TcpClient : public TcpSocket 
     {
       virtual bool poll() = 0;
@@ -47,6 +140,56 @@ namespace websockets2_generic
       virtual WSString readLine() = 0;
       virtual uint32_t read(uint8_t* buffer, const uint32_t len) = 0;
       virtual bool connect(const WSString& host, int port) = 0;
+      
+      // Applies the options now and to every later connect(). Returns the Option bits the
+      // stack could not honor, the default is a backend without any tuning support.
+      virtual uint16_t setOptions(const TransportOptions& options) 
+      {
+        return options.options;
+      }
+      
+      // For blocking readers on a stack whose read() returns at once: sleeps until poll() is worth
+      // calling, the connection closes or the read timeout passes. The default returns right away
+      virtual void waitReadable() {}
+      
+      // Same for loops that also watch deadlines of their own: at most timeoutMs (-1 without a limit), and a
+      // timeout leaves the connection open. True when poll() is worth calling. The default polls every millisecond
+      virtual bool waitReadableFor(const int timeoutMs) 
+      {
+        const unsigned long start = millis();
+        
+        while (!poll()) 
+        {
+          if (!available() || (timeoutMs >= 0 && millis() - start >= static_cast<unsigned long>(timeoutMs)))
+            return false;
+            
+          delay(1);
+        }
+        
+        return true;
+      }
+      
+      // For event loops, which must not wait for one slow peer: send() then never blocks, what the stack can't
+      // take right away is queued and goes out with flushSend() once the socket is writable again. A peer that
+      // lets more than limit bytes pile up is disconnected. 0 (the default) sends like a blocking socket, and
+      // a stack without a queue always does
+      virtual void setSendQueueLimit(const uint32_t limit) 
+      {
+        (void) limit;
+      }
+      
+      // Bytes queued by send() that the stack hasn't taken yet
+      virtual uint32_t pendingSend() const 
+      {
+        return 0;
+      }
+      
+      // Writes what the stack takes of the queue without waiting, true once nothing is left
+      virtual bool flushSend() 
+      {
+        return true;
+      }
+      
       virtual ~TcpClient() {}
     };
   }   // namespace network2_generic
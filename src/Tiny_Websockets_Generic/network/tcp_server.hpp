@@ -44,6 +44,17 @@ namespace websockets2_generic
       virtual bool poll() = 0;
       virtual bool listen(const uint16_t port) = 0;
       virtual TcpClient* accept() = 0;
+      
+      // Backends that complete I/O asynchronously report descriptors (as returned by getSocket())
+      // with new completions here, -1 when there is none left
+      virtual int nextReadySocket() 
+      {
+        return -1;
+      }
+      
+      // Submit any I/O the backend batched up
+      virtual void flush() {}
+      
       virtual ~TcpServer() {}
     };
   }   // namespace network2_generic
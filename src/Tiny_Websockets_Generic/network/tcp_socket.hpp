@@ -47,7 +47,8 @@ namespace websockets2_generic
           virtual bool available() = 0;
           virtual void close() = 0;
           virtual ~TcpSocket() {}
-      protected:
+          
+          // Native descriptor, or -1 on stacks without one
           virtual int getSocket() const = 0;
     };
   }   // namespace network2_generic
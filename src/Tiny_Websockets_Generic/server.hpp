@@ -35,7 +35,11 @@
 #pragma once
 
 #include <Tiny_Websockets_Generic/client.hpp>
+#include <Tiny_Websockets_Generic/internals/http_header_parser.hpp>
+#include <Tiny_Websockets_Generic/internals/token_bucket.hpp>
+#include <Tiny_Websockets_Generic/internals/timer_wheel.hpp>
 #include <functional>
+#include <vector>
 
 // KH, from v1.0.1
 #if WEBSOCKETS_USE_ETHERNET
@@ -63,13 +67,104 @@
   #warning WEBSOCKETS_USE_WIFININA in server.hpp
   #include <Tiny_Websockets_Generic/internals/ws_common_WiFiNINA.hpp>
 #else
-  #warning WEBSOCKETS_USE_ESP_WIFI in server.hpp
+  #if !( defined(__linux__) || defined(_WIN32) )
+    #warning WEBSOCKETS_USE_ESP_WIFI in server.hpp
+  #endif
   #include <Tiny_Websockets_Generic/internals/ws_common.hpp>  
 #endif
 //////
 
+// A connection that hasn't completed its upgrade request by then is answered with 408 and closed
+#ifndef WS_SERVER_HANDSHAKE_TIMEOUT_MS
+  #define WS_SERVER_HANDSHAKE_TIMEOUT_MS      5000
+#endif
+
+// Upper bound for the request line plus headers, larger requests are answered with 431
+#ifndef WS_SERVER_MAX_HANDSHAKE_SIZE
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define WS_SERVER_MAX_HANDSHAKE_SIZE      8192
+  #else
+    #define WS_SERVER_MAX_HANDSHAKE_SIZE      2048
+  #endif
+#endif
+
+// Default for connections handshaking at the same time, further ones wait in the stack's accept queue
+#ifndef WS_SERVER_MAX_PENDING_HANDSHAKES
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define WS_SERVER_MAX_PENDING_HANDSHAKES  256
+  #else
+    #define WS_SERVER_MAX_PENDING_HANDSHAKES  4
+  #endif
+#endif
+
+// Stack buffer the 101 response (about 130 bytes) and the welcome frame are written from
+#ifndef WS_SERVER_RESPONSE_BUFFER_SIZE
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define WS_SERVER_RESPONSE_BUFFER_SIZE    1024
+  #else
+    #define WS_SERVER_RESPONSE_BUFFER_SIZE    256
+  #endif
+#endif
+
+// Default capacity of the connection table used by pollAll()
+#ifndef WS_SERVER_MAX_CONNECTIONS
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define WS_SERVER_MAX_CONNECTIONS         64
+  #else
+    #define WS_SERVER_MAX_CONNECTIONS         4
+  #endif
+#endif
+
+// Frames read from one connection per pollAll() before the next one gets its turn
+#ifndef WS_SERVER_POLL_BUDGET
+  #define WS_SERVER_POLL_BUDGET               8
+#endif
+
+// Bytes a connection of the table may have queued for a peer that doesn't read before it is closed, so
+// pollAll() never waits on one. Stacks without a send queue block as before
+#ifndef WS_SERVER_SEND_QUEUE_LIMIT
+  #if ( defined(__linux__) || defined(_WIN32) )
+    #define WS_SERVER_SEND_QUEUE_LIMIT        262144
+  #else
+    #define WS_SERVER_SEND_QUEUE_LIMIT        4096
+  #endif
+#endif
+
+// How long drain() waits for the peers' close frames by default
+#ifndef WS_SERVER_DRAIN_TIMEOUT_MS
+  #define WS_SERVER_DRAIN_TIMEOUT_MS          2000
+#endif
+
+// Realm of the challenge sent with a 401 from onHandshake()
+#ifndef WS_SERVER_AUTH_REALM
+  #define WS_SERVER_AUTH_REALM                "WebSockets2_Generic"
+#endif
+
 namespace websockets2_generic
 {
+  // Answer of onHandshake(), everything but Accept closes the connection with that status
+  enum HandshakeDecision 
+  {
+    HandshakeDecision_Accept,
+    HandshakeDecision_Unauthorized,     // 401, with a Basic challenge
+    HandshakeDecision_Forbidden,        // 403
+    HandshakeDecision_Unavailable       // 503
+  };
+  
+  // A valid upgrade request, as views into the buffered request that are only valid during onHandshake()
+  struct HandshakeRequest 
+  {
+    internals2_generic::HttpStringView path;            // request target without the query
+    internals2_generic::HttpStringView query;           // after the '?', empty when there is none
+    internals2_generic::HttpStringView authorization;
+    internals2_generic::HttpStringView origin;
+    
+    // every other header, by name or HttpHeader
+    const internals2_generic::HttpHeaderParser& headers;
+  };
+  
+  typedef std::function<HandshakeDecision(const HandshakeRequest&)> HandshakeCallback;
+  
   class WebsocketsServer 
   {
     public:
@@ -83,13 +178,312 @@ namespace websockets2_generic
   
       bool available();
       void listen(uint16_t port);
+      
+      // True when a connection is waiting, so accept() doesn't have to wait for a peer to connect
       bool poll();
+      
+      // Blocks until a peer connects (unless one is waiting already) and its upgrade request is answered.
+      // An unavailable client when it was refused. The admission limits only apply to pollHandshakes()
       WebsocketsClient accept();
+      
+      // Non-blocking accept() for event loops: takes waiting connections into the handshake table and
+      // advances every pending handshake with the bytes that already arrived, never waiting for more.
+      // Returns true when acceptReady() has an upgraded connection to hand out
+      bool pollHandshakes();
+      
+      // pollHandshakes() for event loops that register the handshake sockets with their own poller, so a wakeup
+      // costs no read on the others: accepts only when socket is the listening one (or on acceptDeferred()),
+      // then advances the handshake on socket, plus those a handshake token or a timeout let finish. -1 for the
+      // latter alone, once handshakeWaitTime() passed
+      bool pollHandshakes(const int socket);
+      
+      // Sockets whose handshake the last pollHandshakes(socket) began, for the caller to register. -1 when
+      // there is none left
+      int nextHandshakeSocket();
+      
+      // Milliseconds until pollHandshakes(-1) has work (a held back connection or a handshake token due, a
+      // timed out handshake to remove), -1 when only a readable socket brings some
+      int handshakeWaitTime();
+      
+      // Next connection that completed its handshake, or an unavailable client when there is none
+      WebsocketsClient acceptReady();
+      
+      // Upgraded connections waiting for acceptReady()
+      size_t readyConnections() const
+      {
+        return _ready.size();
+      }
+      
+      // First message of every connection, sent in the same write as the 101 response when both fit
+      // WS_SERVER_RESPONSE_BUFFER_SIZE. An empty message turns it off
+      void setWelcomeMessage(const WSInterfaceString& data, const bool binary = false);
+      
+      // Admission check for every valid upgrade request, before the 101 is computed and before any
+      // WebsocketsClient exists. Refused peers get a fixed response without a body
+      void onHandshake(const HandshakeCallback callback);
+      
+      // Connections accepted from the stack whose upgrade request isn't complete yet
+      size_t pendingHandshakes() const
+      {
+        return _pending.size();
+      }
+      
+      // Admission limits, so a reconnecting herd is let in gradually instead of starving the established
+      // connections. Rates are per second, burst 0 allows one second's worth at once, perSecond 0 turns
+      // the limit off. Connections over a limit wait in the stack's accept queue unless overload mode is on
+      
+      // Connections taken from the stack
+      void setAcceptRate(const uint32_t perSecond, const uint32_t burst = 0);
+      
+      // Complete upgrade requests processed (validation, onHandshake(), SHA-1 and the 101). Requests over
+      // the rate stay buffered, for at most WS_SERVER_HANDSHAKE_TIMEOUT_MS before they get a 503
+      void setHandshakeRate(const uint32_t perSecond, const uint32_t burst = 0);
+      
+      // Upgrades in progress at the same time, WS_SERVER_MAX_PENDING_HANDSHAKES by default
+      void setMaxPendingHandshakes(const size_t count)
+      {
+        _maxPendingHandshakes = count ? count : 1;
+      }
+      
+      // Overload mode: connections over the accept limits are taken anyway and answered with a prebuilt
+      // 503 and Retry-After, so clients back off instead of piling up in the stack. Also used for the
+      // 503 of a full connection table. 0 turns it off
+      void setOverloadRetryAfter(const uint32_t seconds);
+      
+      // True when the last pollHandshakes() left connections in the stack's accept queue because of a limit,
+      // event loops should call it again soon even without a new connection being reported
+      bool acceptDeferred() const
+      {
+        return _acceptDeferred;
+      }
+      
+      // Connection table, for servers that let pollAll() manage their clients instead of calling
+      // acceptReady(). Ids stay unique while slots are reused, so a stale id never finds a newer connection.
+      typedef uint32_t ConnectionId;
+      typedef std::function<void(WebsocketsClient&, ConnectionId)> ConnectionCallback;
+      
+      // Only while the table is empty. Upgrades beyond the capacity are answered with 503
+      bool setMaxConnections(const size_t capacity);
+      
+      size_t maxConnections() const
+      {
+        return _maxConnections;
+      }
+      
+      size_t connections() const
+      {
+        return _active.size();
+      }
+      
+      // Inbound budget of every connection accepted from now on, each can still be given its own with
+      // WebsocketsClient::setInboundLimits() (in onConnection() for example)
+      void setInboundLimits(const InboundLimits& limits) 
+      {
+        _inboundLimits = limits;
+      }
+      
+      // Connections that received nothing for timeoutMs are closed with GoingAway, 0 never evicts
+      void setIdleTimeout(const uint32_t timeoutMs);
+      
+      // Pings every connection that received nothing for intervalMs, one that then stays silent (no pong
+      // nor anything else) for timeoutMs more is closed with GoingAway. timeoutMs 0 waits intervalMs,
+      // intervalMs 0 turns it off
+      void setHeartbeat(const uint32_t intervalMs, const uint32_t timeoutMs = 0);
+      
+      // A connection whose beginClose() got no close frame back within timeoutMs is closed, counted from
+      // the pollAll() that finds it closing. 0 (the default) waits as long as the peer keeps the socket
+      void setCloseTimeout(const uint32_t timeoutMs);
+      
+      // Deadlines of this server (handshake timeouts, idle eviction), open to the application for its own
+      // per connection timers (heartbeats, pong timeouts). Advanced by every pollHandshakes(), which runs the callbacks
+      WebsocketsTimerWheel& timers()
+      {
+        return _timers;
+      }
+      
+      // Called when a connection enters the table (the place to set its callbacks) and right before
+      // it leaves, whether it was closed by the peer, by the application or evicted
+      void onConnection(const ConnectionCallback callback);
+      void onDisconnection(const ConnectionCallback callback);
+      
+      // pollHandshakes(), takes completed handshakes into the table, writes what their sends queued, reads
+      // every connection (at most WS_SERVER_POLL_BUDGET frames each) and releases closed and idle ones.
+      // Returns the number of frames read
+      size_t pollAll();
+      
+      // Graceful shutdown, so a restart doesn't look like a crash (1006) that every client reconnects from at
+      // once. Stops listening, answers handshakes in progress with 503, sends GoingAway to every connection
+      // of the table and to upgraded ones nobody accepted, all in one pass, then reads until their close frames
+      // came back or timeoutMs passed and closes the rest. onDisconnection() is called for each connection of
+      // the table. Connections handed out by accept() or acceptReady() are the application's to beginClose().
+      // Returns how many were still open at the timeout, 0 when every peer answered
+      size_t drain(const uint32_t timeoutMs = WS_SERVER_DRAIN_TIMEOUT_MS);
+      
+      // nullptr when the connection is gone
+      WebsocketsClient* getConnection(const ConnectionId id);
+      
+      // Id of a client owned by the table (as passed to its callbacks), 0 for any other
+      ConnectionId getConnectionId(const WebsocketsClient& client) const;
+      
+      bool setUserData(const ConnectionId id, void* userData);
+      void* getUserData(const ConnectionId id) const;
+      
+      void forEachConnection(const ConnectionCallback callback);
+  
+      // Underlying listening socket descriptor (-1 when not supported by the stack)
+      int getSocket() const
+      {
+        return _server->getSocket();
+      }
+      
+      // For event loops on backends that complete reads in user space (io_uring), whose sockets are never
+      // reported by the kernel: descriptors of connections with new completions, -1 when there is none left
+      int nextReadySocket()
+      {
+        return _server->nextReadySocket();
+      }
+      
+      // Submits the I/O the backend batched up, once per loop iteration
+      void flush()
+      {
+        _server->flush();
+      }
+      
+      // First step of drain(), for loops that close the connections themselves: closes the listening
+      // socket and answers the handshakes in progress with 503. Upgraded ones stay for acceptReady()
+      void stopAccepting();
+      
+  #if _WEBSOCKETS_LATENCY_STATS_
+      // Receive latency per stage summed over every connection accepted by this server
+      const WebsocketsLatencyStats& getLatencyStats() const
+      {
+        return *_latencyStats;
+      }
+      
+      void resetLatencyStats()
+      {
+        _latencyStats->reset();
+      }
+  #endif
   
       virtual ~WebsocketsServer();
   
     private:
+      struct PendingHandshake
+      {
+        std::shared_ptr<network2_generic::TcpClient> client;
+        WSString request;
+        
+        // complete, but over the handshake rate
+        bool awaitingToken;
+        
+        // 408, or 503 when the request is complete but no handshake token came in time
+        WebsocketsTimer deadline;
+      };
+      
       network2_generic::TcpServer* _server;
+      
+      // before everything holding timers, so it is destroyed after them
+      WebsocketsTimerWheel _timers;
+      
+      std::vector<PendingHandshake> _pending;
+      
+      // complete frame, empty when there is no welcome message
+      WSString _welcomeFrame;
+      uint32_t _welcomeLength;
+      uint8_t _welcomeOpcode;
+      
+      HandshakeCallback _handshakeCallback;
+      
+      size_t _maxPendingHandshakes;
+      bool _acceptDeferred;
+      
+      // for handshakeWaitTime(), so event loops don't scan the table on every wakeup
+      size_t _handshakesAwaitingToken;
+      size_t _handshakesExpired;
+      std::vector<int> _startedSockets;
+      
+      internals2_generic::TokenBucket _acceptBucket;
+      internals2_generic::TokenBucket _handshakeBucket;
+      
+      InboundLimits _inboundLimits;
+      
+      // the complete 503 of overload mode, empty when it's off
+      WSString _overloadResponse;
+      
+      void shedConnection(network2_generic::TcpClient& client);
+      
+      // enters the handshake table, with its deadline armed
+      void beginHandshake(const std::shared_ptr<network2_generic::TcpClient>& client);
+      
+      // takes waiting connections the limits allow, recording their sockets for nextHandshakeSocket()
+      void acceptHandshakes(const bool record);
+      
+      // every handshake when socket is -1 and all is set, otherwise the one on socket and those
+      // handshakeWaitTime() counts
+      void advanceHandshakes(const int socket, const bool all);
+      bool handshakePending(const network2_generic::TcpClient* client) const;
+      
+      struct ReadyConnection
+      {
+        std::shared_ptr<network2_generic::TcpClient> client;
+        
+        // frames the peer pipelined behind its upgrade request, handed to the endpoint
+        WSString received;
+      };
+      
+      // upgraded and answered with 101, in the order they completed
+      std::vector<ReadyConnection> _ready;
+      
+      // true when the handshake is finished (either way) and the entry can go
+      bool advanceHandshake(PendingHandshake& pending);
+      void expireHandshake(network2_generic::TcpClient* client);
+      void sendHandshakeResponse(network2_generic::TcpClient& client, const WSString& serverAccept);
+      
+      struct ConnectionSlot
+      {
+        WebsocketsClient client;
+        ConnectionId id;              // 0 while free
+        uint16_t position;            // index in _active
+        uint64_t lastActivity;        // _timers.now()
+        void* userData;
+        
+        // Armed for the idle timeout from the connection's start, and only pushed back when it fires
+        // early, so frames never touch the wheel
+        WebsocketsTimer idleTimer;
+        
+        // The same for the heartbeat, pingSentAt is 0 unless a ping waits for an answer
+        WebsocketsTimer heartbeatTimer;
+        uint64_t pingSentAt;
+        
+        WebsocketsTimer closeTimer;
+      };
+      
+      // allocated by the first pollAll() and never resized while in use, clients keep their address
+      std::vector<ConnectionSlot> _slots;
+      std::vector<uint16_t> _freeSlots;
+      
+      // slots in use, packed for iteration
+      std::vector<uint16_t> _active;
+      
+      size_t _maxConnections;
+      uint32_t _idleTimeoutMs;
+      uint32_t _heartbeatMs;
+      uint32_t _heartbeatTimeoutMs;
+      uint32_t _closeTimeoutMs;
+      uint16_t _generation;
+      ConnectionCallback _connectionCallback;
+      ConnectionCallback _disconnectionCallback;
+      
+      ConnectionSlot* findSlot(const ConnectionId id) const;
+      void releaseSlot(const uint16_t index);
+      void expireIdle(const uint16_t index);
+      void heartbeat(const uint16_t index);
+      void expireClose(const uint16_t index);
+      
+  #if _WEBSOCKETS_LATENCY_STATS_
+      std::shared_ptr<WebsocketsLatencyStats> _latencyStats;
+  #endif
   };
 }     // namespace websockets2_generic
 
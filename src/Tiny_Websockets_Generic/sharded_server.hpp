@@ -0,0 +1,147 @@
+/****************************************************************************************************************************
+  sharded_server.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+#ifndef _SHARDED_SERVER_HPP_
+#define _SHARDED_SERVER_HPP_
+
+#pragma once
+
+#ifdef __linux__
+
+#include <Tiny_Websockets_Generic/hub.hpp>
+#include <Tiny_Websockets_Generic/network/linux/linux_tcp_server.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef WS_SHARD_BACKLOG_SIZE
+  #define WS_SHARD_BACKLOG_SIZE     1024
+#endif
+
+namespace websockets2_generic
+{
+  // Called from the worker thread that owns the connection
+  typedef std::function<void(WebsocketsClient&, size_t)> ShardConnectionCallback;
+  
+  // N worker threads, each with its own SO_REUSEPORT listening socket, WebsocketsHub and
+  // connection table. Nothing is shared between workers except the broadcast queues.
+  class WebsocketsShardedServer 
+  {
+    public:
+      // numShards == 0 uses one shard per core
+      WebsocketsShardedServer(const size_t numShards = 0);
+  
+      WebsocketsShardedServer(const WebsocketsShardedServer& other) = delete;
+      WebsocketsShardedServer(const WebsocketsShardedServer&& other) = delete;
+  
+      WebsocketsShardedServer& operator=(const WebsocketsShardedServer& other) = delete;
+      WebsocketsShardedServer& operator=(const WebsocketsShardedServer&& other) = delete;
+  
+      // Must be set before listen()
+      void onConnection(const ShardConnectionCallback callback);
+      
+      // See WebsocketsHub::setSendQueueLimit(), a broadcast to a consumer that falls behind by more than
+      // limit bytes closes it instead of stalling its shard. Must be set before listen()
+      void setSendQueueLimit(const uint32_t limit);
+  
+      bool listen(const uint16_t port);
+      bool available() const;
+      
+      // Joins the workers. Called from a worker (e.g. in a message callback), that worker can't join itself:
+      // it finishes once the callback returns and is joined by the next listen() or the destructor
+      void stop();
+      
+      // stop() after a WebsocketsHub::drain() of every shard, run by the workers in parallel
+      void drain(const uint32_t timeoutMs = WS_SERVER_DRAIN_TIMEOUT_MS);
+  
+      // Thread safe, may be called from any thread (including workers)
+      void broadcast(const WSString& data, const bool binary = false);
+  
+      size_t shards() const;
+      size_t size() const;
+  
+      // Must not run on one of the workers
+      virtual ~WebsocketsShardedServer();
+  
+    private:
+      struct Broadcast 
+      {
+        WSString data;
+        bool binary;
+      };
+  
+      struct Shard 
+      {
+        Shard() : index(0), wakeFd(-1), numClients(0) {}
+        
+        // closes wakeFd, a shard that never started included
+        ~Shard();
+        
+        size_t index;
+        std::unique_ptr<network2_generic::LinuxTcpServer> tcpServer;
+        std::unique_ptr<WebsocketsServer> server;
+        WebsocketsHub hub;
+        int wakeFd;
+        
+        std::mutex queueLock;
+        std::vector<std::shared_ptr<const Broadcast>> queue;
+        
+        std::atomic<size_t> numClients;
+        std::thread thread;
+      };
+  
+      size_t _numShards;
+      
+      // broadcast() and size() may run on any thread while stop() takes the shards away
+      mutable std::mutex _shardsLock;
+      std::vector<std::unique_ptr<Shard>> _shards;
+      
+      // stopped from their own worker, still running until it returns to run()
+      std::vector<std::unique_ptr<Shard>> _retired;
+      std::atomic<bool> _running;
+      ShardConnectionCallback _connectionCallback;
+      uint32_t _sendQueueLimit;
+      
+      // set before _running goes false, so the workers see them once they stop
+      bool _drainOnStop;
+      uint32_t _drainTimeoutMs;
+  
+      void run(Shard& shard);
+      void drainQueue(Shard& shard);
+      void joinRetired();
+  };
+}     // namespace websockets2_generic
+
+#endif    // #ifdef __linux__
+
+#endif    // _SHARDED_SERVER_HPP_
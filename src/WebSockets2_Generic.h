@@ -47,6 +47,14 @@
 #include <WebSockets2_Generic_Crypto.hpp>
 #include <WebSockets2_Generic_Endpoint.hpp>
 #include <WebSockets2_Generic_Common.hpp>
+#include <WebSockets2_Generic_Trace.hpp>
 //////
 
+#ifdef __linux__
+  #include "Tiny_Websockets_Generic/hub.hpp"
+  #include <WebSockets2_Generic_Hub.hpp>
+  #include "Tiny_Websockets_Generic/sharded_server.hpp"
+  #include <WebSockets2_Generic_ShardedServer.hpp>
+#endif
+
 #endif //_WEBSOCKETS2_GENERIC_H
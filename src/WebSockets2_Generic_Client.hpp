@@ -43,6 +43,8 @@
 #include <Tiny_Websockets_Generic/message.hpp>
 #include <Tiny_Websockets_Generic/client.hpp>
 #include <Tiny_Websockets_Generic/internals/wscrypto/crypto.hpp>
+#include <Tiny_Websockets_Generic/internals/ws_trace.hpp>
+#include <Tiny_Websockets_Generic/internals/http_header_parser.hpp>
 
 namespace websockets2_generic
 {
@@ -60,7 +62,9 @@ namespace websockets2_generic
   _eventsCallback([](WebsocketsClient&, WebsocketsEvent, WSInterfaceString) {}),
   _sendMode(SendMode_Normal)
   {
-    // Empty
+  #if _WEBSOCKETS_LATENCY_STATS_
+    _latencyStats = std::make_shared<WebsocketsLatencyStats>();
+  #endif
   }
   
   WebsocketsClient::WebsocketsClient(const WebsocketsClient& other) :
@@ -69,8 +73,13 @@ namespace websockets2_generic
     _connectionOpen(other._client->available()),
     _messagesCallback(other._messagesCallback),
     _eventsCallback(other._eventsCallback),
-    _sendMode(other._sendMode)
+    _sendMode(other._sendMode),
+    _transportOptions(other._transportOptions)
   {
+  #if _WEBSOCKETS_LATENCY_STATS_
+    _latencyStats       = other._latencyStats;
+    _serverLatencyStats = other._serverLatencyStats;
+  #endif
   
     // delete other's client
     const_cast<WebsocketsClient&>(other)._client = nullptr;
@@ -83,8 +92,13 @@ namespace websockets2_generic
     _connectionOpen(other._client->available()),
     _messagesCallback(other._messagesCallback),
     _eventsCallback(other._eventsCallback),
-    _sendMode(other._sendMode)
+    _sendMode(other._sendMode),
+    _transportOptions(other._transportOptions)
   {
+  #if _WEBSOCKETS_LATENCY_STATS_
+    _latencyStats       = other._latencyStats;
+    _serverLatencyStats = other._serverLatencyStats;
+  #endif
   
     // delete other's client
     const_cast<WebsocketsClient&>(other)._client = nullptr;
@@ -102,6 +116,12 @@ namespace websockets2_generic
     this->_eventsCallback = other._eventsCallback;
     this->_connectionOpen = other._connectionOpen;
     this->_sendMode = other._sendMode;
+    this->_transportOptions = other._transportOptions;
+    
+  #if _WEBSOCKETS_LATENCY_STATS_
+    this->_latencyStats       = other._latencyStats;
+    this->_serverLatencyStats = other._serverLatencyStats;
+  #endif
   
     // delete other's client
     const_cast<WebsocketsClient&>(other)._client = nullptr;
@@ -120,6 +140,12 @@ namespace websockets2_generic
     this->_eventsCallback = other._eventsCallback;
     this->_connectionOpen = other._connectionOpen;
     this->_sendMode = other._sendMode;
+    this->_transportOptions = other._transportOptions;
+    
+  #if _WEBSOCKETS_LATENCY_STATS_
+    this->_latencyStats       = other._latencyStats;
+    this->_serverLatencyStats = other._serverLatencyStats;
+  #endif
   
     // delete other's client
     const_cast<WebsocketsClient&>(other)._client = nullptr;
@@ -137,6 +163,7 @@ namespace websockets2_generic
       auth += ":";
       auth += password;
       base64Authorization = crypto2_generic::base64Encode((uint8_t *)auth.c_str(), auth.length());     
+      _handshakeDirty = true;
     }
   }
   
@@ -147,149 +174,112 @@ namespace websockets2_generic
   
   //////
   
-  struct HandshakeRequestResult
-  {
-    WSString requestStr;
-    WSString expectedAcceptKey;
-  };
+  // base64 of the 16 random bytes of a Sec-WebSocket-Key
+  #define WS_HANDSHAKE_KEY_LENGTH     24
   
-  bool shouldAddDefaultHeader(const std::string& keyWord, const std::vector<std::pair<WSString, WSString>>& customHeaders)
+  // The upgrade request with everything but the key, connect() only patches the key in at keyOffset
+  WSString buildHandshakeTemplate(const WSString& host, const WSString& uri,
+      const std::vector<std::pair<WSString, WSString>>& customHeaders, const WSString& base64Authorization, 
+      size_t& keyOffset) 
   {
+    using internals2_generic::HttpHeaderParser;
+    
+    // default headers are only added when not given by the user, one pass over the custom ones
+    uint32_t customKnown = 0;
+    size_t length = 192 + host.size() + uri.size() + base64Authorization.size();
+    
     for (const auto& header : customHeaders)
     {
-      if (!keyWord.compare(header.first))
-      {
-        return false;
-      }
-    }
-  
-    return true;
-  }
-  
-  HandshakeRequestResult generateHandshake(const WSString& host, const WSString& uri,
-      const std::vector<std::pair<WSString, WSString>>& customHeaders) {
-  
-    WSString key = crypto2_generic::base64Encode(crypto2_generic::randomBytes(16));
-  
-    WSString handshake = "GET " + uri + " HTTP/1.1\r\n";
-    handshake += "Host: " + host + "\r\n";
-    handshake += "Sec-WebSocket-Key: " + key + "\r\n";
-  
-    for (const auto& header : customHeaders)
-    {
-      handshake += header.first + ": " + header.second + "\r\n";
-    }
-  
-    if (shouldAddDefaultHeader("Upgrade", customHeaders))
-    {
-      handshake += "Upgrade: websocket\r\n";
-    }
-  
-    if (shouldAddDefaultHeader("Connection", customHeaders))
-    {
-      handshake += "Connection: Upgrade\r\n";
-    }
-  
-    if (shouldAddDefaultHeader("Sec-WebSocket-Version", customHeaders))
-    {
-      handshake += "Sec-WebSocket-Version: 13\r\n";
-    }
-  
-    if (shouldAddDefaultHeader("User-Agent", customHeaders))
-    {
-      handshake += "User-Agent: TinyWebsockets Client\r\n";
-    }
-  
-    if (shouldAddDefaultHeader("Origin", customHeaders))
-    {
-      handshake += "Origin: https://github.com/khoih-prog/Websockets2_Generic\r\n";
+      customKnown |= 1UL << HttpHeaderParser::classify(header.first.data(), header.first.size());
+      length += header.first.size() + header.second.size() + 4;
     }
-  
-    handshake += "\r\n";
-  
-    HandshakeRequestResult result;
-    result.requestStr = handshake;
     
-
-    // KH
-    LOGWARN1("WebsocketsClient::generateHandshake: handshake =", internals2_generic::fromInternalString(handshake));
-    ////// 
-
-  
-  #ifndef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
-    result.expectedAcceptKey = crypto2_generic::websocketsHandshakeEncodeKey(key);
-  #endif
-    return std::move(result);
-  }
-  
-  // KH
+    WSString handshake;
+    handshake.reserve(length);
   
-  HandshakeRequestResult generateHandshake(const WSString& host, const WSString& uri,
-      const std::vector<std::pair<WSString, WSString>>& customHeaders, const WSString& base64Authorization) {
-  
-    WSString key = crypto2_generic::base64Encode(crypto2_generic::randomBytes(16));
-  
-    WSString handshake = "GET " + uri + " HTTP/1.1\r\n";
+    handshake += "GET " + uri + " HTTP/1.1\r\n";
     handshake += "Host: " + host + "\r\n";
-    handshake += "Sec-WebSocket-Key: " + key + "\r\n";
+    handshake += "Sec-WebSocket-Key: ";
+    
+    keyOffset = handshake.size();
+    
+    handshake.append(WS_HANDSHAKE_KEY_LENGTH, '=');
+    handshake += "\r\n";
   
     for (const auto& header : customHeaders)
     {
       handshake += header.first + ": " + header.second + "\r\n";
     }
-  
-    if (shouldAddDefaultHeader("Upgrade", customHeaders))
-    {
-      handshake += "Upgrade: websocket\r\n";
-    }
-  
-    if (shouldAddDefaultHeader("Connection", customHeaders))
+    
+    static const struct 
     {
-      handshake += "Connection: Upgrade\r\n";
-    }
-  
-    if (shouldAddDefaultHeader("Sec-WebSocket-Version", customHeaders))
+      internals2_generic::HttpHeader header;
+      const char* line;
+    } defaults[] = 
     {
-      handshake += "Sec-WebSocket-Version: 13\r\n";
-    }
-  
-    if (shouldAddDefaultHeader("User-Agent", customHeaders))
+      { internals2_generic::HttpHeader_Upgrade,     "Upgrade: websocket\r\n" },
+      { internals2_generic::HttpHeader_Connection,  "Connection: Upgrade\r\n" },
+      { internals2_generic::HttpHeader_Version,     "Sec-WebSocket-Version: 13\r\n" },
+      { internals2_generic::HttpHeader_UserAgent,   "User-Agent: TinyWebsockets Client\r\n" }
+    };
+    
+    for (const auto& entry : defaults)
     {
-      handshake += "User-Agent: TinyWebsockets Client\r\n";
+      if (!(customKnown & (1UL << entry.header)))
+        handshake += entry.line;
     }
   
     // KH
-    //if (WebsocketsClient::base64Authorization.size() > 0)
+    if (base64Authorization.size() > 0)
     {
       handshake += "Authorization: Basic ";
       handshake += base64Authorization + "\r\n";
       
       // KH
-      LOGWARN1("WebsocketsClient::generateHandshake: base64Authorization =", internals2_generic::fromInternalString(base64Authorization));           
+      LOGDEBUG1("WebsocketsClient::buildHandshakeTemplate: base64Authorization =", internals2_generic::fromInternalString(base64Authorization));           
       //////
     }
 
-    if (shouldAddDefaultHeader("Origin", customHeaders))
+    if (!(customKnown & (1UL << internals2_generic::HttpHeader_Origin)))
     {
       handshake += "Origin: https://github.com/khoih-prog/Websockets2_Generic\r\n";
     }
     //////
   
     handshake += "\r\n";
-  
-    HandshakeRequestResult result;
-    result.requestStr = handshake;
     
     // KH
-    LOGWARN1("WebsocketsClient::generateHandshake: handshake =", internals2_generic::fromInternalString(handshake));
+    LOGDEBUG1("WebsocketsClient::buildHandshakeTemplate: handshake =", internals2_generic::fromInternalString(handshake));
     ////// 
   
+    return handshake;
+  }
+  
+  void WebsocketsClient::prepareHandshake(const WSString& host, const WSString& path)
+  {
+    if (_handshakeDirty || host != _handshakeHost || path != _handshakePath)
+    {
+      _handshakeTemplate = buildHandshakeTemplate(host, path, _customHeaders, base64Authorization, _handshakeKeyOffset);
+      _handshakeHost  = host;
+      _handshakePath  = path;
+      _handshakeDirty = false;
+    }
+    
+    if (_nextKey.empty())
+      prepareNextKey();
+      
+    _handshakeTemplate.replace(_handshakeKeyOffset, WS_HANDSHAKE_KEY_LENGTH, _nextKey);
+    _nextKey.clear();
+  }
+  
+  void WebsocketsClient::prepareNextKey()
+  {
+    _nextKey = crypto2_generic::base64Encode(crypto2_generic::randomBytes(16));
+    
   #ifndef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
-    result.expectedAcceptKey = crypto2_generic::websocketsHandshakeEncodeKey(key);
+    _nextAccept = crypto2_generic::websocketsHandshakeEncodeKey(_nextKey);
   #endif
-    return std::move(result);
   }
-  //////
   
   bool isWhitespace(char ch)
   {
@@ -299,60 +289,30 @@ namespace websockets2_generic
   struct HandshakeResponseResult
   {
     bool isSuccess;
-    WSString serverAccept;
+    // view into the parsed response
+    internals2_generic::HttpStringView serverAccept;
   };
   
-  bool isCaseInsensetiveEqual(const WSString lhs, const WSString rhs)
+  // response holds the status line and headers, up to and including the empty line
+  HandshakeResponseResult parseHandshakeResponse(const WSString& response, const void* traceConnection = nullptr)
   {
-    if (lhs.size() != rhs.size())
-      return false;
-  
-    for (size_t i = 0; i < lhs.size(); i++)
-    {
-      char leftLowerCaseChar = lhs[i] >= 'A' && lhs[i] <= 'Z' ? lhs[i] - 'A' + 'a' : lhs[i];
-      char righerLowerCaseChar = rhs[i] >= 'A' && rhs[i] <= 'Z' ? rhs[i] - 'A' + 'a' : rhs[i];
-  
-      if (leftLowerCaseChar != righerLowerCaseChar)
-        return false;
-    }
-  
-    return true;
-  }
-  
-  HandshakeResponseResult parseHandshakeResponse(std::vector<WSString> responseHeaders)
-  {
-    bool didUpgradeToWebsockets = false, isConnectionUpgraded = false;
-    WSString serverAccept = "";
-  
-    for (WSString header : responseHeaders)
-    {
-      auto colonIndex = header.find_first_of(':');
-  
-      WSString key = header.substr(0, colonIndex);
-      WSString value = header.substr(colonIndex + 2); // +2 (ignore space and ':')
-      
-      // KH
-      LOGWARN1("WebsocketsClient::generateHandshake: key =", internals2_generic::fromInternalString(key));
-      LOGWARN1("WebsocketsClient::generateHandshake: value =", internals2_generic::fromInternalString(value));
-      ////// 
-  
-      if (isCaseInsensetiveEqual(key, "upgrade"))
-      {
-        didUpgradeToWebsockets = isCaseInsensetiveEqual(value, "Websocket");
-      }
-      else if (isCaseInsensetiveEqual(key, "connection"))
-      {
-        isConnectionUpgraded = isCaseInsensetiveEqual(value, "upgrade");
-      }
-      else if (isCaseInsensetiveEqual(key, "Sec-WebSocket-Accept"))
-      {
-        serverAccept = value;
-      }
-    }
-  
+    internals2_generic::HttpHeaderParser parser;
+    
+    const bool parsed = parser.parse(response.data(), response.size(), TraceEvent_HandshakeResponseHeader, traceConnection);
+    
+    const bool didUpgradeToWebsockets = parser.get(internals2_generic::HttpHeader_Upgrade).equalsIgnoreCase("websocket");
+    const bool isConnectionUpgraded   = parser.get(internals2_generic::HttpHeader_Connection).hasToken("upgrade");
+    
     HandshakeResponseResult result;
-    result.isSuccess = serverAccept != "" && didUpgradeToWebsockets && isConnectionUpgraded;
-    result.serverAccept = serverAccept;
+    result.serverAccept = parser.get(internals2_generic::HttpHeader_Accept);
+    result.isSuccess    = parsed && !result.serverAccept.empty() && didUpgradeToWebsockets && isConnectionUpgraded;
+    
+    // KH
+    LOGDEBUG1("WebsocketsClient::parseHandshakeResponse: serverAccept =", internals2_generic::fromInternalString(result.serverAccept.toString()));
+    ////// 
+    
+    WSTRACE(TraceEvent_HandshakeResponseParsed, traceConnection, result.isSuccess, 
+            didUpgradeToWebsockets | (isConnectionUpgraded << 1) | (!result.serverAccept.empty() << 2), parser.headerCount());
   
     return result;
   }
@@ -456,6 +416,9 @@ namespace websockets2_generic
     this->_client = std::shared_ptr<WSDefaultSecuredTcpClient>(client);
     this->_endpoint.setInternalSocket(this->_client);
     
+    if (this->_transportOptions.options) 
+      this->_client->setOptions(this->_transportOptions);
+    
     // KH
     LOGDEBUG("WebsocketsClient::upgradeToSecuredConnection: SSL exit");
     //////
@@ -463,9 +426,21 @@ namespace websockets2_generic
   }
   //////
   
+  uint16_t WebsocketsClient::setTransportOptions(const network2_generic::TransportOptions& options)
+  {
+    // kept so a later upgrade to a secured client gets the same tuning
+    this->_transportOptions = options;
+    
+    if (options.has(network2_generic::TransportOptions::Option_ReadTimeout))
+      _endpoint.setPartialFrameTimeout(options.readTimeoutMs);
+    
+    return this->_client ? this->_client->setOptions(options) : options.options;
+  }
+  
   void WebsocketsClient::addHeader(const WSInterfaceString key, const WSInterfaceString value)
   {
     _customHeaders.push_back({internals2_generic::fromInterfaceString(key), internals2_generic::fromInterfaceString(value)});
+    _handshakeDirty = true;
   }
   
   bool WebsocketsClient::connect(WSInterfaceString _url)
@@ -560,7 +535,11 @@ namespace websockets2_generic
     LOGDEBUG("WebsocketsClient::connect: step 1");
     //////
     
+    WSTRACE(TraceEvent_ConnectStarted, this->_client.get(), 0, port, 0);
+    
     this->_connectionOpen = this->_client->connect(internals2_generic::fromInterfaceString(host), port);
+    
+    WSTRACE(TraceEvent_TcpConnected, this->_client.get(), this->_connectionOpen, 0, 0);
   
     if (!this->_connectionOpen)
     {
@@ -570,12 +549,14 @@ namespace websockets2_generic
     
       return false;
     }
+    
+    this->_endpoint.reopen();
   
     // KH
-    //auto handshake = generateHandshake(internals2_generic::fromInterfaceString(host), internals2_generic::fromInterfaceString(path), _customHeaders);
+    prepareHandshake(internals2_generic::fromInterfaceString(host), internals2_generic::fromInterfaceString(path));
     
-    auto handshake = generateHandshake(internals2_generic::fromInterfaceString(host), 
-                        internals2_generic::fromInterfaceString(path), _customHeaders, base64Authorization);
+    WSString expectedAcceptKey;
+    expectedAcceptKey.swap(_nextAccept);
                         
     LOGINFO1("WebsocketsClient::connect: base64Authorization =", internals2_generic::fromInternalString(base64Authorization));             
     //////
@@ -584,7 +565,9 @@ namespace websockets2_generic
     LOGDEBUG("WebsocketsClient::connect: step 2");
     //////
     
-    this->_client->send(handshake.requestStr);
+    this->_client->send(_handshakeTemplate);
+    
+    WSTRACE(TraceEvent_HandshakeRequestSent, this->_client.get(), _customHeaders.size(), _handshakeTemplate.size(), base64Authorization.size());
     
     // KH
     LOGDEBUG("WebsocketsClient::connect: step 3");
@@ -603,8 +586,12 @@ namespace websockets2_generic
     LOGDEBUG("WebsocketsClient::connect: step 4");
     //////
     
+    const bool switchingProtocols = doestStartsWith(head, "HTTP/1.1 101");
+    
+    WSTRACE(TraceEvent_HandshakeResponseStatus, this->_client.get(), switchingProtocols, head.size(), 0);
+    
     // KH
-    if (!doestStartsWith(head, "HTTP/1.1 101"))
+    if (!switchingProtocols)
     //
     {
       close(CloseReason_ProtocolError);
@@ -616,7 +603,8 @@ namespace websockets2_generic
       return false;
     }
   
-    std::vector<WSString> serverResponseHeaders;
+    // The whole head in one buffer, the parser only keeps views into it
+    WSString response = head;
     WSString line = "";
   
     // KH
@@ -633,25 +621,22 @@ namespace websockets2_generic
         return false;
       }
   
+      response += line;
+      
       if (line == "\r\n")
         break;
-  
-      // remove /r/n from line end
-      line = line.substr(0, line.size() - 2);
-  
-      serverResponseHeaders.push_back(line);
     }
     
     // KH
     LOGDEBUG("WebsocketsClient::connect: step 6");
     //////
   
-    auto parsedResponse = parseHandshakeResponse(serverResponseHeaders);
+    auto parsedResponse = parseHandshakeResponse(response, this->_client.get());
   
   #ifdef _WS_CONFIG_SKIP_HANDSHAKE_ACCEPT_VALIDATION
     bool serverAcceptMismatch = false;
   #else
-    bool serverAcceptMismatch = parsedResponse.serverAccept != handshake.expectedAcceptKey;
+    bool serverAcceptMismatch = !parsedResponse.serverAccept.equals(expectedAcceptKey);
   #endif
   
     if (parsedResponse.isSuccess == false || serverAcceptMismatch)
@@ -666,6 +651,8 @@ namespace websockets2_generic
     // KH
     LOGDEBUG("WebsocketsClient::connect: step 7");
     //////
+    
+    WSTRACE(TraceEvent_ConnectionOpened, this->_client.get(), 0, port, 0);
   
     this->_eventsCallback(*this, WebsocketsEvent::ConnectionOpened, {});
     return true;
@@ -698,27 +685,54 @@ namespace websockets2_generic
   }
   
   bool WebsocketsClient::poll()
+  {
+    size_t numFrames = 0;
+    
+    return pollFrames(WS_CLIENT_POLL_BUDGET, numFrames);
+  }
+  
+  bool WebsocketsClient::hasPendingData()
+  {
+    return available() && _endpoint.hasPendingData();
+  }
+  
+  bool WebsocketsClient::pollFrames(const size_t maxFrames, size_t& numFrames)
   {
     bool messageReceived = false;
-    while (available() && _endpoint.poll())
+    numFrames = 0;
+    
+    while (available() && (maxFrames == 0 || numFrames < maxFrames) && _endpoint.poll())
     {
       auto msg = _endpoint.recv();
+      
+      // The socket ran dry, on a non-blocking one this read replaces asking it first. A partial
+      // frame is resumed on the next readiness event
+      if (msg.isEmpty() && _endpoint.readStalled())
+        break;
+        
+      numFrames++;
   
       if (msg.isEmpty())
       {
+  #if _WEBSOCKETS_LATENCY_STATS_
+        // fragment that only fed the aggregation buffer
+        _recordLatency(0, 0);
+  #endif
         continue;
       }
   
       messageReceived = true;
   
-      if (msg.isBinary() || msg.isText())
-      {
-        this->_messagesCallback(*this, std::move(msg));
-      }
-      else if (msg.isContinuation())
+      if (msg.isBinary() || msg.isText() || msg.isContinuation())
       {
         // continuation messages will only be returned when policy is appropriate
+  #if _WEBSOCKETS_LATENCY_STATS_
+        const uint32_t enteredAt = micros();
         this->_messagesCallback(*this, std::move(msg));
+        _recordLatency(enteredAt, micros());
+  #else
+        this->_messagesCallback(*this, std::move(msg));
+  #endif
       }
       else if (msg.isPing())
       {
@@ -734,10 +748,43 @@ namespace websockets2_generic
         _handleClose(std::move(msg));
       }
     }
+    
+    // Idle poll of a connection we opened: get the key for a reconnect ready now, not after a drop
+    if (numFrames == 0 && _nextKey.empty() && !_handshakeTemplate.empty())
+      prepareNextKey();
   
     return messageReceived;
   }
   
+#if _WEBSOCKETS_LATENCY_STATS_
+  void WebsocketsClient::_recordLatency(const uint32_t enteredAt, const uint32_t returnedAt)
+  {
+    const internals2_generic::FrameTimestamps& frame = _endpoint.getFrameTimestamps();
+    
+    // the read failed half way, nothing meaningful to record
+    if (frame.payloadComplete == 0)
+      return;
+    
+    WebsocketsLatencyStats* targets[2] = { _latencyStats.get(), _serverLatencyStats.get() };
+    
+    for (WebsocketsLatencyStats* stats : targets)
+    {
+      if (!stats)
+        continue;
+        
+      stats->stages[LatencyStage_Header].record(frame.headerParsed - frame.readableAt);
+      stats->stages[LatencyStage_Payload].record(frame.payloadComplete - frame.headerParsed);
+      
+      if (returnedAt == 0)
+        continue;
+        
+      stats->stages[LatencyStage_Dispatch].record(enteredAt - frame.payloadComplete);
+      stats->stages[LatencyStage_Callback].record(returnedAt - enteredAt);
+      stats->stages[LatencyStage_Total].record(returnedAt - frame.readableAt);
+    }
+  }
+#endif
+  
   // KH add in v1.0.6
   WebsocketsMessage WebsocketsClient::readNonBlocking()
   {
@@ -761,6 +808,10 @@ namespace websockets2_generic
   
       if (!msg.isEmpty())
         return msg;
+        
+      // non-blocking transport with nothing there yet: sleep on it instead of spinning
+      if (_endpoint.readStalled())
+        _client->waitReadable();
     }
   
     return {};
@@ -945,6 +996,17 @@ namespace websockets2_generic
     }
   }
   
+  void WebsocketsClient::beginClose(const CloseReason reason)
+  {
+    if (available())
+      _endpoint.beginClose(reason);
+  }
+  
+  bool WebsocketsClient::closing()
+  {
+    return _endpoint.closeSent() && available();
+  }
+  
   CloseReason WebsocketsClient::getCloseReason() const
   {
     return _endpoint.getCloseReason();
@@ -38,6 +38,7 @@
 #include <WebSockets2_Generic.h>
 
 #include <Tiny_Websockets_Generic/internals/websockets_endpoint.hpp>
+#include <Tiny_Websockets_Generic/internals/ws_trace.hpp>
 
 namespace websockets2_generic
 {
@@ -121,8 +122,25 @@ namespace websockets2_generic
       _recvMode(other._recvMode),
       _streamBuilder(other._streamBuilder),
       _closeReason(other._closeReason),
-      _useMasking(other._useMasking)
-    {
+      _closeSent(other._closeSent),
+      _useMasking(other._useMasking),
+      _inboundLimits(other._inboundLimits),
+      _inboundLimited(other._inboundLimited),
+      _inboundDelayed(other._inboundDelayed),
+      _droppingMessage(other._droppingMessage),
+      _inboundMessages(other._inboundMessages),
+      _inboundBytes(other._inboundBytes),
+      _rxStage(other._rxStage),
+      _rxDone(other._rxDone),
+      _rxFrame(other._rxFrame),
+      _rxStalled(other._rxStalled),
+      _rxWaiting(other._rxWaiting),
+      _rxStalledAt(other._rxStalledAt),
+      _rxTimeoutMs(other._rxTimeoutMs),
+      _rxEarly(other._rxEarly)
+    {
+      memcpy(_rxHeader, other._rxHeader, sizeof(_rxHeader));
+      
       const_cast<WebsocketsEndpoint&>(other)._client = nullptr;
     }
     
@@ -132,8 +150,25 @@ namespace websockets2_generic
       _recvMode(other._recvMode),
       _streamBuilder(other._streamBuilder),
       _closeReason(other._closeReason),
-      _useMasking(other._useMasking)
-    {
+      _closeSent(other._closeSent),
+      _useMasking(other._useMasking),
+      _inboundLimits(other._inboundLimits),
+      _inboundLimited(other._inboundLimited),
+      _inboundDelayed(other._inboundDelayed),
+      _droppingMessage(other._droppingMessage),
+      _inboundMessages(other._inboundMessages),
+      _inboundBytes(other._inboundBytes),
+      _rxStage(other._rxStage),
+      _rxDone(other._rxDone),
+      _rxFrame(other._rxFrame),
+      _rxStalled(other._rxStalled),
+      _rxWaiting(other._rxWaiting),
+      _rxStalledAt(other._rxStalledAt),
+      _rxTimeoutMs(other._rxTimeoutMs),
+      _rxEarly(other._rxEarly)
+    {
+      memcpy(_rxHeader, other._rxHeader, sizeof(_rxHeader));
+      
       const_cast<WebsocketsEndpoint&>(other)._client = nullptr;
     }
     
@@ -143,7 +178,24 @@ namespace websockets2_generic
       this->_recvMode = other._recvMode;
       this->_streamBuilder = other._streamBuilder;
       this->_closeReason = other._closeReason;
+      this->_closeSent = other._closeSent;
       this->_useMasking = other._useMasking;
+      this->_inboundLimits = other._inboundLimits;
+      this->_inboundLimited = other._inboundLimited;
+      this->_inboundDelayed = other._inboundDelayed;
+      this->_droppingMessage = other._droppingMessage;
+      this->_inboundMessages = other._inboundMessages;
+      this->_inboundBytes = other._inboundBytes;
+      this->_rxStage = other._rxStage;
+      this->_rxDone = other._rxDone;
+      this->_rxFrame = other._rxFrame;
+      this->_rxStalled = other._rxStalled;
+      this->_rxWaiting = other._rxWaiting;
+      this->_rxStalledAt = other._rxStalledAt;
+      this->_rxTimeoutMs = other._rxTimeoutMs;
+      this->_rxEarly = other._rxEarly;
+      
+      memcpy(this->_rxHeader, other._rxHeader, sizeof(_rxHeader));
     
       const_cast<WebsocketsEndpoint&>(other)._client = nullptr;
     
@@ -156,7 +208,24 @@ namespace websockets2_generic
       this->_recvMode = other._recvMode;
       this->_streamBuilder = other._streamBuilder;
       this->_closeReason = other._closeReason;
+      this->_closeSent = other._closeSent;
       this->_useMasking = other._useMasking;
+      this->_inboundLimits = other._inboundLimits;
+      this->_inboundLimited = other._inboundLimited;
+      this->_inboundDelayed = other._inboundDelayed;
+      this->_droppingMessage = other._droppingMessage;
+      this->_inboundMessages = other._inboundMessages;
+      this->_inboundBytes = other._inboundBytes;
+      this->_rxStage = other._rxStage;
+      this->_rxDone = other._rxDone;
+      this->_rxFrame = other._rxFrame;
+      this->_rxStalled = other._rxStalled;
+      this->_rxWaiting = other._rxWaiting;
+      this->_rxStalledAt = other._rxStalledAt;
+      this->_rxTimeoutMs = other._rxTimeoutMs;
+      this->_rxEarly = other._rxEarly;
+      
+      memcpy(this->_rxHeader, other._rxHeader, sizeof(_rxHeader));
     
       const_cast<WebsocketsEndpoint&>(other)._client = nullptr;
     
@@ -166,155 +235,350 @@ namespace websockets2_generic
     void WebsocketsEndpoint::setInternalSocket(std::shared_ptr<network2_generic::TcpClient> socket) 
     {
       this->_client = socket;
+      this->_rxEarly.clear();
+      resetReceive();
     }
     
     bool WebsocketsEndpoint::poll() 
     {
+      // Delay policy: the data stays in the socket until the budget refilled
+      if (_inboundLimited && _inboundLimits.policy == RateLimitPolicy_Delay) 
+      {
+        const bool delayed = inboundWaitTime() > 0;
+        
+        if (delayed && !_inboundDelayed)
+          WSTRACE(TraceEvent_InboundLimited, this->_client.get(), RateLimitPolicy_Delay, 0, 0);
+          
+        _inboundDelayed = delayed;
+        
+        if (delayed)
+          return false;
+      }
+      
+      if (_rxWaiting && partialFrameExpired())
+        return false;
+        
+      if (!_rxEarly.empty())
+        return true;
+      
       return this->_client->poll();
     }
     
-    uint32_t readUntilSuccessfullOrError(network2_generic::TcpClient& socket, uint8_t* buffer, const uint32_t len) 
+    void WebsocketsEndpoint::setInboundLimits(const InboundLimits& limits) 
     {
-      auto numRead = socket.read(buffer, len);
+      const unsigned long now = millis();
       
-      while (numRead == static_cast<uint32_t>(-1) && socket.available()) 
+      _inboundLimits  = limits;
+      _inboundLimited = limits.messagesPerSecond != 0 || limits.bytesPerSecond != 0;
+      _inboundDelayed = false;
+      
+      _inboundMessages.configure(limits.messagesPerSecond, limits.messageBurst, now);
+      _inboundBytes.configure(limits.bytesPerSecond, limits.byteBurst, now);
+    }
+    
+    uint32_t WebsocketsEndpoint::inboundWaitTime() 
+    {
+      if (!_inboundLimited || _inboundLimits.policy != RateLimitPolicy_Delay)
+        return 0;
+        
+      const unsigned long now = millis();
+      const uint32_t messagesWait = _inboundMessages.waitTime(now);
+      const uint32_t bytesWait    = _inboundBytes.waitTime(now);
+      
+      return messagesWait > bytesWait ? messagesWait : bytesWait;
+    }
+    
+    // Decided on the first frame of a message, the bytes of a message let in are charged as they come
+    bool WebsocketsEndpoint::admitInbound(const uint8_t opcode, const bool fin, const uint64_t payloadLength) 
+    {
+      const unsigned long now = millis();
+      const uint32_t length = payloadLength > 0xFFFFFFFF ? 0xFFFFFFFF : static_cast<uint32_t>(payloadLength);
+      
+      if (opcode == ContentType::Continuation) 
+      {
+        if (_droppingMessage) 
+        {
+          _droppingMessage = !fin;
+          return false;
+        }
+        
+        _inboundBytes.charge(now, length);
+        return true;
+      }
+      
+      // Delay already waited for the budget in poll()
+      if (_inboundLimits.policy == RateLimitPolicy_Delay || (_inboundMessages.ready(now) && _inboundBytes.ready(now))) 
       {
-        numRead = socket.read(buffer, len);
+        _inboundMessages.charge(now, 1);
+        _inboundBytes.charge(now, length);
+        return true;
       }
       
-      return numRead;
+      WSTRACE(TraceEvent_InboundLimited, this->_client.get(), _inboundLimits.policy, length, 0);
+      
+      if (_inboundLimits.policy == RateLimitPolicy_Close) 
+      {
+        close(CloseReason_PolicyViolation);
+        return false;
+      }
+      
+      _droppingMessage = !fin;
+      
+      return false;
     }
     
-    Header readHeaderFromSocket(network2_generic::TcpClient& socket) 
+    // Bytes of a frame header from its first two: the extended payload length and the masking key included
+    uint8_t frameHeaderSize(const uint8_t* header) 
     {
-      Header header;
-      header.payload = 0;
+      const uint8_t payload = header[1] & 0x7F;
       
-      readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&header), 2);
-      
-      return header;
+      return 2 + (payload == 126 ? 2 : payload == 127 ? 8 : 0) + ((header[1] & 0x80) ? 4 : 0);
     }
     
-    uint64_t readExtendedPayloadLength(network2_generic::TcpClient& socket, const Header& header) 
+    // Payload length of a complete header, its masking key (if any) goes to maskingKey
+    uint64_t parseFrameHeader(const uint8_t* header, uint8_t* maskingKey) 
     {
-      uint64_t extendedPayload = header.payload;
+      const uint8_t payload = header[1] & 0x7F;
+      uint64_t length = payload;
+      size_t offset = 2;
       
-      // in case of extended payload length
-      if (header.payload == 126) 
+      // in case of extended payload length, network byte order
+      if (payload == 126) 
       {
-        // read next 16 bits as payload length
-        uint16_t tmp = 0;
-        readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&tmp), 2);
-        tmp = (tmp << 8) | (tmp >> 8);
-        extendedPayload = tmp;
+        length = (static_cast<uint64_t>(header[2]) << 8) | header[3];
+        offset = 4;
       }
-      else if (header.payload == 127) 
+      else if (payload == 127) 
       {
-        uint64_t tmp = 0;
-        readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(&tmp), 8);
-        extendedPayload = swapEndianess(tmp);
+        length = 0;
+        
+        for (offset = 2; offset < 10; offset++)
+          length = (length << 8) | header[offset];
       }
+      
+      if (header[1] & 0x80) 
+        memcpy(maskingKey, header + offset, 4);
+      
+      return length;
+    }
     
-      return extendedPayload;
+    void remaskData(WSString& data, const uint8_t* const maskingKey, uint64_t payloadLength) 
+    {
+      for (uint64_t i = 0; i < payloadLength; i++) 
+      {
+        data[i] = data[i] ^ maskingKey[i % 4];
+      }
     }
     
-    void readMaskingKey(network2_generic::TcpClient& socket, uint8_t* outputBuffer) 
+    void WebsocketsEndpoint::resetReceive() 
     {
-      readUntilSuccessfullOrError(socket, reinterpret_cast<uint8_t*>(outputBuffer), 4);
+      _rxStage    = RxStage_Header;
+      _rxDone     = 0;
+      _rxFrame    = WebsocketsFrame();
+      _rxStalled  = false;
+      _rxWaiting  = false;
     }
     
-    WSString readData(network2_generic::TcpClient& socket, uint64_t extendedPayload) 
+    // Closes the connection when the frame being read got no further within the timeout
+    bool WebsocketsEndpoint::partialFrameExpired() 
     {
-      const uint64_t BUFFER_SIZE = _WS_BUFFER_SIZE;
+      if (_rxTimeoutMs == 0 || millis() - _rxStalledAt < _rxTimeoutMs)
+        return false;
+        
+      LOGWARN1("WebsocketsEndpoint::recv: partial frame timed out, bytes =", static_cast<unsigned long>(_rxDone));
+      
+      resetReceive();
+      close(CloseReason_PolicyViolation);
+      
+      return true;
+    }
     
-      WSString data(extendedPayload, '\0');
-      uint8_t buffer[BUFFER_SIZE];
-      uint64_t done_reading = 0;
+    // At most len bytes, whatever the stack has right now. 0 when it has nothing (stalled) or the connection
+    // is gone, which also drops the partial frame
+    uint32_t WebsocketsEndpoint::readSome(uint8_t* buffer, const uint64_t len) 
+    {
+      if (!_rxEarly.empty()) 
+      {
+        const uint32_t count = len < _rxEarly.size() ? static_cast<uint32_t>(len) : static_cast<uint32_t>(_rxEarly.size());
+        
+        memcpy(buffer, _rxEarly.data(), count);
+        _rxEarly.erase(0, count);
+        _rxWaiting = false;
+        
+        return count;
+      }
+      
+      const uint32_t count = this->_client->read(buffer, len > 0x40000000 ? 0x40000000 : static_cast<uint32_t>(len));
       
-      while (done_reading < extendedPayload && socket.available()) 
+      // (uint32_t) -1, or 0 from stacks that report an empty buffer that way while connected
+      if (count != 0 && count != static_cast<uint32_t>(-1)) 
       {
-        uint64_t to_read = extendedPayload - done_reading >= BUFFER_SIZE ? BUFFER_SIZE : extendedPayload - done_reading;
-        uint32_t numReceived = readUntilSuccessfullOrError(socket, buffer, to_read);
-    
-        // On failed reads, skip
-        if (!socket.available()) 
-          break;
-    
-        for (uint64_t i = 0; i < numReceived; i++) 
+        _rxWaiting = false;
+        return count;
+      }
+        
+      if (!this->_client->available()) 
+      {
+        resetReceive();
+        return 0;
+      }
+      
+      _rxStalled = true;
+      
+      // Half way through a frame: wait for the rest, but not forever
+      if (_rxStage != RxStage_Header || _rxDone > 0) 
+      {
+        if (!_rxWaiting) 
         {
-          data[done_reading + i] = static_cast<char>(buffer[i]);
+          _rxWaiting    = true;
+          _rxStalledAt  = millis();
+        }
+        else 
+        {
+          partialFrameExpired();
         }
-    
-        done_reading += numReceived;
       }
-      
-      return std::move(data);
+        
+      return 0;
     }
     
-    void remaskData(WSString& data, const uint8_t* const maskingKey, uint64_t payloadLength) 
+    // Reads into buffer until _rxDone reaches len, false when it has to be resumed later
+    bool WebsocketsEndpoint::readPart(uint8_t* buffer, const uint64_t len) 
     {
-      for (uint64_t i = 0; i < payloadLength; i++) 
+      while (_rxDone < len) 
       {
-        data[i] = data[i] ^ maskingKey[i % 4];
+        const uint32_t count = readSome(buffer + _rxDone, len - _rxDone);
+        
+        if (count == 0) 
+          return false;
+          
+        _rxDone += count;
       }
+      
+      return true;
     }
     
-    WebsocketsFrame WebsocketsEndpoint::_recv() 
+    // Two reads at most: the first two bytes tell the size of the rest
+    bool WebsocketsEndpoint::readFrameHeader() 
     {
-      auto header = readHeaderFromSocket(*this->_client);
+    #if _WEBSOCKETS_LATENCY_STATS_
+      uint32_t readAt = 0;
       
-      if (!_client->available()) 
-        return WebsocketsFrame(); // In case of faliure
+      if (_rxDone == 0) 
+      {
+        readAt = micros();
+        
+        _frameTimestamps.readableAt       = 0;
+        _frameTimestamps.headerParsed     = 0;
+        _frameTimestamps.payloadComplete  = 0;
+      }
+    #endif
     
-      uint64_t payloadLength = readExtendedPayloadLength(*this->_client, header);
+      const bool complete = readPart(_rxHeader, 2) && readPart(_rxHeader, frameHeaderSize(_rxHeader));
       
-      if (!_client->available()) 
-        return WebsocketsFrame(); // In case of faliure
+    #if _WEBSOCKETS_LATENCY_STATS_
+      // The frame starts with its first byte, every stage is measured from there even when the rest
+      // of it comes with later polls
+      if (readAt != 0 && _rxDone > 0) 
+        _frameTimestamps.readableAt = readAt;
+    #endif
     
+      if (!complete) 
+        return false;
+        
+      _rxFrame.fin    = _rxHeader[0] >> 7;
+      _rxFrame.opcode = _rxHeader[0] & 0x0F;
+      _rxFrame.mask   = _rxHeader[1] >> 7;
+      
+      memset(_rxFrame.mask_buf, 0, sizeof(_rxFrame.mask_buf));
+      _rxFrame.payload_length = parseFrameHeader(_rxHeader, _rxFrame.mask_buf);
+      
+      _rxStage  = RxStage_Payload;
+      _rxDone   = 0;
+      
     #ifdef _WS_CONFIG_MAX_MESSAGE_SIZE
-      if (payloadLength > _WS_CONFIG_MAX_MESSAGE_SIZE) 
+      if (_rxFrame.payload_length > _WS_CONFIG_MAX_MESSAGE_SIZE) 
       {
-        return WebsocketsFrame();
+        _rxStage = RxStage_Skip;
+        return true;
       }
     #endif
     
-      uint8_t maskingKey[4];
+      // Over the budget: dropped or closed before any payload is allocated
+      if (_inboundLimited && !(_rxFrame.opcode & 0x08) && !admitInbound(_rxFrame.opcode, _rxFrame.fin, _rxFrame.payload_length)) 
+      {
+        if (_client->available())
+          _rxStage = RxStage_Skip;
+        else
+          resetReceive();
+          
+        return true;
+      }
+      
+    #if _WEBSOCKETS_LATENCY_STATS_
+      _frameTimestamps.headerParsed = micros();
+    #endif
+    
+      _rxFrame.payload.assign(_rxFrame.payload_length, '\0');
+      
+      return true;
+    }
+    
+    WebsocketsFrame WebsocketsEndpoint::_recv() 
+    {
+      _rxStalled = false;
       
-      // if masking is set
-      if (header.mask) 
+      if (_rxStage == RxStage_Header && !readFrameHeader()) 
+        return WebsocketsFrame();
+        
+      if (_rxStage == RxStage_Skip) 
       {
-        readMaskingKey(*this->_client, maskingKey);
+        uint8_t buffer[_WS_BUFFER_SIZE];
+        
+        while (_rxDone < _rxFrame.payload_length) 
+        {
+          const uint64_t left = _rxFrame.payload_length - _rxDone;
+          const uint32_t count = readSome(buffer, left < sizeof(buffer) ? left : sizeof(buffer));
+          
+          if (count == 0) 
+            return WebsocketsFrame();
+            
+          _rxDone += count;
+        }
         
-        if (!_client->available()) 
-          return WebsocketsFrame(); // In case of faliure
+        resetReceive();
+        
+        return WebsocketsFrame();
       }
-    
-      WebsocketsFrame frame;
-      // read the message's payload (data) according to the read length
-      frame.payload = readData(*this->_client, payloadLength);
       
-      if (!_client->available()) 
-        return WebsocketsFrame(); // In case of faliure
+      // closed by admitInbound()
+      if (_rxStage == RxStage_Header) 
+        return WebsocketsFrame();
+      
+      // the payload goes straight into the frame
+      if (_rxFrame.payload_length > 0 && !readPart(reinterpret_cast<uint8_t*>(&_rxFrame.payload[0]), _rxFrame.payload_length)) 
+        return WebsocketsFrame();
+        
+      WebsocketsFrame frame = std::move(_rxFrame);
+      
+      resetReceive();
     
       // if masking is set un-mask the message
-      if (header.mask) 
+      if (frame.mask) 
       {
-        remaskData(frame.payload, maskingKey, payloadLength);
+        remaskData(frame.payload, frame.mask_buf, frame.payload_length);
       }
+      
+    #if _WEBSOCKETS_LATENCY_STATS_
+      _frameTimestamps.payloadComplete = micros();
+    #endif
+      
+      WSTRACE(TraceEvent_FrameReceived, this->_client.get(), frame.opcode | (frame.fin << 4) | (frame.mask << 5), frame.payload_length, 0);
+      
+      if (frame.isControlFrame())
+        WSTRACE(TraceEvent_ControlReceived, this->_client.get(), frame.opcode, frame.payload_length, 0);
     
-      // Construct frame from data and header that was read
-      frame.fin = header.fin;
-      frame.mask = header.mask;
-    
-      frame.mask_buf[0] = maskingKey[0];
-      frame.mask_buf[1] = maskingKey[1];
-      frame.mask_buf[2] = maskingKey[2];
-      frame.mask_buf[3] = maskingKey[3];
-    
-      frame.opcode = header.opcode;
-      frame.payload_length = payloadLength;
-    
-      return std::move(frame);
+      return frame;
     }
     
     WebsocketsMessage WebsocketsEndpoint::handleFrameInStreamingMode(WebsocketsFrame& frame) 
@@ -323,7 +587,7 @@ namespace websockets2_generic
       if (frame.isControlFrame()) {
         auto msg = WebsocketsMessage::CreateFromFrame(std::move(frame));
         this->handleMessageInternally(msg);
-        return std::move(msg);
+        return msg;
       }
       else if (frame.isBeginningOfFragmentsStream()) 
       {
@@ -331,6 +595,8 @@ namespace websockets2_generic
     
         if (this->_streamBuilder.isEmpty()) 
         {
+          WSTRACE(TraceEvent_FragmentsStarted, this->_client.get(), frame.opcode, frame.payload_length, 0);
+          
           this->_streamBuilder.first(frame);
           
           // if policy is set to notify, return the frame to the user
@@ -362,6 +628,9 @@ namespace websockets2_generic
         this->_recvMode = RecvMode_Normal;
         this->_streamBuilder.end(frame);
         
+        WSTRACE(TraceEvent_FragmentsEnded, this->_client.get(), this->_streamBuilder.type() == MessageType::Binary ? ContentType::Binary : ContentType::Text, 
+                frame.payload_length, 0);
+        
         if (this->_streamBuilder.isOk()) 
         {
           // if policy is set to notify, return the frame to the user
@@ -397,7 +666,7 @@ namespace websockets2_generic
       {
         auto msg = WebsocketsMessage::CreateFromFrame(std::move(frame));
         this->handleMessageInternally(msg);
-        return std::move(msg);
+        return msg;
       }
       else if (frame.isBeginningOfFragmentsStream()) 
       {
@@ -450,6 +719,8 @@ namespace websockets2_generic
           this->_closeReason = CloseReason_GoingAway;
         }
         
+        WSTRACE(TraceEvent_CloseReceived, this->_client.get(), this->_closeReason, 0, 0);
+        
         close(this->_closeReason);
       }
     }
@@ -514,6 +785,11 @@ namespace websockets2_generic
         return false;
       }
     #endif
+    
+      // no data frame follows our close frame, pings and pongs still may (RFC 6455 5.5.1)
+      if (this->_closeSent && opcode < ContentType::Close) 
+        return false;
+        
       // send the header
       std::string message_data = getHeader(len, opcode, fin, mask);
     
@@ -532,6 +808,11 @@ namespace websockets2_generic
     
       this->_client->send(reinterpret_cast<const uint8_t*>(message_data.c_str()), message_data.size());
       
+      WSTRACE(TraceEvent_FrameSent, this->_client.get(), opcode | (fin << 4) | (mask << 5), len, 0);
+      
+      if (opcode >= ContentType::Close)
+        WSTRACE(TraceEvent_ControlSent, this->_client.get(), opcode, len, 0);
+      
       return true; // TODO dont assume success
     }
     
@@ -541,7 +822,28 @@ namespace websockets2_generic
     
       if (!this->_client->available()) 
         return;
+        
+      WSTRACE(TraceEvent_ConnectionClosed, this->_client.get(), reason, 0, 0);
+    
+      // after beginClose() this is the peer's answer (or the wait for it ended), ours went out already
+      if (!this->_closeSent) 
+        sendCloseFrame(reason);
+      
+      this->_client->close();
+    }
+    
+    void WebsocketsEndpoint::beginClose(const CloseReason reason) 
+    {
+      if (this->_closeSent || !this->_client->available()) 
+        return;
+        
+      WSTRACE(TraceEvent_CloseSent, this->_client.get(), reason, 0, 0);
+      
+      sendCloseFrame(reason);
+    }
     
+    void WebsocketsEndpoint::sendCloseFrame(const CloseReason reason) 
+    {
       if (reason == CloseReason_None) 
       {
         send(nullptr, 0, internals2_generic::ContentType::Close, true, this->_useMasking);
@@ -553,7 +855,7 @@ namespace websockets2_generic
         send(reinterpret_cast<const char*>(&reasonNum), 2, internals2_generic::ContentType::Close, true, this->_useMasking);
       }
       
-      this->_client->close();
+      this->_closeSent = true;
     }
     
     CloseReason WebsocketsEndpoint::getCloseReason() const 
@@ -0,0 +1,760 @@
+/****************************************************************************************************************************
+  WebSockets2_Generic_Hub.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+#ifndef _WEBSOCKETS2_GENERIC_HUB_H
+#define _WEBSOCKETS2_GENERIC_HUB_H
+
+#pragma once
+
+#ifdef __linux__
+
+// KH
+#include <WebSockets2_Generic.h>
+#include "WebSockets2_Generic_Debug.h"
+
+#include <Tiny_Websockets_Generic/hub.hpp>
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace websockets2_generic
+{
+  WebsocketsHub::WebsocketsHub(const size_t maxEvents) :
+    _epoll(epoll_create1(EPOLL_CLOEXEC)),
+    _events(maxEvents > 0 ? maxEvents : 1),
+    _numClients(0),
+    _connectionCallback([](WebsocketsClient&) {}),
+    _idleTimeoutMs(0),
+    _heartbeatMs(0),
+    _heartbeatTimeoutMs(0),
+    _closeTimeoutMs(0),
+    _sendQueueLimit(WS_HUB_SEND_QUEUE_LIMIT)
+  {
+    if (_epoll < 0)
+    {
+      LOGERROR1("WebsocketsHub: epoll_create1 failed, errno =", errno);
+    }
+  }
+  
+  bool WebsocketsHub::available() const
+  {
+    return _epoll >= 0;
+  }
+  
+  bool WebsocketsHub::insert(Entry* entry, const uint32_t events)
+  {
+    if (!available() || entry->fd < 0)
+    {
+      delete entry;
+      return false;
+    }
+  
+    if (static_cast<size_t>(entry->fd) >= _entries.size())
+    {
+      _entries.resize(entry->fd + 1, nullptr);
+    }
+    else if (_entries[entry->fd])
+    {
+      // Stale entry whose descriptor was closed behind our back and reused, or the handshake of the
+      // connection now added. Released first, its EPOLL_CTL_DEL would remove the new registration
+      release(_entries[entry->fd]);
+    }
+  
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = entry;
+  
+    if (epoll_ctl(_epoll, EPOLL_CTL_ADD, entry->fd, &ev) != 0)
+    {
+      LOGWARN1("WebsocketsHub::insert: epoll_ctl failed, errno =", errno);
+      delete entry;
+      return false;
+    }
+  
+    _entries[entry->fd] = entry;
+    
+    return true;
+  }
+  
+  void WebsocketsHub::release(Entry* entry)
+  {
+    if (entry->dead)
+      return;
+  
+    entry->dead = true;
+  
+    // The descriptor may already be closed (and even reused), so only touch it if we still own the slot
+    if (static_cast<size_t>(entry->fd) < _entries.size() && _entries[entry->fd] == entry)
+    {
+      epoll_ctl(_epoll, EPOLL_CTL_DEL, entry->fd, nullptr);
+      _entries[entry->fd] = nullptr;
+    }
+  
+    if (entry->kind == Entry::Kind_Client)
+    {
+      _numClients--;
+      entry->idleTimer.cancel();
+      entry->heartbeatTimer.cancel();
+      entry->closeTimer.cancel();
+    }
+    else if (entry->kind == Entry::Kind_Timer)
+    {
+      ::close(entry->fd);
+    }
+  
+    // Events of this batch may still point at the entry
+    _graveyard.push_back(entry);
+  }
+  
+  bool WebsocketsHub::attach(WebsocketsServer& server)
+  {
+    Entry* entry  = new Entry();
+    entry->kind   = Entry::Kind_Server;
+    entry->fd     = server.getSocket();
+    entry->dead   = false;
+    entry->backlogged = false;
+    entry->server = &server;
+  
+    if (!insert(entry, EPOLLIN | EPOLLET))
+      return false;
+  
+    _servers.push_back(&server);
+    
+    return true;
+  }
+  
+  void WebsocketsHub::onConnection(const ConnectionCallback callback)
+  {
+    this->_connectionCallback = callback;
+  }
+  
+  bool WebsocketsHub::add(WebsocketsClient& client)
+  {
+    if (!client.available())
+      return false;
+  
+    Entry* entry  = new Entry();
+    entry->kind   = Entry::Kind_Client;
+    entry->fd     = client.getSocket();
+    entry->dead   = false;
+    entry->backlogged = false;
+    entry->client = std::unique_ptr<WebsocketsClient>(new WebsocketsClient(client));
+    entry->client->setSendQueueLimit(_sendQueueLimit);
+  
+    // EPOLLOUT only comes again after a send found the socket full, idle connections never see it
+    if (!insert(entry, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET))
+      return false;
+  
+    _numClients++;
+    
+    entry->lastActivity = _timers.now();
+    entry->pingSentAt   = 0;
+    
+    if (_idleTimeoutMs > 0)
+    {
+      entry->idleTimer.setCallback([this, entry]() { expireIdle(entry); });
+      _timers.arm(entry->idleTimer, _idleTimeoutMs);
+    }
+    
+    if (_heartbeatMs > 0)
+    {
+      entry->heartbeatTimer.setCallback([this, entry]() { heartbeat(entry); });
+      _timers.arm(entry->heartbeatTimer, _heartbeatMs);
+    }
+  
+    // Data may have arrived before registration, edge-triggered epoll would never report it
+    dispatch(entry, EPOLLIN);
+    
+    return true;
+  }
+  
+  size_t WebsocketsHub::size() const
+  {
+    return _numClients;
+  }
+  
+  void WebsocketsHub::setSendQueueLimit(const uint32_t limit)
+  {
+    _sendQueueLimit = limit;
+  }
+  
+  void WebsocketsHub::forEach(const std::function<void(WebsocketsClient&)> callback)
+  {
+    for (size_t fd = 0; fd < _entries.size(); fd++)
+    {
+      Entry* entry = _entries[fd];
+      
+      if (entry && entry->kind == Entry::Kind_Client && !entry->dead)
+      {
+        callback(*entry->client);
+        
+        // closed by the callback, or by a send over the queue limit: epoll won't report the socket again
+        if (!entry->client->available())
+          release(entry);
+        else
+          watchClose(entry);
+      }
+    }
+  }
+  
+  void WebsocketsHub::setIdleTimeout(const uint32_t timeoutMs)
+  {
+    _idleTimeoutMs = timeoutMs;
+    
+    // connections already in the hub count from now
+    for (Entry* entry : _entries)
+    {
+      if (!entry || entry->kind != Entry::Kind_Client || entry->dead)
+        continue;
+        
+      if (timeoutMs == 0)
+      {
+        entry->idleTimer.cancel();
+        continue;
+      }
+      
+      entry->lastActivity = _timers.now();
+      entry->idleTimer.setCallback([this, entry]() { expireIdle(entry); });
+      _timers.arm(entry->idleTimer, timeoutMs);
+    }
+  }
+  
+  void WebsocketsHub::expireIdle(Entry* entry)
+  {
+    const uint64_t idle = _timers.now() - entry->lastActivity;
+    
+    if (idle < _idleTimeoutMs)
+    {
+      _timers.arm(entry->idleTimer, static_cast<uint32_t>(_idleTimeoutMs - idle));
+      return;
+    }
+    
+    LOGINFO1("WebsocketsHub: closing idle connection, fd =", entry->fd);
+    
+    // while the descriptor is still ours to remove from epoll
+    release(entry);
+    entry->client->close(CloseReason_GoingAway);
+  }
+  
+  // Lazy like expireIdle(), see WebsocketsServer::heartbeat()
+  void WebsocketsHub::heartbeat(Entry* entry)
+  {
+    if (entry->client->closing())
+      return;
+      
+    const uint64_t now = _timers.now();
+    
+    if (entry->pingSentAt != 0 && entry->lastActivity < entry->pingSentAt)
+    {
+      const uint64_t waited = now - entry->pingSentAt;
+      
+      if (waited < _heartbeatTimeoutMs)
+      {
+        _timers.arm(entry->heartbeatTimer, static_cast<uint32_t>(_heartbeatTimeoutMs - waited));
+        return;
+      }
+      
+      LOGINFO1("WebsocketsHub: no answer to the heartbeat, fd =", entry->fd);
+      
+      release(entry);
+      entry->client->close(CloseReason_GoingAway);
+      return;
+    }
+    
+    entry->pingSentAt = 0;
+    
+    const uint64_t idle = now - entry->lastActivity;
+    
+    if (idle < _heartbeatMs)
+    {
+      _timers.arm(entry->heartbeatTimer, static_cast<uint32_t>(_heartbeatMs - idle));
+      return;
+    }
+    
+    entry->client->ping();
+    entry->pingSentAt = now;
+    
+    _timers.arm(entry->heartbeatTimer, _heartbeatTimeoutMs);
+  }
+  
+  void WebsocketsHub::setHeartbeat(const uint32_t intervalMs, const uint32_t timeoutMs)
+  {
+    _heartbeatMs        = intervalMs;
+    _heartbeatTimeoutMs = timeoutMs ? timeoutMs : intervalMs;
+    
+    // connections already in the hub count from now
+    for (Entry* entry : _entries)
+    {
+      if (!entry || entry->kind != Entry::Kind_Client || entry->dead)
+        continue;
+        
+      entry->pingSentAt = 0;
+      
+      if (intervalMs == 0)
+      {
+        entry->heartbeatTimer.cancel();
+        continue;
+      }
+      
+      entry->lastActivity = _timers.now();
+      entry->heartbeatTimer.setCallback([this, entry]() { heartbeat(entry); });
+      _timers.arm(entry->heartbeatTimer, intervalMs);
+    }
+  }
+  
+  // Arms the close timeout of a connection found waiting for the peer's close frame
+  void WebsocketsHub::watchClose(Entry* entry)
+  {
+    if (_closeTimeoutMs == 0 || entry->dead || entry->closeTimer.armed() || !entry->client->closing())
+      return;
+      
+    entry->closeTimer.setCallback([this, entry]() { expireClose(entry); });
+    _timers.arm(entry->closeTimer, _closeTimeoutMs);
+  }
+  
+  void WebsocketsHub::expireClose(Entry* entry)
+  {
+    LOGINFO1("WebsocketsHub: no close frame from the peer in time, fd =", entry->fd);
+    
+    release(entry);
+    entry->client->close(CloseReason_AbnormalClosure);
+  }
+  
+  void WebsocketsHub::setCloseTimeout(const uint32_t timeoutMs)
+  {
+    _closeTimeoutMs = timeoutMs;
+    
+    // those waiting already keep their deadline
+    if (timeoutMs > 0)
+      return;
+      
+    for (Entry* entry : _entries)
+    {
+      if (entry && entry->kind == Entry::Kind_Client)
+        entry->closeTimer.cancel();
+    }
+  }
+  
+  int WebsocketsHub::addTimer(const uint32_t intervalMs, const TimerCallback callback, const bool repeat)
+  {
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    
+    if (fd < 0)
+      return -1;
+  
+    // a repeating timer at 0 would fire back to back and never let the loop sleep
+    const uint32_t periodMs = (repeat && intervalMs == 0) ? 1 : intervalMs;
+    
+    struct itimerspec spec;
+    spec.it_value.tv_sec  = periodMs / 1000;
+    spec.it_value.tv_nsec = (periodMs % 1000) * 1000000L;
+  
+    // a zero it_value disarms the timer, a one-shot at 0 fires right away
+    if (periodMs == 0)
+      spec.it_value.tv_nsec = 1;
+  
+    spec.it_interval = repeat ? spec.it_value : (struct timespec) { 0, 0 };
+  
+    if (timerfd_settime(fd, 0, &spec, nullptr) != 0)
+    {
+      ::close(fd);
+      return -1;
+    }
+  
+    Entry* entry          = new Entry();
+    entry->kind           = Entry::Kind_Timer;
+    entry->fd             = fd;
+    entry->dead           = false;
+    entry->backlogged     = false;
+    entry->repeat         = repeat;
+    entry->timerCallback  = callback;
+  
+    if (!insert(entry, EPOLLIN | EPOLLET))
+    {
+      ::close(fd);
+      return -1;
+    }
+  
+    return fd;
+  }
+  
+  void WebsocketsHub::cancelTimer(const int id)
+  {
+    if (id >= 0 && static_cast<size_t>(id) < _entries.size() && _entries[id] && _entries[id]->kind == Entry::Kind_Timer)
+    {
+      release(_entries[id]);
+    }
+  }
+  
+  bool WebsocketsHub::watch(const int fd, const WatchCallback callback, const uint32_t events)
+  {
+    Entry* entry          = new Entry();
+    entry->kind           = Entry::Kind_Watch;
+    entry->fd             = fd;
+    entry->dead           = false;
+    entry->backlogged     = false;
+    entry->watchCallback  = callback;
+  
+    return insert(entry, events);
+  }
+  
+  void WebsocketsHub::unwatch(const int fd)
+  {
+    if (fd >= 0 && static_cast<size_t>(fd) < _entries.size() && _entries[fd] && _entries[fd]->kind == Entry::Kind_Watch)
+    {
+      release(_entries[fd]);
+    }
+  }
+  
+  void WebsocketsHub::acceptAll(WebsocketsServer& server, const int socket)
+  {
+    if (!server.available())
+      return;
+      
+    // Edge-triggered: pollHandshakes() drains the whole accept queue, and reads a handshake socket until it
+    // would block
+    server.pollHandshakes(socket);
+    
+    int fd;
+    
+    // registered like the connections, so the handshakes in progress cost nothing until their peer sends
+    while ((fd = server.nextHandshakeSocket()) >= 0)
+    {
+      Entry* entry  = new Entry();
+      entry->kind   = Entry::Kind_Handshake;
+      entry->fd     = fd;
+      entry->dead   = false;
+      entry->backlogged = false;
+      entry->server = &server;
+      
+      // a request that arrived already is reported right away
+      insert(entry, EPOLLIN | EPOLLRDHUP | EPOLLET);
+    }
+    
+    while (server.readyConnections() > 0)
+    {
+      WebsocketsClient client = server.acceptReady();
+  
+      if (!client.available())
+        continue;
+  
+      _connectionCallback(client);
+      add(client);
+    }
+  }
+  
+  void WebsocketsHub::dispatchCompletions(WebsocketsServer& server)
+  {
+    // io_uring style backends complete reads in user space, the kernel never reports those sockets to epoll
+    int fd;
+    
+    while ((fd = server.nextReadySocket()) >= 0)
+    {
+      if (static_cast<size_t>(fd) < _entries.size() && _entries[fd] && !_entries[fd]->dead)
+      {
+        dispatch(_entries[fd], EPOLLIN);
+      }
+    }
+  }
+  
+  void WebsocketsHub::dispatch(Entry* entry, const uint32_t events)
+  {
+    switch (entry->kind)
+    {
+      case Entry::Kind_Client:
+      {
+        // room again for what the sends queued
+        if (events & EPOLLOUT)
+          entry->client->flushSend();
+          
+        // Edge-triggered: read until the socket is drained (a hang-up shows up as readable too,
+        // and the failed read closes the client), but no more than the budget in one go
+        size_t numFrames = 0;
+        
+        if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+          entry->client->pollFrames(WS_HUB_POLL_BUDGET, numFrames);
+        
+        if (numFrames > 0 && (_idleTimeoutMs > 0 || _heartbeatMs > 0))
+          entry->lastActivity = _timers.now();
+  
+        if (!entry->client->available())
+        {
+          release(entry);
+          break;
+        }
+        
+        // beginClose() from one of its callbacks
+        watchClose(entry);
+        
+        // Also held back by its inbound limits: the socket won't be reported again, so it waits in the
+        // backlog, and the hub sleeps no longer than its wait time
+        if ((numFrames == WS_HUB_POLL_BUDGET || entry->client->inboundWaitTime() > 0) && !entry->backlogged && 
+            entry->client->hasPendingData())
+        {
+          entry->backlogged = true;
+          _backlog.push_back(entry);
+        }
+  
+        break;
+      }
+  
+      // A finished handshake's entry is replaced by its connection's, a refused or timed out one stays
+      // until its descriptor is reused (closed, it is never reported)
+      case Entry::Kind_Server:
+      case Entry::Kind_Handshake:
+        acceptAll(*entry->server, entry->fd);
+        break;
+  
+      case Entry::Kind_Timer:
+      {
+        uint64_t expirations = 0;
+        
+        if (::read(entry->fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+        {
+          entry->timerCallback();
+          
+          if (!entry->repeat)
+          {
+            release(entry);
+          }
+        }
+        
+        break;
+      }
+  
+      case Entry::Kind_Watch:
+        entry->watchCallback(events);
+        break;
+    }
+  }
+  
+  size_t WebsocketsHub::poll(const int timeoutMs)
+  {
+    if (!available())
+      return 0;
+  
+    // one submission for everything the previous batch queued
+    for (WebsocketsServer* server : _servers)
+    {
+      server->flush();
+    }
+  
+    int waitMs = timeoutMs;
+    int timerMs = _timers.timeUntilNext();
+    
+    if (timerMs >= 0 && (waitMs < 0 || timerMs < waitMs))
+      waitMs = timerMs;
+    
+    for (WebsocketsServer* server : _servers)
+    {
+      timerMs = server->timers().timeUntilNext();
+      
+      if (timerMs >= 0 && (waitMs < 0 || timerMs < waitMs))
+        waitMs = timerMs;
+        
+      // connections held back by an admission limit, requests waiting for a handshake token
+      timerMs = server->handshakeWaitTime();
+      
+      if (timerMs >= 0 && (waitMs < 0 || timerMs < waitMs))
+        waitMs = timerMs;
+    }
+  
+    // don't sleep while connections still have data to read, or longer than a throttled one waits
+    for (Entry* entry : _backlog)
+    {
+      const int backlogMs = entry->dead ? 0 : static_cast<int>(entry->client->inboundWaitTime());
+      
+      if (waitMs < 0 || backlogMs < waitMs)
+        waitMs = backlogMs;
+    }
+    
+    int numEvents = epoll_wait(_epoll, _events.data(), _events.size(), waitMs);
+    
+    std::vector<Entry*> backlog;
+    backlog.swap(_backlog);
+  
+    for (int i = 0; i < numEvents; i++)
+    {
+      Entry* entry = static_cast<Entry*>(_events[i].data.ptr);
+  
+      if (!entry->dead)
+      {
+        dispatch(entry, _events[i].events);
+      }
+    }
+  
+    for (Entry* entry : backlog)
+    {
+      entry->backlogged = false;
+      
+      if (!entry->dead)
+      {
+        dispatch(entry, EPOLLIN);
+      }
+    }
+  
+    for (WebsocketsServer* server : _servers)
+    {
+      dispatchCompletions(*server);
+      server->timers().advance();
+      
+      // nothing reports a handshake token, the end of an accept limit or a timed out handshake
+      if (server->handshakeWaitTime() == 0)
+      {
+        acceptAll(*server, -1);
+        
+        // reads its accept completed on the way, the ring's descriptor won't report them again
+        dispatchCompletions(*server);
+      }
+    }
+    
+    // after the batch, so activity it read pushes idle timers back instead of racing them
+    const size_t numTimers = _timers.advance();
+  
+    // released entries must not survive in the backlog
+    for (size_t i = 0; i < _backlog.size(); )
+    {
+      if (_backlog[i]->dead)
+      {
+        _backlog[i] = _backlog.back();
+        _backlog.pop_back();
+      }
+      else
+      {
+        i++;
+      }
+    }
+  
+    for (Entry* entry : _graveyard)
+    {
+      delete entry;
+    }
+  
+    _graveyard.clear();
+  
+    return (numEvents > 0 ? numEvents : 0) + numTimers;
+  }
+  
+  size_t WebsocketsHub::drain(const uint32_t timeoutMs)
+  {
+    for (WebsocketsServer* server : _servers)
+    {
+      const int fd = server->getSocket();
+      
+      server->stopAccepting();
+      
+      // A closed listening socket leaves epoll by itself, its entry must not outlive it. io_uring servers
+      // are registered by their ring, which goes on completing reads
+      if (server->getSocket() != fd && fd >= 0 && static_cast<size_t>(fd) < _entries.size() && _entries[fd] && 
+          _entries[fd]->server == server)
+      {
+        release(_entries[fd]);
+      }
+      
+      // answered with 101 already, so they are closed like the others
+      while (server->readyConnections() > 0)
+      {
+        WebsocketsClient client = server->acceptReady();
+        
+        if (client.available())
+          add(client);
+      }
+    }
+    
+    // every peer gets its close frame before we wait for any of them
+    for (Entry* entry : _entries)
+    {
+      if (entry && entry->kind == Entry::Kind_Client && !entry->dead)
+        entry->client->beginClose(CloseReason_GoingAway);
+    }
+    
+    for (WebsocketsServer* server : _servers)
+    {
+      server->flush();
+    }
+    
+    // an answered close frame closes the client and releases its entry while it is dispatched
+    const uint64_t deadline = _timers.now() + timeoutMs;
+    
+    while (_numClients > 0)
+    {
+      const uint64_t now = _timers.now();
+      
+      if (now >= deadline)
+        break;
+        
+      poll(static_cast<int>(deadline - now));
+    }
+    
+    const size_t open = _numClients;
+    
+    if (open > 0)
+    {
+      LOGWARN1("WebsocketsHub::drain: no close frame from the peer in time, connections =", open);
+    }
+    
+    for (Entry* entry : _entries)
+    {
+      if (entry && entry->kind == Entry::Kind_Client && !entry->dead)
+      {
+        release(entry);
+        entry->client->close(CloseReason_GoingAway);
+      }
+    }
+    
+    return open;
+  }
+  
+  WebsocketsHub::~WebsocketsHub()
+  {
+    for (Entry* entry : _entries)
+    {
+      if (entry)
+      {
+        release(entry);
+      }
+    }
+  
+    for (Entry* entry : _graveyard)
+    {
+      delete entry;
+    }
+  
+    if (_epoll >= 0)
+    {
+      ::close(_epoll);
+    }
+  }
+}     // namespace websockets2_generic
+
+#endif    // #ifdef __linux__
+
+#endif    // _WEBSOCKETS2_GENERIC_HUB_H
@@ -39,13 +39,34 @@
 #include "WebSockets2_Generic_Debug.h"
 
 #include <Tiny_Websockets_Generic/server.hpp>
+#include <Tiny_Websockets_Generic/internals/ws_trace.hpp>
 #include <Tiny_Websockets_Generic/internals/wscrypto/crypto.hpp>
+#include <Tiny_Websockets_Generic/internals/http_header_parser.hpp>
+#include <Tiny_Websockets_Generic/network/line_reader.hpp>
 #include <memory>
-#include <map>
 
 namespace websockets2_generic
 {
-  WebsocketsServer::WebsocketsServer(network2_generic::TcpServer* server) : _server(server) {}
+  WebsocketsServer::WebsocketsServer(network2_generic::TcpServer* server) : 
+    _server(server),
+    _welcomeLength(0),
+    _welcomeOpcode(0),
+    _maxPendingHandshakes(WS_SERVER_MAX_PENDING_HANDSHAKES),
+    _acceptDeferred(false),
+    _handshakesAwaitingToken(0),
+    _handshakesExpired(0),
+    _inboundLimits({ 0, 0, 0, 0, RateLimitPolicy_Delay }),
+    _maxConnections(WS_SERVER_MAX_CONNECTIONS),
+    _idleTimeoutMs(0),
+    _heartbeatMs(0),
+    _heartbeatTimeoutMs(0),
+    _closeTimeoutMs(0),
+    _generation(0)
+  {
+  #if _WEBSOCKETS_LATENCY_STATS_
+    _latencyStats = std::make_shared<WebsocketsLatencyStats>();
+  #endif
+  }
   
   bool WebsocketsServer::available() 
   {
@@ -57,133 +78,1126 @@ namespace websockets2_generic
     this->_server->listen(port);
   }
   
+  // Answers a refused upgrade and drops the connection. Built on the stack, refusing a flood of peers
+  // costs no heap
+  static void rejectHandshake(network2_generic::TcpClient& client, const char* status, const char* extraHeaders = "") 
+  {
+    char response[256];
+    int length = snprintf(response, sizeof(response), "HTTP/1.1 %s\r\n%sConnection: close\r\nContent-Length: 0\r\n\r\n", 
+                          status, extraHeaders);
+    
+    // truncated at worst, it's closed right after anyway
+    if (length >= static_cast<int>(sizeof(response)))
+      length = sizeof(response) - 1;
+      
+    if (length > 0) 
+      client.send(reinterpret_cast<const uint8_t*>(response), static_cast<uint32_t>(length));
+      
+    client.close();
+  }
+  
+  // "GET /path?query HTTP/1.1" into path and query
+  static void splitRequestTarget(const internals2_generic::HttpStringView& startLine, 
+                                 internals2_generic::HttpStringView& path, internals2_generic::HttpStringView& query) 
+  {
+    const char* begin = startLine.data;
+    const char* end   = startLine.data + startLine.size;
+    
+    const char* target = begin;
+    
+    while (target < end && *target != ' ')
+      target++;
+      
+    while (target < end && *target == ' ')
+      target++;
+      
+    const char* targetEnd = target;
+    
+    while (targetEnd < end && *targetEnd != ' ')
+      targetEnd++;
+      
+    const char* mark = target;
+    
+    while (mark < targetEnd && *mark != '?')
+      mark++;
+      
+    path  = { target, static_cast<size_t>(mark - target) };
+    query = mark < targetEnd ? internals2_generic::HttpStringView { mark + 1, static_cast<size_t>(targetEnd - mark - 1) } 
+                             : internals2_generic::HttpStringView { nullptr, 0 };
+  }
+  
+  static const char handshakeResponseHead[] = 
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Connection: Upgrade\r\n"
+    "Upgrade: websocket\r\n"
+    "Sec-WebSocket-Version: 13\r\n"
+    "Sec-WebSocket-Accept: ";
+    
+  static const char handshakeResponseTail[] = "\r\n\r\n";
+  
+  void WebsocketsServer::sendHandshakeResponse(network2_generic::TcpClient& client, const WSString& serverAccept) 
+  {
+    // One write, so the response leaves as one segment even with Nagle off
+    uint8_t response[WS_SERVER_RESPONSE_BUFFER_SIZE];
+    size_t length = 0;
+    
+    memcpy(response, handshakeResponseHead, sizeof(handshakeResponseHead) - 1);
+    length += sizeof(handshakeResponseHead) - 1;
+    
+    memcpy(response + length, serverAccept.data(), serverAccept.size());
+    length += serverAccept.size();
+    
+    memcpy(response + length, handshakeResponseTail, sizeof(handshakeResponseTail) - 1);
+    length += sizeof(handshakeResponseTail) - 1;
+    
+    const bool bundleWelcome = !_welcomeFrame.empty() && length + _welcomeFrame.size() <= sizeof(response);
+    
+    if (bundleWelcome) 
+    {
+      memcpy(response + length, _welcomeFrame.data(), _welcomeFrame.size());
+      length += _welcomeFrame.size();
+    }
+    
+    client.send(response, static_cast<uint32_t>(length));
+    
+    if (!_welcomeFrame.empty()) 
+    {
+      if (!bundleWelcome)
+        client.send(_welcomeFrame);
+      
+      WSTRACE(TraceEvent_FrameSent, &client, _welcomeOpcode | (1 << 4), _welcomeLength, 0);
+    }
+  }
+  
+  void WebsocketsServer::setWelcomeMessage(const WSInterfaceString& data, const bool binary) 
+  {
+    const WSString payload = internals2_generic::fromInterfaceString(data);
+    
+    _welcomeOpcode = binary ? internals2_generic::ContentType::Binary : internals2_generic::ContentType::Text;
+    _welcomeLength = static_cast<uint32_t>(payload.size());
+    
+    // Server to client frames are never masked
+    if (payload.empty())
+      _welcomeFrame.clear();
+    else
+      _welcomeFrame = internals2_generic::WebsocketsEndpoint::getHeader(payload.size(), _welcomeOpcode, true, false) + payload;
+  }
+  
+  void WebsocketsServer::onHandshake(const HandshakeCallback callback) 
+  {
+    this->_handshakeCallback = callback;
+  }
+  
+  void WebsocketsServer::setAcceptRate(const uint32_t perSecond, const uint32_t burst) 
+  {
+    _acceptBucket.configure(perSecond, burst, millis());
+  }
+  
+  void WebsocketsServer::setHandshakeRate(const uint32_t perSecond, const uint32_t burst) 
+  {
+    _handshakeBucket.configure(perSecond, burst, millis());
+  }
+  
+  void WebsocketsServer::setOverloadRetryAfter(const uint32_t seconds) 
+  {
+    if (seconds == 0) 
+    {
+      _overloadResponse.clear();
+      return;
+    }
+    
+    char response[128];
+    snprintf(response, sizeof(response), 
+             "HTTP/1.1 503 Service Unavailable\r\nRetry-After: %lu\r\nConnection: close\r\nContent-Length: 0\r\n\r\n",
+             static_cast<unsigned long>(seconds));
+             
+    _overloadResponse = response;
+  }
+  
+  // 503, with Retry-After in overload mode
+  void WebsocketsServer::shedConnection(network2_generic::TcpClient& client) 
+  {
+    if (_overloadResponse.empty()) 
+    {
+      rejectHandshake(client, "503 Service Unavailable");
+      return;
+    }
+    
+    client.send(reinterpret_cast<const uint8_t*>(_overloadResponse.data()), static_cast<uint32_t>(_overloadResponse.size()));
+    client.close();
+  }
+  
   bool WebsocketsServer::poll() 
   {
-    return this->_server->poll();
+    return !_ready.empty() || !_pending.empty() || (this->_server->available() && this->_server->poll());
   }
   
-  struct ParsedHandshakeParams 
+  void WebsocketsServer::beginHandshake(const std::shared_ptr<network2_generic::TcpClient>& tcpClient) 
   {
-    WSString head;
-    std::map<WSString, WSString> headers;
-  };
+    WSTRACE(TraceEvent_HandshakeRequestStarted, tcpClient.get(), 0, 0, 0);
+    
+    _pending.push_back(PendingHandshake());
+    
+    PendingHandshake& pending = _pending.back();
+    network2_generic::TcpClient* client = tcpClient.get();
+    
+    pending.client = tcpClient;
+    pending.awaitingToken = false;
+    pending.deadline.setCallback([this, client]() { expireHandshake(client); });
+    _timers.arm(pending.deadline, WS_SERVER_HANDSHAKE_TIMEOUT_MS);
+  }
   
-  ParsedHandshakeParams recvHandshakeRequest(network2_generic::TcpClient& client) 
+  bool WebsocketsServer::handshakePending(const network2_generic::TcpClient* client) const 
   {
-    ParsedHandshakeParams result;
+    for (const PendingHandshake& pending : _pending) 
+    {
+      if (pending.client.get() == client)
+        return true;
+    }
+    
+    return false;
+  }
   
-    result.head = client.readLine();
+  bool WebsocketsServer::pollHandshakes() 
+  {
+    acceptHandshakes(false);
+    advanceHandshakes(-1, true);
+    
+    // after the handshakes read what arrived, a request completed in time is never answered with 408.
+    // Those that time out close here and leave the table on the next pollHandshakes()
+    _timers.advance();
+    
+    return !_ready.empty();
+  }
   
-    WSString line = client.readLine();
+  bool WebsocketsServer::pollHandshakes(const int socket) 
+  {
+    // the caller took them all after the previous call
+    _startedSockets.clear();
+    
+    if ((socket >= 0 && socket == getSocket()) || _acceptDeferred) 
+      acceptHandshakes(true);
+      
+    advanceHandshakes(socket, false);
+    _timers.advance();
     
-    do 
+    return !_ready.empty();
+  }
+  
+  int WebsocketsServer::nextHandshakeSocket() 
+  {
+    if (_startedSockets.empty()) 
+      return -1;
+      
+    const int socket = _startedSockets.back();
+    
+    _startedSockets.pop_back();
+    
+    return socket;
+  }
+  
+  int WebsocketsServer::handshakeWaitTime() 
+  {
+    if (_handshakesExpired > 0) 
+      return 0;
+      
+    const unsigned long now = millis();
+    int waitMs = -1;
+    
+    // held back by a full table, the next finished handshake makes room
+    if (_acceptDeferred && _pending.size() < _maxPendingHandshakes) 
+      waitMs = static_cast<int>(_acceptBucket.waitTime(now));
+      
+    if (_handshakesAwaitingToken > 0) 
     {
-      WSString key = "", value = "";
-      size_t idx = 0;
+      const int tokenMs = static_cast<int>(_handshakeBucket.waitTime(now));
+      
+      if (waitMs < 0 || tokenMs < waitMs)
+        waitMs = tokenMs;
+    }
+    
+    return waitMs;
+  }
   
-      // read key
-      while (idx < line.size() && line[idx] != ':') 
+  void WebsocketsServer::acceptHandshakes(const bool record) 
+  {
+    const unsigned long now = millis();
+    
+    _acceptDeferred = false;
+    
+    // Take every waiting connection the limits allow, edge-triggered callers rely on the accept queue
+    // being drained or on acceptDeferred()
+    while (this->_server->available() && this->_server->poll()) 
+    {
+      // the token is only taken once accept() gave us a connection, a failed one doesn't use it up
+      const bool admit = _pending.size() < _maxPendingHandshakes && _acceptBucket.ready(now);
+      
+      if (!admit && _overloadResponse.empty()) 
       {
-        key += line[idx];
-        idx++;
+        _acceptDeferred = true;
+        break;
       }
-  
-      // skip key and whitespace
-      idx++;
-      while (idx < line.size() && (line[idx] == ' ' || line[idx] == '\t')) 
-        idx++;
-  
-      // read value (until \r\n)
-      while (idx < line.size() && line[idx] != '\r') 
+      
+      std::shared_ptr<network2_generic::TcpClient> tcpClient(_server->accept());
+      
+      // KH add v1.0.6
+      if (!tcpClient)
+        break;
+      //////
+      
+      if (tcpClient->available() == false)
       {
-        value += line[idx];
-        idx++;
+        // KH
+        LOGDEBUG("WebsocketsServer::pollHandshakes: tcpClient not available");
+        //////
+        break;
       }
+      
+      // Overload mode: answered before reading anything, never enters the handshake table
+      if (!admit) 
+      {
+        WSTRACE(TraceEvent_HandshakeRejected, tcpClient.get(), TraceReject_Overload, 0, 503);
+        
+        shedConnection(*tcpClient);
+        continue;
+      }
+      
+      _acceptBucket.take(now);
+      beginHandshake(tcpClient);
+      
+      if (record)
+        _startedSockets.push_back(tcpClient->getSocket());
+    }
+  }
   
-      // store header
-      result.headers[key] = value;
+  void WebsocketsServer::advanceHandshakes(const int socket, const bool all) 
+  {
+    // a handshake token can let any of those over the rate finish, a timeout closes any of them
+    const bool tokens = _handshakesAwaitingToken > 0 && _handshakeBucket.ready(millis());
+    const bool expired = _handshakesExpired > 0;
+    
+    _handshakesExpired = 0;
+    
+    for (size_t i = 0; i < _pending.size(); ) 
+    {
+      PendingHandshake& pending = _pending[i];
+      const bool due = all || (tokens && pending.awaitingToken) || (expired && !pending.client->available()) || 
+                       (socket >= 0 && pending.client->getSocket() == socket);
       
-      // KH
-      LOGWARN1("WebsocketsServer::recvHandshakeRequest: value =", internals2_generic::fromInternalString(value));
-      //////
+      if (due && advanceHandshake(pending)) 
+      {
+        if (pending.awaitingToken)
+          _handshakesAwaitingToken--;
+          
+        if (i + 1 < _pending.size())
+          _pending[i] = std::move(_pending.back());
+          
+        _pending.pop_back();
+      }
+      else 
+      {
+        i++;
+      }
+    }
+  }
   
-      line = client.readLine();
-    } while (client.available() && line != "\r\n");
+  void WebsocketsServer::stopAccepting() 
+  {
+    this->_server->close();
+    _acceptDeferred = false;
+    _handshakesAwaitingToken = 0;
+    _handshakesExpired = 0;
+    _startedSockets.clear();
     
+    for (PendingHandshake& pending : _pending) 
+    {
+      if (!pending.client->available()) 
+        continue;
+        
+      WSTRACE(TraceEvent_HandshakeRejected, pending.client.get(), TraceReject_Draining, 0, 503);
       
-    return result;
+      shedConnection(*pending.client);
+    }
+    
+    _pending.clear();
   }
   
-  WebsocketsClient WebsocketsServer::accept() 
-  {           
-    std::shared_ptr<network2_generic::TcpClient> tcpClient(_server->accept());
+  size_t WebsocketsServer::drain(const uint32_t timeoutMs) 
+  {
+    stopAccepting();
     
-    // KH add v1.0.6
-    if (!tcpClient)
+    // answered with 101 already, so they get a close frame too
+    std::vector<WebsocketsClient> unclaimed;
+    
+    while (!_ready.empty()) 
     {
-      return {};
+      WebsocketsClient client = acceptReady();
+      
+      if (client.available()) 
+        unclaimed.push_back(client);
     }
-    //////
-       
-    if (tcpClient->available() == false)
+    
+    // every peer gets its close frame before we wait for any of them
+    for (WebsocketsClient& client : unclaimed)
+      client.beginClose(CloseReason_GoingAway);
+      
+    for (size_t i = 0; i < _active.size(); i++)
+      _slots[_active[i]].client.beginClose(CloseReason_GoingAway);
+      
+    // one submission for all of them on transports that queue sends
+    flush();
+    
+    bool expired = false;
+    WebsocketsTimer deadline([&expired]() { expired = true; });
+    
+    _timers.arm(deadline, timeoutMs);
+    
+    size_t open = 0;
+    
+    while (true) 
     {
-      // KH
-      LOGDEBUG("WebsocketsServer::accept: tcpClient not available");
-      //////
-      return {};
+      open = 0;
+      
+      // the connection slept on until the next round, one held back by its inbound limits only wakes
+      // up with its budget
+      WebsocketsClient* waiting = nullptr;
+      uint32_t throttledMs = 0;
+      bool sending = false;
+      
+      auto track = [&waiting, &throttledMs](WebsocketsClient& client) 
+      {
+        const uint32_t waitMs = client.inboundWaitTime();
+        
+        if (waitMs == 0) 
+        {
+          if (!waiting)
+            waiting = &client;
+        }
+        else if (throttledMs == 0 || waitMs < throttledMs) 
+        {
+          throttledMs = waitMs;
+        }
+      };
+      
+      // an answered close frame closes the client while it is polled
+      for (WebsocketsClient& client : unclaimed) 
+      {
+        client.poll();
+        
+        if (client.available()) 
+        {
+          open++;
+          track(client);
+        }
+      }
+      
+      for (size_t i = 0; i < _active.size(); ) 
+      {
+        const uint16_t index = _active[i];
+        
+        // the close frame may still be queued behind a full socket
+        sending |= !_slots[index].client.flushSend();
+        _slots[index].client.poll();
+        
+        if (_slots[index].client.available()) 
+        {
+          open++;
+          track(_slots[index].client);
+          i++;
+        }
+        else 
+        {
+          releaseSlot(index);
+        }
+      }
+      
+      if (open == 0)
+        break;
+        
+      _timers.advance();
+      
+      if (expired)
+        break;
+        
+      // Every connection has to answer anyway, so sleeping on one of them is never too long. Woken up by
+      // its data, the deadline or any other timer of the wheel
+      int waitMs = _timers.timeUntilNext();
+      
+      if (throttledMs > 0 && (waitMs < 0 || throttledMs < static_cast<uint32_t>(waitMs)))
+        waitMs = static_cast<int>(throttledMs);
+        
+      // nothing tells when a full socket has room again, so those are retried every millisecond
+      if (sending && (waitMs < 0 || waitMs > 1))
+        waitMs = 1;
+        
+      if (waiting)
+        waiting->_client->waitReadableFor(waitMs);
+      else
+        delay(waitMs);
     }
+    
+    if (open > 0) 
+    {
+      LOGWARN1("WebsocketsServer::drain: no close frame from the peer in time, connections =", open);
+    }
+    
+    for (WebsocketsClient& client : unclaimed)
+      client.close(CloseReason_GoingAway);
+      
+    while (!_active.empty()) 
+    {
+      const uint16_t index = _active.back();
+      
+      _slots[index].client.close(CloseReason_GoingAway);
+      releaseSlot(index);
+    }
+    
+    return open;
+  }
   
-    auto params = recvHandshakeRequest(*tcpClient);
+  void WebsocketsServer::expireHandshake(network2_generic::TcpClient* client) 
+  {
+    for (PendingHandshake& pending : _pending) 
+    {
+      if (pending.client.get() != client)
+        continue;
+        
+      if (pending.request.find("\r\n\r\n") == WSString::npos) 
+      {
+        WSTRACE(TraceEvent_HandshakeRejected, client, TraceReject_Timeout, 0, 0);
+        
+        LOGWARN1("WebsocketsServer::pollHandshakes: handshake timed out, bytes =", pending.request.size());
+        rejectHandshake(*client, "408 Request Timeout");
+      }
+      else 
+      {
+        WSTRACE(TraceEvent_HandshakeRejected, client, TraceReject_Overload, 0, 503);
+        
+        LOGWARN("WebsocketsServer::pollHandshakes: no handshake token in time");
+        shedConnection(*client);
+      }
+      
+      // leaves the table with the next pollHandshakes(), this runs from its own deadline
+      _handshakesExpired++;
+      
+      return;
+    }
+  }
+  
+  bool WebsocketsServer::advanceHandshake(PendingHandshake& pending) 
+  {
+    network2_generic::TcpClient& client = *pending.client;
+    
+    if (!client.available()) 
+      return true;
+      
+    uint8_t buffer[WS_LINE_READER_BUFFER_SIZE];
+    
+    // Never more than the cap plus one block, whatever the peer keeps sending
+    while (pending.request.size() <= WS_SERVER_MAX_HANDSHAKE_SIZE && client.poll()) 
+    {
+      uint32_t count = client.read(buffer, sizeof(buffer));
+      
+      // (uint32_t) -1: nothing there after all
+      if (count == 0 || count > sizeof(buffer)) 
+        break;
+        
+      pending.request.append(reinterpret_cast<const char*>(buffer), count);
+    }
+    
+    const size_t end = pending.request.find("\r\n\r\n");
+    
+    if (end == WSString::npos) 
+    {
+      if (!client.available()) 
+        return true;
+        
+      if (pending.request.size() > WS_SERVER_MAX_HANDSHAKE_SIZE) 
+      {
+        WSTRACE(TraceEvent_HandshakeRejected, &client, TraceReject_TooLarge, 0, 0);
+        
+        LOGWARN1("WebsocketsServer::pollHandshakes: handshake request too large, bytes =", pending.request.size());
+        rejectHandshake(client, "431 Request Header Fields Too Large");
+        return true;
+      }
+      
+      return false;
+    }
+    
+    // Over the handshake rate: stays buffered until a token comes, but not beyond its deadline
+    if (!_handshakeBucket.take(millis())) 
+    {
+      if (!pending.awaitingToken) 
+      {
+        pending.awaitingToken = true;
+        _handshakesAwaitingToken++;
+      }
+      
+      return false;
+    }
+    
+    if (pending.awaitingToken) 
+    {
+      pending.awaitingToken = false;
+      _handshakesAwaitingToken--;
+    }
+    
+    // Views into pending.request, which stays put until the response is out
+    internals2_generic::HttpHeaderParser request;
+    const bool parsed = request.parse(pending.request.data(), end + 4, TraceEvent_HandshakeRequestHeader, &client);
+    const size_t headerCount = request.headerCount();
+    
+    if (!parsed) 
+    {
+      WSTRACE(TraceEvent_HandshakeRejected, &client, TraceReject_Malformed, headerCount, 0);
+      
+      LOGWARN("WebsocketsServer::pollHandshakes: malformed header line");
+      rejectHandshake(client, "400 Bad Request");
+      return true;
+    }
   
-    if (params.headers["Connection"].find("Upgrade") == std::string::npos) 
+    if (!request.get(internals2_generic::HttpHeader_Connection).hasToken("Upgrade")) 
     {
+      WSTRACE(TraceEvent_HandshakeRejected, &client, TraceReject_Connection, headerCount, 0);
+      
       // KH
-      LOGWARN("WebsocketsServer::accept: Connection != Upgrade");
+      LOGWARN("WebsocketsServer::pollHandshakes: Connection != Upgrade");
       //////
-      return {};
+      rejectHandshake(client, "400 Bad Request");
+      return true;
     }
       
-    if (params.headers["Upgrade"] != "websocket")
+    if (!request.get(internals2_generic::HttpHeader_Upgrade).equalsIgnoreCase("websocket"))
     {
+      WSTRACE(TraceEvent_HandshakeRejected, &client, TraceReject_Upgrade, headerCount, 0);
+      
       // KH
-      LOGWARN("WebsocketsServer::accept: Upgrade != websocket");
+      LOGWARN("WebsocketsServer::pollHandshakes: Upgrade != websocket");
       //////
-      return {};
+      rejectHandshake(client, "400 Bad Request");
+      return true;
     }
       
-    if (params.headers["Sec-WebSocket-Version"] != "13")
+    if (!request.get(internals2_generic::HttpHeader_Version).equals("13", 2))
     { 
+      WSTRACE(TraceEvent_HandshakeRejected, &client, TraceReject_Version, headerCount, 0);
+      
       // KH
-      LOGWARN("WebsocketsServer::accept: Version != 13");
+      LOGWARN("WebsocketsServer::pollHandshakes: Version != 13");
       //////
-      return {};
+      rejectHandshake(client, "426 Upgrade Required", "Sec-WebSocket-Version: 13\r\n");
+      return true;
     }
       
-    if (params.headers["Sec-WebSocket-Key"] == "") 
+    if (request.get(internals2_generic::HttpHeader_Key).empty()) 
     {
+      WSTRACE(TraceEvent_HandshakeRejected, &client, TraceReject_Key, headerCount, 0);
+      
       // KH
-      LOGWARN("WebsocketsServer::accept: Key == NULL");
+      LOGWARN("WebsocketsServer::pollHandshakes: Key == NULL");
       //////
-      return {};
+      rejectHandshake(client, "400 Bad Request");
+      return true;
+    }
+  
+    // The connection table is full, pollAll() couldn't take this one
+    if (!_slots.empty() && _active.size() + _ready.size() >= _slots.size()) 
+    {
+      WSTRACE(TraceEvent_HandshakeRejected, &client, TraceReject_Capacity, headerCount, 0);
+      
+      LOGWARN1("WebsocketsServer::pollHandshakes: connection table full, connections =", _active.size());
+      shedConnection(client);
+      return true;
     }
   
-    auto serverAccept = crypto2_generic::websocketsHandshakeEncodeKey(
-                          params.headers["Sec-WebSocket-Key"]
-                        );
+    if (_handshakeCallback) 
+    {
+      HandshakeRequest admission = 
+      {
+        { nullptr, 0 }, { nullptr, 0 },
+        request.get(internals2_generic::HttpHeader_Authorization),
+        request.get(internals2_generic::HttpHeader_Origin),
+        request
+      };
+      
+      splitRequestTarget(request.startLine(), admission.path, admission.query);
+      
+      const HandshakeDecision decision = _handshakeCallback(admission);
+      
+      if (decision != HandshakeDecision_Accept) 
+      {
+        int status = 503;
+        const char* statusLine = "503 Service Unavailable";
+        const char* extraHeaders = "";
+        
+        if (decision == HandshakeDecision_Unauthorized) 
+        {
+          status = 401;
+          statusLine = "401 Unauthorized";
+          extraHeaders = "WWW-Authenticate: Basic realm=\"" WS_SERVER_AUTH_REALM "\"\r\n";
+        }
+        else if (decision == HandshakeDecision_Forbidden) 
+        {
+          status = 403;
+          statusLine = "403 Forbidden";
+        }
+        
+        WSTRACE(TraceEvent_HandshakeRejected, &client, TraceReject_Application, headerCount, status);
+        
+        LOGINFO1("WebsocketsServer::pollHandshakes: refused by onHandshake, status =", status);
+        rejectHandshake(client, statusLine, extraHeaders);
+        return true;
+      }
+    }
   
-    tcpClient->send("HTTP/1.1 101 Switching Protocols\r\n");
-    tcpClient->send("Connection: Upgrade\r\n");
-    tcpClient->send("Upgrade: websocket\r\n");
-    tcpClient->send("Sec-WebSocket-Version: 13\r\n");
-    tcpClient->send("Sec-WebSocket-Accept: " + serverAccept + "\r\n");
-    tcpClient->send("\r\n");
+    const WSString serverAccept = crypto2_generic::websocketsHandshakeEncodeKey(
+                                    request.get(internals2_generic::HttpHeader_Key).toString()
+                                  );
+                                  
+    _ready.push_back(ReadyConnection());
+    
+    ReadyConnection& ready = _ready.back();
+    
+    // A client should wait for our 101 before sending frames (RFC 6455 4.1), those pipelined behind the
+    // request anyway are the endpoint's to read
+    if (end + 4 < pending.request.size())
+      ready.received.assign(pending.request, end + 4, WSString::npos);
+    
+    // The request is no longer needed, don't keep it around until the entry is gone
+    WSString().swap(pending.request);
+    
+    sendHandshakeResponse(client, serverAccept);
+    
+    WSTRACE(TraceEvent_HandshakeAccepted, &client, 0, headerCount, 0);
+    
+    ready.client = std::move(pending.client);
+    
+    return true;
+  }
+  
+  WebsocketsClient WebsocketsServer::accept() 
+  {
+    if (_ready.empty() && _pending.empty()) 
+    {
+      if (!this->_server->available())
+        return {};
+        
+      // Blocks in the stack until a peer connects
+      std::shared_ptr<network2_generic::TcpClient> tcpClient(_server->accept());
+      
+      // KH add v1.0.6
+      if (!tcpClient)
+        return {};
+      //////
+      
+      if (tcpClient->available() == false)
+      {
+        // KH
+        LOGDEBUG("WebsocketsServer::accept: tcpClient not available");
+        //////
+        return {};
+      }
+      
+      beginHandshake(tcpClient);
+    }
+    
+    // Sleeps on one of the handshakes in progress, but never past a deadline or the next handshake token
+    while (_ready.empty() && !_pending.empty()) 
+    {
+      std::shared_ptr<network2_generic::TcpClient> waiting = _pending.front().client;
+      
+      if (pollHandshakes())
+        break;
+        
+      if (!handshakePending(waiting.get()))
+        return {};
+        
+      int waitMs = _timers.timeUntilNext();
+      const uint32_t tokenMs = _handshakeBucket.waitTime(millis());
+      
+      if (tokenMs > 0 && (waitMs < 0 || tokenMs < static_cast<uint32_t>(waitMs)))
+        waitMs = static_cast<int>(tokenMs);
+        
+      waiting->waitReadableFor(waitMs);
+    }
+    
+    return acceptReady();
+  }
+  
+  WebsocketsClient WebsocketsServer::acceptReady() 
+  {
+    if (_ready.empty()) 
+      return {};
+      
+    std::shared_ptr<network2_generic::TcpClient> tcpClient = std::move(_ready.front().client);
+    WSString received = std::move(_ready.front().received);
+    
+    _ready.erase(_ready.begin());
+    
+    // The peer may have gone away while waiting to be accepted
+    if (!tcpClient->available()) 
+      return {};
+    
+    WSTRACE(TraceEvent_ConnectionOpened, tcpClient.get(), 1, 0, 0);
   
     WebsocketsClient wsClient(tcpClient);
     // Don't use masking from server to client (according to RFC)
     wsClient.setUseMasking(false);
+    
+    if (_inboundLimits.messagesPerSecond != 0 || _inboundLimits.bytesPerSecond != 0)
+      wsClient.setInboundLimits(_inboundLimits);
+    
+  #if _WEBSOCKETS_LATENCY_STATS_
+    wsClient._serverLatencyStats = _latencyStats;
+  #endif
+  
+    if (!received.empty())
+      wsClient._endpoint.pushReceived(received);
+  
     return wsClient;
   }
   
+  bool WebsocketsServer::setMaxConnections(const size_t capacity) 
+  {
+    // slot numbers are 16 bits of the id
+    if (!_active.empty() || !_ready.empty() || capacity == 0 || capacity > 0xFFFF) 
+      return false;
+      
+    _maxConnections = capacity;
+    
+    _slots.clear();
+    _freeSlots.clear();
+    
+    return true;
+  }
+  
+  void WebsocketsServer::onConnection(const ConnectionCallback callback) 
+  {
+    this->_connectionCallback = callback;
+  }
+  
+  void WebsocketsServer::onDisconnection(const ConnectionCallback callback) 
+  {
+    this->_disconnectionCallback = callback;
+  }
+  
+  size_t WebsocketsServer::pollAll() 
+  {
+    if (_slots.empty()) 
+    {
+      _slots.resize(_maxConnections);
+      _active.reserve(_maxConnections);
+      _freeSlots.reserve(_maxConnections);
+      
+      // handed out from the back, lowest slot first
+      for (size_t i = _maxConnections; i > 0; i--)
+        _freeSlots.push_back(static_cast<uint16_t>(i - 1));
+    }
+    
+    pollHandshakes();
+    
+    while (!_ready.empty() && !_freeSlots.empty()) 
+    {
+      WebsocketsClient client = acceptReady();
+      
+      if (!client.available()) 
+        continue;
+        
+      const uint16_t index = _freeSlots.back();
+      _freeSlots.pop_back();
+      
+      // never 0, so no id is ever 0
+      if (++_generation == 0)
+        _generation = 1;
+        
+      ConnectionSlot& slot = _slots[index];
+      
+      slot.client       = client;
+      slot.id           = (static_cast<ConnectionId>(_generation) << 16) | index;
+      slot.position     = static_cast<uint16_t>(_active.size());
+      slot.lastActivity = _timers.now();
+      slot.userData     = nullptr;
+      slot.pingSentAt   = 0;
+      
+      // one peer that stops reading must not hold up the whole table
+      slot.client.setSendQueueLimit(WS_SERVER_SEND_QUEUE_LIMIT);
+      
+      if (_idleTimeoutMs > 0) 
+      {
+        slot.idleTimer.setCallback([this, index]() { expireIdle(index); });
+        _timers.arm(slot.idleTimer, _idleTimeoutMs);
+      }
+      
+      if (_heartbeatMs > 0) 
+      {
+        slot.heartbeatTimer.setCallback([this, index]() { heartbeat(index); });
+        _timers.arm(slot.heartbeatTimer, _heartbeatMs);
+      }
+      
+      _active.push_back(index);
+      
+      if (_connectionCallback)
+        _connectionCallback(slot.client, slot.id);
+    }
+    
+    size_t totalFrames = 0;
+    const uint64_t now = _timers.now();
+    
+    // releasing moves the last connection into the current position, which hasn't been polled yet
+    for (size_t i = 0; i < _active.size(); ) 
+    {
+      const uint16_t index = _active[i];
+      ConnectionSlot& slot = _slots[index];
+      size_t numFrames = 0;
+      
+      slot.client.flushSend();
+      slot.client.pollFrames(WS_SERVER_POLL_BUDGET, numFrames);
+      totalFrames += numFrames;
+      
+      // idle connections were closed by their timer in pollHandshakes()
+      if (numFrames > 0)
+        slot.lastActivity = now;
+        
+      // beginClose() from a callback or from the application, the wait for the answer is bounded from here
+      if (_closeTimeoutMs > 0 && !slot.closeTimer.armed() && slot.client.closing()) 
+      {
+        slot.closeTimer.setCallback([this, index]() { expireClose(index); });
+        _timers.arm(slot.closeTimer, _closeTimeoutMs);
+      }
+        
+      if (slot.client.available())
+        i++;
+      else
+        releaseSlot(index);
+    }
+    
+    return totalFrames;
+  }
+  
+  void WebsocketsServer::releaseSlot(const uint16_t index) 
+  {
+    ConnectionSlot& slot = _slots[index];
+    
+    if (_disconnectionCallback)
+      _disconnectionCallback(slot.client, slot.id);
+      
+    slot.idleTimer.cancel();
+    slot.heartbeatTimer.cancel();
+    slot.closeTimer.cancel();
+      
+    const uint16_t last = _active.back();
+    
+    _active[slot.position] = last;
+    _slots[last].position  = slot.position;
+    _active.pop_back();
+    
+    // The closed client stays in the slot until it is reused, that saves a default client per release
+    slot.id       = 0;
+    slot.userData = nullptr;
+    
+    _freeSlots.push_back(index);
+  }
+  
+  // Fires at most once per timeout even on a busy connection: the activity since it was armed pushes it
+  // back instead
+  void WebsocketsServer::expireIdle(const uint16_t index) 
+  {
+    ConnectionSlot& slot = _slots[index];
+    
+    if (slot.id == 0 || !slot.client.available())
+      return;
+      
+    const uint64_t idle = _timers.now() - slot.lastActivity;
+    
+    if (idle < _idleTimeoutMs) 
+    {
+      _timers.arm(slot.idleTimer, static_cast<uint32_t>(_idleTimeoutMs - idle));
+      return;
+    }
+    
+    LOGINFO1("WebsocketsServer::pollAll: evicting idle connection, id =", slot.id);
+    slot.client.close(CloseReason_GoingAway);
+  }
+  
+  void WebsocketsServer::setIdleTimeout(const uint32_t timeoutMs) 
+  {
+    _idleTimeoutMs = timeoutMs;
+    
+    // connections already in the table count from now
+    for (size_t i = 0; i < _active.size(); i++) 
+    {
+      const uint16_t index = _active[i];
+      ConnectionSlot& slot = _slots[index];
+      
+      if (timeoutMs == 0) 
+      {
+        slot.idleTimer.cancel();
+        continue;
+      }
+      
+      slot.lastActivity = _timers.now();
+      slot.idleTimer.setCallback([this, index]() { expireIdle(index); });
+      _timers.arm(slot.idleTimer, timeoutMs);
+    }
+  }
+  
+  // Lazy like expireIdle(): frames and pongs only move lastActivity, the timer finds out when it fires
+  void WebsocketsServer::heartbeat(const uint16_t index) 
+  {
+    ConnectionSlot& slot = _slots[index];
+    
+    if (slot.id == 0 || !slot.client.available() || slot.client.closing())
+      return;
+      
+    const uint64_t now = _timers.now();
+    
+    // anything read since the ping answers it
+    if (slot.pingSentAt != 0 && slot.lastActivity < slot.pingSentAt) 
+    {
+      const uint64_t waited = now - slot.pingSentAt;
+      
+      if (waited < _heartbeatTimeoutMs) 
+      {
+        _timers.arm(slot.heartbeatTimer, static_cast<uint32_t>(_heartbeatTimeoutMs - waited));
+        return;
+      }
+      
+      LOGINFO1("WebsocketsServer::pollAll: no answer to the heartbeat, id =", slot.id);
+      slot.client.close(CloseReason_GoingAway);
+      return;
+    }
+    
+    slot.pingSentAt = 0;
+    
+    const uint64_t idle = now - slot.lastActivity;
+    
+    if (idle < _heartbeatMs) 
+    {
+      _timers.arm(slot.heartbeatTimer, static_cast<uint32_t>(_heartbeatMs - idle));
+      return;
+    }
+    
+    slot.client.ping();
+    slot.pingSentAt = now;
+    
+    _timers.arm(slot.heartbeatTimer, _heartbeatTimeoutMs);
+  }
+  
+  void WebsocketsServer::setHeartbeat(const uint32_t intervalMs, const uint32_t timeoutMs) 
+  {
+    _heartbeatMs        = intervalMs;
+    _heartbeatTimeoutMs = timeoutMs ? timeoutMs : intervalMs;
+    
+    // connections already in the table count from now
+    for (size_t i = 0; i < _active.size(); i++) 
+    {
+      const uint16_t index = _active[i];
+      ConnectionSlot& slot = _slots[index];
+      
+      slot.pingSentAt = 0;
+      
+      if (intervalMs == 0) 
+      {
+        slot.heartbeatTimer.cancel();
+        continue;
+      }
+      
+      slot.lastActivity = _timers.now();
+      slot.heartbeatTimer.setCallback([this, index]() { heartbeat(index); });
+      _timers.arm(slot.heartbeatTimer, intervalMs);
+    }
+  }
+  
+  // The peer never answered our close frame, the socket goes without waiting any longer
+  void WebsocketsServer::expireClose(const uint16_t index) 
+  {
+    ConnectionSlot& slot = _slots[index];
+    
+    if (slot.id == 0 || !slot.client.available())
+      return;
+      
+    LOGINFO1("WebsocketsServer::pollAll: no close frame from the peer in time, id =", slot.id);
+    slot.client.close(CloseReason_AbnormalClosure);
+  }
+  
+  void WebsocketsServer::setCloseTimeout(const uint32_t timeoutMs) 
+  {
+    _closeTimeoutMs = timeoutMs;
+    
+    // those waiting already keep their deadline
+    if (timeoutMs > 0)
+      return;
+      
+    for (size_t i = 0; i < _active.size(); i++)
+      _slots[_active[i]].closeTimer.cancel();
+  }
+  
+  WebsocketsServer::ConnectionSlot* WebsocketsServer::findSlot(const ConnectionId id) const 
+  {
+    const size_t index = id & 0xFFFF;
+    
+    if (id == 0 || index >= _slots.size() || _slots[index].id != id)
+      return nullptr;
+      
+    return const_cast<ConnectionSlot*>(&_slots[index]);
+  }
+  
+  WebsocketsClient* WebsocketsServer::getConnection(const ConnectionId id) 
+  {
+    ConnectionSlot* slot = findSlot(id);
+    
+    return slot ? &slot->client : nullptr;
+  }
+  
+  WebsocketsServer::ConnectionId WebsocketsServer::getConnectionId(const WebsocketsClient& client) const 
+  {
+    if (_slots.empty())
+      return 0;
+      
+    // Slots are contiguous, so the client's address tells its slot
+    const char* first = reinterpret_cast<const char*>(&_slots[0].client);
+    const char* address = reinterpret_cast<const char*>(&client);
+    
+    if (address < first)
+      return 0;
+      
+    const size_t index = static_cast<size_t>(address - first) / sizeof(ConnectionSlot);
+    
+    if (index >= _slots.size() || &_slots[index].client != &client)
+      return 0;
+      
+    return _slots[index].id;
+  }
+  
+  bool WebsocketsServer::setUserData(const ConnectionId id, void* userData) 
+  {
+    ConnectionSlot* slot = findSlot(id);
+    
+    if (!slot)
+      return false;
+      
+    slot->userData = userData;
+    
+    return true;
+  }
+  
+  void* WebsocketsServer::getUserData(const ConnectionId id) const 
+  {
+    ConnectionSlot* slot = findSlot(id);
+    
+    return slot ? slot->userData : nullptr;
+  }
+  
+  void WebsocketsServer::forEachConnection(const ConnectionCallback callback) 
+  {
+    for (size_t i = 0; i < _active.size(); i++) 
+    {
+      ConnectionSlot& slot = _slots[_active[i]];
+      
+      callback(slot.client, slot.id);
+    }
+  }
+  
   WebsocketsServer::~WebsocketsServer() 
   {
     this->_server->close();
@@ -0,0 +1,308 @@
+/****************************************************************************************************************************
+  WebSockets2_Generic_ShardedServer.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+#ifndef _WEBSOCKETS2_GENERIC_SHARDED_SERVER_H
+#define _WEBSOCKETS2_GENERIC_SHARDED_SERVER_H
+
+#pragma once
+
+#ifdef __linux__
+
+// KH
+#include <WebSockets2_Generic.h>
+#include "WebSockets2_Generic_Debug.h"
+
+#include <Tiny_Websockets_Generic/sharded_server.hpp>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace websockets2_generic
+{
+  WebsocketsShardedServer::WebsocketsShardedServer(const size_t numShards) :
+    _numShards(numShards > 0 ? numShards : std::thread::hardware_concurrency()),
+    _running(false),
+    _connectionCallback([](WebsocketsClient&, size_t) {}),
+    _sendQueueLimit(WS_HUB_SEND_QUEUE_LIMIT),
+    _drainOnStop(false),
+    _drainTimeoutMs(0)
+  {
+    if (_numShards == 0)
+      _numShards = 1;
+  }
+  
+  void WebsocketsShardedServer::onConnection(const ShardConnectionCallback callback)
+  {
+    this->_connectionCallback = callback;
+  }
+  
+  void WebsocketsShardedServer::setSendQueueLimit(const uint32_t limit)
+  {
+    _sendQueueLimit = limit;
+  }
+  
+  WebsocketsShardedServer::Shard::~Shard()
+  {
+    if (wakeFd >= 0)
+      ::close(wakeFd);
+  }
+  
+  bool WebsocketsShardedServer::listen(const uint16_t port)
+  {
+    if (_running)
+      return false;
+  
+    joinRetired();
+    
+    // published only once all of them started, a failure closes the ones before it too
+    std::vector<std::unique_ptr<Shard>> shards;
+    
+    for (size_t i = 0; i < _numShards; i++)
+    {
+      std::unique_ptr<Shard> shard(new Shard());
+      
+      shard->index      = i;
+      shard->tcpServer  = std::unique_ptr<network2_generic::LinuxTcpServer>(
+                            new network2_generic::LinuxTcpServer(WS_SHARD_BACKLOG_SIZE, true));
+      shard->server     = std::unique_ptr<WebsocketsServer>(new WebsocketsServer(shard->tcpServer.get()));
+      shard->wakeFd     = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  
+      shard->server->listen(port);
+  
+      if (!shard->server->available() || shard->wakeFd < 0 || !shard->hub.available())
+      {
+        LOGERROR1("WebsocketsShardedServer::listen: failed to start shard", i);
+        
+        return false;
+      }
+  
+      Shard* rawShard = shard.get();
+      
+      shard->hub.setSendQueueLimit(_sendQueueLimit);
+      shard->hub.attach(*shard->server);
+      shard->hub.watch(shard->wakeFd, [this, rawShard](uint32_t) { drainQueue(*rawShard); });
+      shard->hub.onConnection([this, rawShard](WebsocketsClient& client)
+      {
+        _connectionCallback(client, rawShard->index);
+      });
+  
+      shards.push_back(std::move(shard));
+    }
+  
+    _drainOnStop = false;
+    _running = true;
+  
+    std::lock_guard<std::mutex> guard(_shardsLock);
+    
+    _shards.swap(shards);
+    
+    for (auto& shard : _shards)
+    {
+      Shard* rawShard = shard.get();
+      shard->thread = std::thread([this, rawShard]() { run(*rawShard); });
+    }
+  
+    return true;
+  }
+  
+  bool WebsocketsShardedServer::available() const
+  {
+    return _running;
+  }
+  
+  void WebsocketsShardedServer::run(Shard& shard)
+  {
+    while (_running)
+    {
+      shard.hub.poll(-1);
+      shard.numClients = shard.hub.size();
+    }
+    
+    if (_drainOnStop)
+    {
+      shard.hub.drain(_drainTimeoutMs);
+      shard.numClients = shard.hub.size();
+    }
+  }
+  
+  void WebsocketsShardedServer::drainQueue(Shard& shard)
+  {
+    uint64_t counter;
+    
+    if (::read(shard.wakeFd, &counter, sizeof(counter)) != sizeof(counter))
+      return;
+  
+    std::vector<std::shared_ptr<const Broadcast>> pending;
+    {
+      std::lock_guard<std::mutex> guard(shard.queueLock);
+      pending.swap(shard.queue);
+    }
+  
+    // The hub's sends never wait: what a slow consumer's socket doesn't take is queued, and the consumer
+    // is closed once it is more than _sendQueueLimit behind, so the rest of the shard keeps going
+    for (const auto& message : pending)
+    {
+      shard.hub.forEach([&message](WebsocketsClient& client)
+      {
+        if (message->binary)
+          client.sendBinary(message->data.c_str(), message->data.size());
+        else
+          client.send(message->data.c_str(), message->data.size());
+      });
+    }
+  }
+  
+  void WebsocketsShardedServer::broadcast(const WSString& data, const bool binary)
+  {
+    std::shared_ptr<const Broadcast> message(new Broadcast { data, binary });
+    const uint64_t one = 1;
+    
+    // held while writing to the eventfds, stop() can't close them under us
+    std::lock_guard<std::mutex> guard(_shardsLock);
+  
+    for (auto& shard : _shards)
+    {
+      {
+        std::lock_guard<std::mutex> guard(shard->queueLock);
+        shard->queue.push_back(message);
+      }
+      
+      if (::write(shard->wakeFd, &one, sizeof(one)) != sizeof(one))
+      {
+        LOGWARN1("WebsocketsShardedServer::broadcast: failed to wake shard", shard->index);
+      }
+    }
+  }
+  
+  size_t WebsocketsShardedServer::shards() const
+  {
+    return _numShards;
+  }
+  
+  size_t WebsocketsShardedServer::size() const
+  {
+    size_t total = 0;
+    
+    std::lock_guard<std::mutex> guard(_shardsLock);
+  
+    for (const auto& shard : _shards)
+    {
+      total += shard->numClients;
+    }
+  
+    return total;
+  }
+  
+  void WebsocketsShardedServer::stop()
+  {
+    if (!_running.exchange(false))
+      return;
+  
+    // Taken out under the lock, but joined without it: a worker may be in broadcast() right now
+    std::vector<std::unique_ptr<Shard>> shards;
+    {
+      std::lock_guard<std::mutex> guard(_shardsLock);
+      shards.swap(_shards);
+    }
+    
+    const uint64_t one = 1;
+  
+    // wake every worker so it notices _running == false
+    for (auto& shard : shards)
+    {
+      if (::write(shard->wakeFd, &one, sizeof(one)) != sizeof(one))
+      {
+        LOGWARN1("WebsocketsShardedServer::stop: failed to wake shard", shard->index);
+      }
+    }
+  
+    for (auto& shard : shards)
+    {
+      // joining ourselves would fail with EDEADLK, this worker leaves run() once the callback returns
+      if (shard->thread.get_id() == std::this_thread::get_id())
+      {
+        std::lock_guard<std::mutex> guard(_shardsLock);
+        _retired.push_back(std::move(shard));
+        
+        continue;
+      }
+      
+      if (shard->thread.joinable())
+        shard->thread.join();
+  
+      shard->hub.unwatch(shard->wakeFd);
+    }
+  }
+  
+  void WebsocketsShardedServer::joinRetired()
+  {
+    std::vector<std::unique_ptr<Shard>> retired;
+    {
+      std::lock_guard<std::mutex> guard(_shardsLock);
+      retired.swap(_retired);
+    }
+    
+    for (auto& shard : retired)
+    {
+      // listen() again from the retired worker itself, it is still on its way out
+      if (shard->thread.get_id() == std::this_thread::get_id())
+      {
+        std::lock_guard<std::mutex> guard(_shardsLock);
+        _retired.push_back(std::move(shard));
+        
+        continue;
+      }
+      
+      if (shard->thread.joinable())
+        shard->thread.join();
+        
+      shard->hub.unwatch(shard->wakeFd);
+    }
+  }
+  
+  void WebsocketsShardedServer::drain(const uint32_t timeoutMs)
+  {
+    _drainOnStop    = true;
+    _drainTimeoutMs = timeoutMs;
+    
+    stop();
+  }
+  
+  WebsocketsShardedServer::~WebsocketsShardedServer()
+  {
+    stop();
+    joinRetired();
+  }
+}     // namespace websockets2_generic
+
+#endif    // #ifdef __linux__
+
+#endif    // _WEBSOCKETS2_GENERIC_SHARDED_SERVER_H
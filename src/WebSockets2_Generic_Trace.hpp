@@ -0,0 +1,214 @@
+/****************************************************************************************************************************
+  WebSockets2_Generic_Trace.hpp
+  For WebSockets2_Generic Library
+  
+  Based on and modified from Gil Maimon's ArduinoWebsockets library https://github.com/gilmaimon/ArduinoWebsockets
+  to support STM32F/L/H/G/WB/MP1, nRF52, SAMD21/SAMD51, SAM DUE, Teensy boards besides ESP8266 and ESP32
+
+  The library provides simple and easy interface for websockets (Client and Server).
+  
+  Built by Khoi Hoang https://github.com/khoih-prog/Websockets2_Generic
+  Licensed under MIT license
+  Version: 1.2.3
+
+  Version Modified By   Date      Comments
+  ------- -----------  ---------- -----------
+  1.0.0   K Hoang      14/07/2020 Initial coding/porting to support nRF52 and SAMD21/SAMD51 boards. Add SINRIC/Alexa support
+  1.0.1   K Hoang      16/07/2020 Add support to Ethernet W5x00 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.2   K Hoang      18/07/2020 Add support to Ethernet ENC28J60 to nRF52, SAMD21/SAMD51 and SAM DUE boards
+  1.0.3   K Hoang      18/07/2020 Add support to STM32F boards using Ethernet W5x00, ENC28J60 and LAN8742A 
+  1.0.4   K Hoang      27/07/2020 Add support to STM32F/L/H/G/WB/MP1 and Seeeduino SAMD21/SAMD51 using 
+                                  Ethernet W5x00, ENC28J60, LAN8742A and WiFiNINA. Add examples and Packages' Patches.
+  1.0.5   K Hoang      29/07/2020 Sync with ArduinoWebsockets v0.4.18 to fix ESP8266 SSL bug.
+  1.0.6   K Hoang      06/08/2020 Add non-blocking WebSocketsServer feature and non-blocking examples.       
+  1.0.7   K Hoang      03/10/2020 Add support to Ethernet ENC28J60 using EthernetENC and UIPEthernet v2.0.9
+  1.1.0   K Hoang      08/12/2020 Add support to Teensy 4.1 using NativeEthernet  
+  1.2.0   K Hoang      16/04/2021 Add limited support (client only) to ESP32-S2 and LAN8720 for STM32F4/F7
+  1.2.1   K Hoang      16/04/2021 Add support to new ESP32-S2 boards. Restore Websocket Server function for ESP32-S2.
+  1.2.2   K Hoang      16/04/2021 Add support to ESP32-C3
+  1.2.3   K Hoang      02/05/2021 Update CA Certs and Fingerprint for EP32 and ESP8266 secured exampled.
+ *****************************************************************************************************************************/
+
+#ifndef _WEBSOCKETS2_GENERIC_TRACE_H
+#define _WEBSOCKETS2_GENERIC_TRACE_H
+
+#pragma once
+
+#include <Tiny_Websockets_Generic/internals/ws_trace.hpp>
+#include <Tiny_Websockets_Generic/internals/http_header_parser.hpp>
+
+#include <stdio.h>
+
+namespace websockets2_generic
+{
+  namespace internals2_generic
+  {
+  #if (_WEBSOCKETS_TRACE_MASK_ != 0)
+    TraceRing traceRing;
+  #endif
+  
+    static_assert(static_cast<int>(TraceHeader_UserAgent) == static_cast<int>(HttpHeader_UserAgent), 
+                  "TraceHeader and HttpHeader must stay in sync");
+    
+    // How arg0 is printed
+    enum TraceArgKind 
+    {
+      TraceArg_Number,
+      TraceArg_Signed,
+      TraceArg_Header,
+      TraceArg_Hex
+    };
+    
+    struct TraceEventFormat 
+    {
+      uint16_t      id;
+      const char*   name;
+      TraceArgKind  arg0Kind;
+      // nullptr hides the argument
+      const char*   argNames[3];
+    };
+    
+    static const TraceEventFormat traceEventFormats[] = 
+    {
+      { TraceEvent_HandshakeRequestSent,    "handshake.request_sent",     TraceArg_Number,  { "custom_headers", "bytes", "auth_bytes" } },
+      { TraceEvent_HandshakeResponseHeader, "handshake.response_header",  TraceArg_Header,  { "header", "value_len", "name_len" } },
+      { TraceEvent_HandshakeResponseParsed, "handshake.response_parsed",  TraceArg_Number,  { "success", "flags", "headers" } },
+      { TraceEvent_HandshakeRequestHeader,  "handshake.request_header",   TraceArg_Header,  { "header", "value_len", "name_len" } },
+      { TraceEvent_HandshakeRejected,       "handshake.rejected",         TraceArg_Number,  { "reason", "headers", "status" } },
+      { TraceEvent_HandshakeAccepted,       "handshake.accepted",         TraceArg_Number,  { nullptr, "headers", nullptr } },
+      { TraceEvent_HandshakeResponseStatus, "handshake.response_status",  TraceArg_Number,  { "switching", "len", nullptr } },
+      { TraceEvent_HandshakeRequestStarted, "handshake.request_started",  TraceArg_Number,  { nullptr, nullptr, nullptr } },
+      { TraceEvent_ConnectionOpened,        "connection.opened",          TraceArg_Number,  { "accepted", "port", nullptr } },
+      { TraceEvent_ConnectionClosed,        "connection.closed",          TraceArg_Signed,  { "reason", nullptr, nullptr } },
+      { TraceEvent_ConnectStarted,          "connection.connect_started", TraceArg_Number,  { nullptr, "port", nullptr } },
+      { TraceEvent_TcpConnected,            "connection.tcp_connected",   TraceArg_Number,  { "success", nullptr, nullptr } },
+      { TraceEvent_CloseReceived,           "connection.close_received",  TraceArg_Signed,  { "reason", nullptr, nullptr } },
+      { TraceEvent_InboundLimited,          "connection.inbound_limited", TraceArg_Number,  { "policy", "len", nullptr } },
+      { TraceEvent_CloseSent,               "connection.close_sent",      TraceArg_Signed,  { "reason", nullptr, nullptr } },
+      { TraceEvent_FrameReceived,           "frame.received",             TraceArg_Hex,     { "flags", "len", nullptr } },
+      { TraceEvent_FrameSent,               "frame.sent",                 TraceArg_Hex,     { "flags", "len", nullptr } },
+      { TraceEvent_FragmentsStarted,        "frame.fragments_started",    TraceArg_Hex,     { "opcode", "len", nullptr } },
+      { TraceEvent_FragmentsEnded,          "frame.fragments_ended",      TraceArg_Hex,     { "opcode", "len", nullptr } },
+      { TraceEvent_ControlReceived,         "control.received",           TraceArg_Hex,     { "opcode", "len", nullptr } },
+      { TraceEvent_ControlSent,             "control.sent",               TraceArg_Hex,     { "opcode", "len", nullptr } }
+    };
+    
+    const TraceEventFormat* traceEventFormat(const uint16_t id) 
+    {
+      for (size_t i = 0; i < sizeof(traceEventFormats) / sizeof(traceEventFormats[0]); i++)
+      {
+        if (traceEventFormats[i].id == id)
+          return &traceEventFormats[i];
+      }
+      
+      return nullptr;
+    }
+  }   // namespace internals2_generic
+  
+  size_t WebsocketsTrace::read(TraceRecord* records, const size_t maxRecords) 
+  {
+  #if (_WEBSOCKETS_TRACE_MASK_ != 0)
+    return internals2_generic::traceRing.read(records, maxRecords);
+  #else
+    (void) records;
+    (void) maxRecords;
+    
+    return 0;
+  #endif
+  }
+  
+  uint32_t WebsocketsTrace::dropped() 
+  {
+  #if (_WEBSOCKETS_TRACE_MASK_ != 0)
+    return internals2_generic::traceRing.dropped();
+  #else
+    return 0;
+  #endif
+  }
+  
+  void WebsocketsTrace::clear() 
+  {
+  #if (_WEBSOCKETS_TRACE_MASK_ != 0)
+    internals2_generic::traceRing.clear();
+  #endif
+  }
+  
+  const char* WebsocketsTrace::eventName(const uint16_t id) 
+  {
+    const internals2_generic::TraceEventFormat* eventFormat = internals2_generic::traceEventFormat(id);
+    
+    return eventFormat ? eventFormat->name : "unknown";
+  }
+  
+  const char* WebsocketsTrace::argName(const uint16_t id, const int index) 
+  {
+    const internals2_generic::TraceEventFormat* eventFormat = internals2_generic::traceEventFormat(id);
+    
+    if (index < 0 || index > 2)
+      return nullptr;
+    
+    // unknown events show all of their arguments
+    static const char* const rawNames[3] = { "arg0", "arg1", "arg2" };
+    
+    return eventFormat ? eventFormat->argNames[index] : rawNames[index];
+  }
+  
+  const char* WebsocketsTrace::argText(const TraceRecord& record, const int index, char* buffer, const size_t len) 
+  {
+    using namespace internals2_generic;
+    
+    const TraceEventFormat* eventFormat = traceEventFormat(record.id);
+    const TraceArgKind kind = (eventFormat && index == 0) ? eventFormat->arg0Kind : TraceArg_Number;
+    const uint32_t value = index == 0 ? record.arg0 : index == 1 ? record.arg1 : record.arg2;
+    
+    switch (kind)
+    {
+      case TraceArg_Header:
+        return value < HttpHeader_Count ? HttpHeaderParser::name(static_cast<HttpHeader>(value)) : "?";
+        
+      case TraceArg_Hex:
+        snprintf(buffer, len, "0x%02lx", (unsigned long) value);
+        break;
+        
+      case TraceArg_Signed:
+        snprintf(buffer, len, "%d", static_cast<int16_t>(value));
+        break;
+        
+      default:
+        snprintf(buffer, len, "%lu", (unsigned long) value);
+        break;
+    }
+    
+    return buffer;
+  }
+  
+  size_t WebsocketsTrace::format(const TraceRecord& record, char* buffer, const size_t len) 
+  {
+    int written = snprintf(buffer, len, "%lu #%lx %s", (unsigned long) record.timestamp, (unsigned long) record.connection, eventName(record.id));
+    
+    if (written < 0)
+      return 0;
+      
+    size_t pos = static_cast<size_t>(written) < len ? written : len - 1;
+    
+    for (int i = 0; i < 3 && pos + 1 < len; i++)
+    {
+      const char* name = argName(record.id, i);
+      char text[16];
+      
+      if (!name)
+        continue;
+      
+      written = snprintf(buffer + pos, len - pos, " %s=%s", name, argText(record, i, text, sizeof(text)));
+      
+      if (written < 0)
+        break;
+        
+      pos = pos + written < len ? pos + written : len - 1;
+    }
+    
+    return pos;
+  }
+}     // namespace websockets2_generic
+
+#endif    // _WEBSOCKETS2_GENERIC_TRACE_H